@@ -0,0 +1,187 @@
+//
+// Created by R on 10/17/26.
+//
+
+#ifndef FLARE_BENCHMARK_HPP
+#define FLARE_BENCHMARK_HPP
+
+#include <flare/execution_context.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace fl::bench
+{
+
+/**
+ * One benchmark. Setup builds the layer and tensors outside of the timed
+ * region and returns the operation to time, flops and bytes are per call of
+ * that operation and are used to report throughput
+ */
+struct Case
+{
+    std::string name;
+    double flops;
+    double bytes;
+    std::function<std::function<void()>(ExecutionContext &)> setup;
+};
+
+
+struct Result
+{
+    std::string name;
+    long iterations;
+    double seconds; // mean time per iteration
+    double flops;
+    double bytes;
+
+
+    double GflopsPerSecond() const
+    {
+        return this->flops / this->seconds / 1e9;
+    }
+
+
+    double GbytesPerSecond() const
+    {
+        return this->bytes / this->seconds / 1e9;
+    }
+};
+
+
+inline std::vector<Case> &Cases()
+{
+    static std::vector<Case> cases;
+    return cases;
+}
+
+
+/**
+ * Registers a benchmark at static initialization, e.g.
+ *     static fl::bench::Register dense("Dense/forward", flops, bytes, setup);
+ */
+struct Register
+{
+    Register(std::string name, double flops, double bytes,
+             std::function<std::function<void()>(ExecutionContext &)> setup)
+    {
+        Cases().push_back({std::move(name), flops, bytes, std::move(setup)});
+    }
+};
+
+
+/**
+ * Run the operation once to warm up, then repeatedly until min_time seconds
+ * have passed and at least 3 iterations have run
+ */
+inline Result Run(const Case &bench_case, ExecutionContext &context, double min_time)
+{
+    std::function<void()> operation = bench_case.setup(context);
+    operation();
+
+    long iterations = 0;
+    auto start = std::chrono::steady_clock::now();
+    double elapsed = 0;
+
+    while (elapsed < min_time || iterations < 3) {
+        operation();
+        iterations++;
+        elapsed = std::chrono::duration<double>(
+                std::chrono::steady_clock::now() - start).count();
+    }
+
+    return {bench_case.name, iterations, elapsed / iterations, bench_case.flops,
+            bench_case.bytes};
+}
+
+
+// calls to the C allocator, counted by the executable's malloc replacement
+inline std::atomic<size_t> heap_allocations{0};
+
+
+/**
+ * Run the operation until the arena's free lists and the layers' buffers are
+ * sized, then return the heap allocations of the following steps divided by
+ * their number. Steady state steps of a layer should return 0
+ */
+inline double HeapAllocationsPerStep(const Case &bench_case, ExecutionContext &context,
+                                     int warmup = 3, int steps = 5)
+{
+    std::function<void()> operation = bench_case.setup(context);
+
+    for (int i = 0; i < warmup; i++) {
+        operation();
+    }
+
+    const size_t before = heap_allocations.load();
+
+    for (int i = 0; i < steps; i++) {
+        operation();
+    }
+
+    return static_cast<double>(heap_allocations.load() - before) / steps;
+}
+
+
+inline std::string EscapeJson(const std::string &text)
+{
+    std::string escaped;
+
+    for (char c: text) {
+        if (c == '"' || c == '\\') {
+            escaped += '\\';
+        }
+
+        escaped += c;
+    }
+
+    return escaped;
+}
+
+
+/**
+ * Write results in a layout close to Google Benchmark's JSON output so the
+ * same comparison scripts can track regressions
+ */
+inline void WriteJson(const std::string &path, const std::vector<Result> &results,
+                      int threads)
+{
+    std::ofstream json(path);
+
+    if (!json.is_open()) {
+        throw std::invalid_argument("flare_bench UNABLE TO WRITE " + path);
+    }
+
+    json << "{\n  \"context\": {\n"
+         << "    \"library\": \"flare\",\n"
+         << "    \"threads\": " << threads << ",\n"
+         << "    \"scalar_bytes\": " << sizeof(Scalar) << "\n  },\n"
+         << "  \"benchmarks\": [\n";
+
+    for (size_t i = 0; i < results.size(); i++) {
+        const Result &result = results[i];
+
+        json << "    {\"name\": \"" << EscapeJson(result.name) << "\", "
+             << "\"iterations\": " << result.iterations << ", "
+             << std::setprecision(6) << std::scientific
+             << "\"real_time\": " << result.seconds * 1e9 << ", "
+             << "\"time_unit\": \"ns\", "
+             << "\"flops\": " << result.flops << ", "
+             << "\"bytes\": " << result.bytes << ", "
+             << "\"gflops_per_second\": " << result.GflopsPerSecond() << ", "
+             << "\"gbytes_per_second\": " << result.GbytesPerSecond() << "}"
+             << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+
+    json << "  ]\n}\n";
+}
+
+} // namespace fl::bench
+
+#endif //FLARE_BENCHMARK_HPP
@@ -0,0 +1,605 @@
+//
+// Created by R on 10/17/26.
+//
+
+// Forward and Backward throughput of every layer and the optimizers
+//
+//     flare_bench [--filter=substring] [--min_time=seconds] [--threads=n]
+//                 [--json=path] [--check_allocations]
+//
+// --check_allocations runs each benchmark's steps after warmup and fails if a
+// step allocates from the heap. Run it with --threads=1, the thread pool
+// allocates its tasks when it schedules them
+
+#include <flare/flare.hpp>
+#include "benchmark.hpp"
+#include <cerrno>
+#include <memory>
+
+#if defined(__GLIBC__)
+// counts the allocations of the C allocator, operator new and Eigen's aligned
+// allocations go through it
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *pointer, size_t size);
+void *__libc_memalign(size_t alignment, size_t size);
+
+
+void *malloc(size_t size) noexcept
+{
+    fl::bench::heap_allocations++;
+    return __libc_malloc(size);
+}
+
+
+void *calloc(size_t count, size_t size) noexcept
+{
+    fl::bench::heap_allocations++;
+    return __libc_calloc(count, size);
+}
+
+
+void *realloc(void *pointer, size_t size) noexcept
+{
+    fl::bench::heap_allocations++;
+    return __libc_realloc(pointer, size);
+}
+
+
+void *aligned_alloc(size_t alignment, size_t size) noexcept
+{
+    fl::bench::heap_allocations++;
+    return __libc_memalign(alignment, size);
+}
+
+
+int posix_memalign(void **pointer, size_t alignment, size_t size) noexcept
+{
+    fl::bench::heap_allocations++;
+    *pointer = __libc_memalign(alignment, size);
+    return *pointer || !size ? 0 : ENOMEM;
+}
+}
+#endif
+
+namespace
+{
+
+using namespace fl;
+
+template<int TensorRank>
+Tensor<TensorRank> Random(const Dims<TensorRank> &dims)
+{
+    return RandomUniform(dims, -1, 1);
+}
+
+
+// times Forward of a layer on a fixed input
+template<int InputRank, typename MakeLayer>
+std::function<std::function<void()>(ExecutionContext &)>
+ForwardSetup(MakeLayer make_layer, Dims<InputRank> input_dims)
+{
+    return [make_layer, input_dims](ExecutionContext &context) {
+        std::shared_ptr<Layer> layer(make_layer());
+        layer->SetExecutionContext(context);
+        layer->Training(true);
+        auto input = std::make_shared<Tensor<InputRank>>(Random(input_dims));
+
+        return std::function<void()>([layer, input]() {
+            layer->Forward(*input);
+        });
+    };
+}
+
+
+// times Backward, including the input gradients handed to the previous layer,
+// after one Forward in the setup
+template<int InputRank, int OutputRank, typename MakeLayer>
+std::function<std::function<void()>(ExecutionContext &)>
+BackwardSetup(MakeLayer make_layer, Dims<InputRank> input_dims)
+{
+    return [make_layer, input_dims](ExecutionContext &context) {
+        std::shared_ptr<Layer> layer(make_layer());
+        layer->SetExecutionContext(context);
+        layer->Training(true);
+
+        // some layers keep pointers to their input, it must outlive the benchmark
+        auto input = std::make_shared<Tensor<InputRank>>(Random(input_dims));
+        layer->Forward(*input);
+
+        Tensor<OutputRank> output;
+
+        if constexpr (OutputRank == 2) {
+            output = layer->GetOutput2D();
+        }
+        else if constexpr (OutputRank == 3) {
+            output = layer->GetOutput3D();
+        }
+        else {
+            output = layer->GetOutput4D();
+        }
+
+        auto gradients = std::make_shared<Tensor<OutputRank>>(
+                Random(output.dimensions()));
+
+        return std::function<void()>([layer, input, gradients]() {
+            layer->Backward(*gradients);
+
+            if constexpr (InputRank == 2) {
+                layer->GetInputGradients2D();
+            }
+            else if constexpr (InputRank == 3) {
+                layer->GetInputGradients3D();
+            }
+            else {
+                layer->GetInputGradients4D();
+            }
+        });
+    };
+}
+
+
+// registers Forward and Backward of a layer, backward does about twice the
+// forward work for layers with weights (weight and input gradients)
+template<int InputRank, int OutputRank, typename MakeLayer>
+void RegisterLayer(const std::string &name, MakeLayer make_layer,
+                   const Dims<InputRank> &input_dims, const Dims<OutputRank> &output_dims,
+                   double forward_flops, double backward_flops)
+{
+    const double input_bytes = input_dims.TotalSize() * sizeof(Scalar);
+    const double output_bytes = output_dims.TotalSize() * sizeof(Scalar);
+
+    bench::Register(name + "/forward", forward_flops, input_bytes + output_bytes,
+                    ForwardSetup<InputRank>(make_layer, input_dims));
+    bench::Register(name + "/backward", backward_flops,
+                    2 * output_bytes + input_bytes,
+                    BackwardSetup<InputRank, OutputRank>(make_layer, input_dims));
+}
+
+
+template<typename MakeOptimizer>
+void RegisterOptimizer(const std::string &name, MakeOptimizer make_optimizer,
+                       double flops_per_parameter, int tensors_touched)
+{
+    const Dims<2> dims(1024, 1024);
+
+    bench::Register(
+            name + "/minimize/1024x1024", flops_per_parameter * dims.TotalSize(),
+            tensors_touched * dims.TotalSize() * sizeof(Scalar),
+            [make_optimizer, dims](ExecutionContext &context) {
+                std::shared_ptr<Optimizer> optimizer(make_optimizer());
+                optimizer->SetExecutionContext(context);
+                auto weights = std::make_shared<Tensor<2>>(Random(dims));
+                auto gradients = std::make_shared<Tensor<2>>(Random(dims));
+
+                return std::function<void()>([optimizer, weights, gradients]() {
+                    optimizer->Minimize(*weights, *gradients);
+                    optimizer->Step();
+                });
+            });
+}
+
+
+void RegisterAll()
+{
+    {
+        const int n = 64, in = 1024, out = 1024;
+        const double flops = 2.0 * n * in * out;
+        RegisterLayer("Dense<ReLU>/64x1024x1024",
+                      [=]() { return new Dense<ReLU>(in, out, false); },
+                      Dims<2>(n, in), Dims<2>(n, out), flops, 2 * flops);
+        RegisterLayer("Dense<ReLU>/64x1024x1024/bias",
+                      [=]() { return new Dense<ReLU>(in, out, true); },
+                      Dims<2>(n, in), Dims<2>(n, out), flops, 2 * flops);
+    }
+
+    // serving batch sizes, the packed Gemm against the contraction
+    for (int n: {1, 8, 32}) {
+        const int in = 512, out = 512;
+        const double flops = 2.0 * n * in * out;
+        const std::string shape = std::to_string(n) + "x512x512";
+
+        for (GemmBackend backend: {GemmBackend::CONTRACTION, GemmBackend::PACKED}) {
+            const std::string gemm = backend == GemmBackend::PACKED ? "/packed" : "";
+            RegisterLayer("Dense<ReLU>/" + shape + gemm,
+                          [=]() {
+                              auto layer = new Dense<ReLU>(in, out, true);
+                              layer->SetGemmBackend(backend);
+                              return layer;
+                          },
+                          Dims<2>(n, in), Dims<2>(n, out), flops, 2 * flops);
+        }
+    }
+
+    // each forward convolution against AUTO's choice, a deep layer and the
+    // few channel first layer of the MNIST example
+    const std::vector<std::pair<ConvAlgorithm, std::string>> conv_algorithms {
+            {ConvAlgorithm::AUTO, ""},
+            {ConvAlgorithm::IM2COL, "/im2col"},
+            {ConvAlgorithm::DIRECT, "/direct"},
+            {ConvAlgorithm::WINOGRAD_2X2, "/winograd2x2"},
+            {ConvAlgorithm::WINOGRAD_4X4, "/winograd4x4"}};
+
+    for (const auto &[algorithm, suffix]: conv_algorithms) {
+        const int n = 8, h = 32, w = 32, c = 32, filters = 64;
+        const double flops = 2.0 * n * h * w * filters * 3 * 3 * c;
+        RegisterLayer("Conv2D<ReLU>/8x32x32x32/64f/3x3" + suffix,
+                      [=]() {
+                          auto layer = new Conv2D<ReLU>(filters, c, Kernel(3, 3),
+                                                        Padding::PADDING_SAME);
+                          layer->SetConvAlgorithm(algorithm);
+                          return layer;
+                      },
+                      Dims<4>(n, h, w, c), Dims<4>(n, h, w, filters), flops, 2 * flops);
+    }
+
+    for (const auto &[algorithm, suffix]: conv_algorithms) {
+        const int n = 16, h = 28, w = 28, c = 3, filters = 32;
+        const double flops = 2.0 * n * (h - 2) * (w - 2) * filters * 3 * 3 * c;
+        RegisterLayer("Conv2D<ReLU>/16x28x28x3/32f/3x3/valid" + suffix,
+                      [=]() {
+                          auto layer = new Conv2D<ReLU>(filters, c, Kernel(3, 3),
+                                                        Padding::PADDING_VALID);
+                          layer->SetConvAlgorithm(algorithm);
+                          return layer;
+                      },
+                      Dims<4>(n, h, w, c), Dims<4>(n, h - 2, w - 2, filters),
+                      flops, 2 * flops);
+    }
+
+    // inference on frozen weights against the contraction repacking them per call
+    for (bool frozen: {false, true}) {
+        const int n = 1, h = 28, w = 28, c = 3, filters = 32, units = 128;
+        const double conv_flops = 2.0 * n * h * w * filters * 3 * 3 * c;
+        const double dense_flops = 2.0 * n * (h * w * filters * units + units * 10);
+
+        bench::Register(
+                std::string("Sequential<Conv2D,Dense>/Predict/1x28x28x3") +
+                (frozen ? "/frozen" : ""),
+                conv_flops + dense_flops,
+                (n * h * w * (c + 2 * filters) + h * w * filters * units) * sizeof(Scalar),
+                [=](ExecutionContext &context) {
+                    // the model doesn't own its layers
+                    auto layers = std::make_shared<std::vector<std::unique_ptr<Layer>>>();
+                    layers->emplace_back(new Conv2D<ReLU>(filters, c, Kernel(3, 3),
+                                                          Padding::PADDING_SAME));
+                    layers->emplace_back(new Flatten<4>());
+                    layers->emplace_back(new Dense<ReLU>(h * w * filters, units, true));
+                    layers->emplace_back(new Dense<Sigmoid>(units, 10, true));
+
+                    auto model = std::make_shared<Sequential>(context);
+
+                    for (auto &layer: *layers) {
+                        model->Add(layer.get());
+                    }
+
+                    if (frozen) {
+                        model->Freeze();
+                    }
+
+                    auto input = std::make_shared<Tensor<4>>(Random(Dims<4>(n, h, w, c)));
+
+                    return std::function<void()>([layers, model, input]() {
+                        model->Predict<2>(*input);
+                    });
+                });
+    }
+
+    // Freeze folds the normalization and activation into the convolution, the
+    // unfrozen model multiplies with packed kernels too to only time the folding
+    for (bool frozen: {false, true}) {
+        const int n = 8, h = 32, w = 32, c = 64, filters = 64;
+        const double flops = 2.0 * n * h * w * filters * 3 * 3 * c;
+
+        bench::Register(
+                std::string("Sequential<Conv2D,BatchNormalization,LeakyReLU>/Predict/8x32x32x64") +
+                (frozen ? "/frozen" : ""),
+                flops, n * h * w * (c + 3 * filters) * sizeof(Scalar),
+                [=](ExecutionContext &context) {
+                    auto layers = std::make_shared<std::vector<std::unique_ptr<Layer>>>();
+                    layers->emplace_back(new Conv2D<Linear>(filters, c, Kernel(3, 3),
+                                                            Padding::PADDING_SAME));
+                    layers->emplace_back(new BatchNormalization<4, 1>(Dims<1>(3)));
+                    layers->emplace_back(new LeakyReLU<4>(0.2));
+
+                    auto model = std::make_shared<Sequential>(context);
+
+                    for (auto &layer: *layers) {
+                        layer->SetGemmBackend(GemmBackend::PACKED);
+                        model->Add(layer.get());
+                    }
+
+                    // the normalization's weights are created by its first Forward
+                    auto input = std::make_shared<Tensor<4>>(Random(Dims<4>(n, h, w, c)));
+                    model->Predict<4>(*input);
+
+                    if (frozen) {
+                        model->Freeze();
+                    }
+
+                    return std::function<void()>([layers, model, input]() {
+                        model->Predict<4>(*input);
+                    });
+                });
+    }
+
+    {
+        const int n = 8, h = 16, w = 16, c = 64, filters = 32;
+        const double flops = 2.0 * n * h * w * c * 5 * 5 * filters;
+        RegisterLayer("Conv2DTranspose<Linear>/8x16x16x64/32f/5x5/s2",
+                      [=]() {
+                          return new Conv2DTranspose<Linear>(
+                                  filters, c, Kernel(5, 5), Stride(2, 2),
+                                  Dilation(1, 1), Padding::PADDING_SAME);
+                      },
+                      Dims<4>(n, h, w, c), Dims<4>(n, 2 * h, 2 * w, filters),
+                      flops, 2 * flops);
+    }
+
+    // the same 3x3 layer shape dense, grouped, depthwise and separable, the
+    // wall time should follow the flops
+    {
+        const int n = 8, h = 32, w = 32, c = 64, filters = 64;
+        const double pixels = 1.0 * n * h * w;
+        const Dims<4> input_dims(n, h, w, c);
+        const Dims<4> output_dims(n, h, w, filters);
+
+        for (int groups: {1, 4, 16}) {
+            const double flops = 2.0 * pixels * filters * 3 * 3 * c / groups;
+            RegisterLayer("Conv2D<ReLU>/8x32x32x64/64f/3x3/" + std::to_string(groups) + "g",
+                          [=]() {
+                              return new Conv2D<ReLU>(filters, c, Kernel(3, 3), Stride(1, 1),
+                                                      Dilation(1, 1), Padding::PADDING_SAME,
+                                                      GlorotUniform<4>(), groups);
+                          },
+                          input_dims, output_dims, flops, 2 * flops);
+        }
+
+        const double depthwise_flops = 2.0 * pixels * 3 * 3 * c;
+        RegisterLayer("DepthwiseConv2D<ReLU>/8x32x32x64/3x3",
+                      [=]() {
+                          return new DepthwiseConv2D<ReLU>(c, Kernel(3, 3),
+                                                           Padding::PADDING_SAME);
+                      },
+                      input_dims, Dims<4>(n, h, w, c), depthwise_flops, 2 * depthwise_flops);
+
+        const double separable_flops = depthwise_flops + 2.0 * pixels * c * filters;
+        RegisterLayer("SeparableConv2D<ReLU>/8x32x32x64/64f/3x3",
+                      [=]() {
+                          return new SeparableConv2D<ReLU>(filters, c, Kernel(3, 3),
+                                                           Padding::PADDING_SAME);
+                      },
+                      input_dims, output_dims, separable_flops, 2 * separable_flops);
+    }
+
+    {
+        const int n = 8, h = 64, w = 64, c = 32;
+        const double compares = 1.0 * n * (h / 2) * (w / 2) * c * 4;
+        RegisterLayer("MaxPooling2D/8x64x64x32/2x2",
+                      [=]() { return new MaxPooling2D(PoolSize(2, 2)); },
+                      Dims<4>(n, h, w, c), Dims<4>(n, h / 2, w / 2, c),
+                      compares, compares);
+    }
+
+    {
+        const int n = 32, t = 32, in = 128, units = 128;
+        const double flops = 2.0 * n * t * 4 * units * (in + units);
+        RegisterLayer("LSTM/32x32x128/128u",
+                      [=]() { return new LSTM<TanH, Sigmoid, true>(in, units); },
+                      Dims<3>(n, t, in), Dims<3>(n, t, units), flops, 2 * flops);
+        RegisterLayer("Bidirectional<LSTM>/32x32x128/128u",
+                      [=]() {
+                          return new Bidirectional<CONCAT, TanH, Sigmoid, true>(
+                                  new LSTM<TanH, Sigmoid, true>(in, units));
+                      },
+                      Dims<3>(n, t, in), Dims<3>(n, t, 2 * units),
+                      2 * flops, 4 * flops);
+    }
+
+    {
+        const int n = 32, t = 32, in = 128, units = 128;
+        const double flops = 2.0 * n * t * 3 * units * (in + units);
+        RegisterLayer("GRU/32x32x128/128u",
+                      [=]() { return new GRU<TanH, Sigmoid, true>(in, units); },
+                      Dims<3>(n, t, in), Dims<3>(n, t, units), flops, 2 * flops);
+    }
+
+    for (int n: {1, 8}) {
+        const int t = 32, in = 128, units = 128;
+        const double lstm_flops = 2.0 * n * t * 4 * units * (in + units);
+        const double gru_flops = 2.0 * n * t * 3 * units * (in + units);
+        const std::string shape = std::to_string(n) + "x32x128/128u";
+
+        for (GemmBackend backend: {GemmBackend::CONTRACTION, GemmBackend::PACKED}) {
+            const std::string gemm = backend == GemmBackend::PACKED ? "/packed" : "";
+            RegisterLayer("LSTM/" + shape + gemm,
+                          [=]() {
+                              auto layer = new LSTM<TanH, Sigmoid, true>(in, units);
+                              layer->SetGemmBackend(backend);
+                              return layer;
+                          },
+                          Dims<3>(n, t, in), Dims<3>(n, t, units), lstm_flops,
+                          2 * lstm_flops);
+            RegisterLayer("GRU/" + shape + gemm,
+                          [=]() {
+                              auto layer = new GRU<TanH, Sigmoid, true>(in, units);
+                              layer->SetGemmBackend(backend);
+                              return layer;
+                          },
+                          Dims<3>(n, t, in), Dims<3>(n, t, units), gru_flops,
+                          2 * gru_flops);
+        }
+    }
+
+    {
+        const int n = 8, t = 64, d = 256, heads = 8, head_dim = 32;
+        const double projections = 2.0 * n * t * d * heads * head_dim * 4;
+        const double attention = 2.0 * 2 * n * heads * t * t * head_dim;
+        RegisterLayer("MultiHeadAttention/8x64x256/8h",
+                      [=]() { return new MultiHeadAttention(heads, d, head_dim); },
+                      Dims<3>(n, t, d), Dims<3>(n, t, d),
+                      projections + attention, 2 * (projections + attention));
+    }
+
+    {
+        const int n = 32, t = 64, vocab = 10000, d = 128;
+        bench::Register(
+                "Embedding/32x64/10000x128/forward", 0,
+                2.0 * n * t * d * sizeof(Scalar),
+                [=](ExecutionContext &context) {
+                    auto layer = std::make_shared<Embedding>(vocab, d, t);
+                    layer->SetExecutionContext(context);
+                    auto input = std::make_shared<Tensor<2>>(n, t);
+
+                    for (Eigen::Index i = 0; i < input->size(); i++) {
+                        input->data()[i] = (i * 7919) % vocab;
+                    }
+
+                    return std::function<void()>([layer, input]() {
+                        layer->Forward(*input);
+                    });
+                });
+        bench::Register(
+                "Embedding/32x64/10000x128/backward", n * t * d,
+                3.0 * n * t * d * sizeof(Scalar),
+                [=](ExecutionContext &context) {
+                    auto layer = std::make_shared<Embedding>(vocab, d, t);
+                    layer->SetExecutionContext(context);
+                    Tensor<2> input(n, t);
+
+                    for (Eigen::Index i = 0; i < input.size(); i++) {
+                        input.data()[i] = (i * 7919) % vocab;
+                    }
+
+                    layer->Forward(input);
+                    auto gradients = std::make_shared<Tensor<3>>(
+                            Random(Dims<3>(n, t, d)));
+
+                    return std::function<void()>([layer, gradients]() {
+                        layer->Backward(*gradients);
+                    });
+                });
+    }
+
+    {
+        const int n = 8, h = 32, w = 32, c = 64;
+        const double elements = 1.0 * n * h * w * c;
+        RegisterLayer("BatchNormalization/8x32x32x64",
+                      [=]() {
+                          return new BatchNormalization<4, 1>(Dims<1>(3), 0.99, 0.001,
+                                                              true);
+                      },
+                      Dims<4>(n, h, w, c), Dims<4>(n, h, w, c),
+                      8 * elements, 12 * elements);
+    }
+
+    {
+        // backward builds a features x features Jacobian per sample
+        const int n = 64, features = 256;
+        const double elements = 1.0 * n * features;
+        RegisterLayer("Softmax/64x256",
+                      [=]() { return new Activation<Softmax, 2>(); },
+                      Dims<2>(n, features), Dims<2>(n, features),
+                      5 * elements, 3 * elements * features);
+    }
+
+    RegisterOptimizer("SGD", []() { return new SGD(0.01, 0.9); }, 4, 4);
+    RegisterOptimizer("Adam", []() { return new Adam(); }, 12, 6);
+    RegisterOptimizer("RMSprop", []() { return new RMSprop(); }, 8, 4);
+}
+
+} // namespace
+
+
+int main(int argc, char **argv)
+{
+    std::string filter;
+    std::string json_path;
+    double min_time = 0.5;
+    int threads = fl::ExecutionContext::HardwareThreads();
+    bool check_allocations = false;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        auto value = [&arg](const std::string &flag) {
+            return arg.rfind(flag, 0) == 0 ? arg.substr(flag.size()) : std::string();
+        };
+
+        if (arg.rfind("--filter=", 0) == 0) {
+            filter = value("--filter=");
+        }
+        else if (arg.rfind("--json=", 0) == 0) {
+            json_path = value("--json=");
+        }
+        else if (arg.rfind("--min_time=", 0) == 0) {
+            min_time = std::stod(value("--min_time="));
+        }
+        else if (arg.rfind("--threads=", 0) == 0) {
+            threads = std::stoi(value("--threads="));
+        }
+        else if (arg == "--check_allocations") {
+            check_allocations = true;
+        }
+        else {
+            std::cerr << "usage: " << argv[0] << " [--filter=substring] "
+                      << "[--min_time=seconds] [--threads=n] [--json=path] "
+                      << "[--check_allocations]\n";
+            return 1;
+        }
+    }
+
+    RegisterAll();
+    fl::ExecutionContext context(threads);
+
+    if (check_allocations) {
+#if defined(__GLIBC__)
+        int allocating = 0;
+
+        for (const fl::bench::Case &bench_case: fl::bench::Cases()) {
+            if (bench_case.name.find(filter) == std::string::npos) {
+                continue;
+            }
+
+            const double allocations = fl::bench::HeapAllocationsPerStep(bench_case,
+                                                                         context);
+            allocating += allocations > 0;
+
+            std::cout << std::left << std::setw(56) << bench_case.name << std::right
+                      << std::fixed << std::setprecision(1) << std::setw(12)
+                      << allocations << " heap allocations per step" << std::endl;
+        }
+
+        return allocating > 0;
+#else
+        std::cerr << "--check_allocations needs glibc to count allocations\n";
+        return 1;
+#endif
+    }
+    std::vector<fl::bench::Result> results;
+
+    std::cout << std::left << std::setw(56) << "benchmark" << std::right
+              << std::setw(12) << "time (ms)" << std::setw(12) << "GFLOP/s"
+              << std::setw(12) << "GB/s" << "\n";
+
+    for (const fl::bench::Case &bench_case: fl::bench::Cases()) {
+        if (bench_case.name.find(filter) == std::string::npos) {
+            continue;
+        }
+
+        fl::bench::Result result = fl::bench::Run(bench_case, context, min_time);
+        results.push_back(result);
+
+        std::cout << std::left << std::setw(56) << result.name << std::right
+                  << std::fixed << std::setprecision(3)
+                  << std::setw(12) << result.seconds * 1e3
+                  << std::setw(12) << result.GflopsPerSecond()
+                  << std::setw(12) << result.GbytesPerSecond() << std::endl;
+    }
+
+    if (!json_path.empty()) {
+        fl::bench::WriteJson(json_path, results, context.GetThreads());
+    }
+
+    return 0;
+}
@@ -0,0 +1,59 @@
+//
+// Created by R on 10/17/26.
+//
+
+#ifndef FLARE_DISTRIBUTED_TRAINING_HPP
+#define FLARE_DISTRIBUTED_TRAINING_HPP
+
+#include <flare/flare.hpp>
+#include <flare/distributed/include_distributed.hpp>
+#include <random>
+
+// learn addition with 4 processes on this machine, connected over localhost
+void DistributedTraining()
+{
+    const int world_size = 4;
+
+    // fork before creating any layer, the children must not share thread pools
+    int rank = fl::RingCommunicator::ForkLocalProcesses(world_size);
+    fl::RingCommunicator comm(rank, world_size);
+
+    // every process builds the same dataset from the same seed, the trainer
+    // gives each process its own batches
+    fl::Dataset dataset(fl::Dims<1>(3), fl::Dims<1>(1));
+    std::mt19937 generator(42);
+    std::uniform_real_distribution<fl::Scalar> distribution(0, 1);
+
+    for (int i = 0; i < 1000; i++) {
+        fl::Tensor<1> nums(3);
+        nums.setValues({distribution(generator), distribution(generator),
+                        distribution(generator)});
+        fl::Tensor<1> sum = nums.sum().reshape(fl::Dims<1>(1));
+        dataset.Add(nums, sum);
+    }
+
+    dataset.Batch(10, false);
+
+    fl::Sequential model {
+        new fl::Dense<fl::Linear>(3, 1, false),
+    };
+
+    fl::MeanSquaredError<2> loss;
+    fl::SGD opt;
+
+    fl::DistributedTrainer trainer(model, comm);
+    trainer.Fit(dataset.training_samples, dataset.training_labels, 10, loss, opt);
+
+    bool consistent = trainer.ParametersConsistent();
+
+    if (rank != 0) {
+        std::exit(consistent ? 0 : 1);
+    }
+
+    std::cout << "weights consistent across processes: " << std::boolalpha
+              << (consistent && fl::RingCommunicator::WaitForLocalProcesses())
+              << "\ntrained weights\n" << model.layers[0]->GetWeights2D().front()
+              << "\n";
+}
+
+#endif //FLARE_DISTRIBUTED_TRAINING_HPP
@@ -5,7 +5,8 @@
 #ifndef FLARE_GAN_EXAMPLE_HPP
 #define FLARE_GAN_EXAMPLE_HPP
 
-#include <flare/flare.hpp.hpp>
+#include <flare/flare.hpp>
+#include <filesystem>
 
 using namespace fl;
 
@@ -27,7 +28,6 @@ BinaryCrossEntropy<2> DiscriminatorLoss(const Tensor<2> &real_output,
 // Areas for improvement are:
 // - optimize the 3 convolution operations or swap them for TensorFlow's kernels
 // - add multi-threading to activation, loss, and optimizer
-// - parallelize layer update
 // - add compile time check to skip activation for linear layers
 void GAN()
 {
@@ -74,6 +74,10 @@ void GAN()
             new Dense<Sigmoid>(7 * 7 * 128, 1, false),
     };
 
+    // update each layer while the layers before it are still back propagating
+    generator.SetOverlappedUpdate(true);
+    discriminator.SetOverlappedUpdate(true);
+
     Adam discriminator_opt(1e-4);
     Adam generator_opt(1e-4);
 
@@ -124,8 +128,8 @@ void GAN()
 
             BinaryCrossEntropy<2> discriminator_loss = DiscriminatorLoss(
                     mnist_output, fake_output);
-            discriminator.Backward(discriminator_loss.GetGradients());
-            discriminator.Update(discriminator_opt);
+            discriminator.BackwardAndUpdate(discriminator_loss.GetGradients(),
+                                            discriminator_opt);
 
             Tensor<2> noise_generator = RandomNormal(
                     Dims<2>(dataset.training_samples[i].dimensions().front(),
@@ -138,9 +142,9 @@ void GAN()
             disc_gen_loss(is_fake, is_fake.constant(1.0));
             discriminator.Backward(disc_gen_loss.GetGradients());
 
-            generator.Backward(discriminator.layers.front()->GetInputGradients4D());
-
-            generator.Update(generator_opt);
+            generator.BackwardAndUpdate(
+                    discriminator.layers.front()->GetInputGradients4D(),
+                    generator_opt);
             // not sure discriminator is updated here since it the paper's algorithm does say so
             //discriminator.Update(discriminator_opt);
 
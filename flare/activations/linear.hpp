@@ -25,6 +25,14 @@ public:
     }
 
 
+    // a tensor is passed through as is, auto would return a copy of it
+    template<int TensorRank>
+    static const Tensor<TensorRank> &Activate(const Tensor<TensorRank> &tensor)
+    {
+        return tensor;
+    }
+
+
     /**
      * Compute the activation gradients of a tensor
      * @param tensor   Eigen::Tensor or Eigen::Tensor Op
@@ -6,6 +6,7 @@
 #define FLARE_SOFTMAX_HPP
 
 #include "flare/fl_types.hpp"
+#include "flare/parallel.hpp"
 
 namespace fl
 {
@@ -46,22 +47,80 @@ public:
     }
 
 
+    /**
+     * Softmax along the last dimension into output, each row is shifted by its
+     * maximum, exponentiated and normalized in one pass on the device's threads
+     * without the broadcast temporaries of the expression above
+     * @param tensor   Eigen::Tensor
+     * @param output   tensor with the dimensions of tensor, may be tensor itself
+     * @param device   device whose threads compute the rows
+     */
+    template<int TensorRank>
+    static void Activate(const Tensor <TensorRank> &tensor, Tensor <TensorRank> &output,
+                         const Device &device)
+    {
+        const Eigen::Index features = tensor.dimension(TensorRank - 1);
+        const Eigen::Index rows = features > 0 ? tensor.size() / features : 0;
+
+        ParallelFor(device, rows, 4 * features, [&](Eigen::Index row) {
+            const Scalar *x = tensor.data() + row * features;
+            Scalar *y = output.data() + row * features;
+            const Scalar max = *std::max_element(x, x + features);
+            Scalar sum = 0;
+
+            for (Eigen::Index i = 0; i < features; i++) {
+                y[i] = std::exp(x[i] - max);
+                sum += y[i];
+            }
+
+            for (Eigen::Index i = 0; i < features; i++) {
+                y[i] /= sum;
+            }
+        });
+    }
+
+
     /**
      * Compute the Jacobian of a softmax function for tensors of rank 2 to 4
      * @param softmax   features already activated using softmax
+     * @param device    device whose threads compute the Jacobians
      * @return          Eigen Tensor
      */
     template<int TensorRank>
-    static Tensor<TensorRank + 1> Gradients(const Tensor <TensorRank> &softmax)
+    static Tensor<TensorRank + 1> Gradients(
+            const Tensor <TensorRank> &softmax,
+            const Device &device = ExecutionContext::Default().GetDevice())
     {
+        Tensor<TensorRank + 1> softmax_grad;
+        Softmax::Gradients(softmax, softmax_grad, device);
+        return softmax_grad;
+    }
+
+
+    /**
+     * Compute the Jacobians into softmax_grad, resized only when the shape of
+     * softmax changes so a layer can keep it between steps
+     * @param softmax        features already activated using softmax
+     * @param softmax_grad   Jacobians, one per row of softmax
+     * @param device         device whose threads compute the Jacobians
+     */
+    template<int TensorRank>
+    static void Gradients(const Tensor <TensorRank> &softmax,
+                          Tensor<TensorRank + 1> &softmax_grad, const Device &device)
+    {
+        Dims<TensorRank + 1> dims;
+        std::copy_n(softmax.dimensions().begin(), TensorRank, dims.begin());
+        dims.back() = softmax.dimension(TensorRank - 1);
+        softmax_grad.resize(dims);
+
         if constexpr (TensorRank == 2) {
-            return Softmax::Gradients2D(softmax);
+            Softmax::Gradients2D(softmax, softmax_grad, device);
         }
         else if constexpr(TensorRank == 3) {
-            return Softmax::Gradients3D(softmax);
+            Softmax::Gradients3D(softmax, softmax_grad, device);
         }
         else if constexpr(TensorRank == 4) {
-            return Softmax::Gradients4D(softmax);
+            Softmax::Gradients4D(softmax, softmax_grad, device);
         }
         else {
             throw std::invalid_argument(
@@ -71,23 +130,20 @@ public:
 
 
 private:
-    static Tensor<3> Gradients2D(const Tensor<2> &softmax)
+    static void Gradients2D(const Tensor<2> &softmax, Tensor<3> &softmax_grad,
+                            const Device &device)
     {
-        // create a rank 3 tensor, [N,row,col] where the last 2 dims are the
-        // Jacobian matrices of each sample of the rank 2 batch tensor
-        Tensor<3> softmax_grad(softmax.dimension(0),
-                               softmax.dimension(1),
-                               softmax.dimension(1));
-
-#pragma omp parallel for simd default(none) shared(softmax, softmax_grad)
-        for (Eigen::Index batch = 0; batch < softmax.dimension(0); batch++) {
+        const Eigen::Index features = softmax.dimension(1);
+
+        ParallelFor(device, softmax.dimension(0), features * features,
+                    [&](Eigen::Index batch) {
             // begin calculating the Jacobian matrix of each row
             // according to the formula, where S is the softmax gradient Jacobian
             // S_i * (1 - S_i)   for i == j
             // -S_i * S_j        for i != j
             // or compactly as S_i * (d_ij - S_j), where d_ij = Kronecker delta (fancy ternary)
-            for (Eigen::Index row = 0; row < softmax.dimension(1); row++) {
-                for (Eigen::Index col = 0; col < softmax.dimension(1); col++) {
+            for (Eigen::Index row = 0; row < features; row++) {
+                for (Eigen::Index col = 0; col < features; col++) {
                     if (row != col) {
                         softmax_grad(batch, row, col) =
                                 -softmax(batch, row) * softmax(batch, col);
@@ -98,92 +154,80 @@ private:
                     }
                 }
             }
-        }
-
-        return softmax_grad;
+        });
     }
 
 
     // Only difference from Gradients2D is an extra loop between the batch
     // and last 2 dimensions. If implementing higher rank gradients, just add
     // another for loop if a better solution isn't found``
-    static Tensor<4> Gradients3D(const Tensor<3> &softmax)
+    static void Gradients3D(const Tensor<3> &softmax, Tensor<4> &softmax_grad,
+                            const Device &device)
     {
-        // create a rank 3 tensor, [N,row,col] where the last 2 dims are the
-        // Jacobian matrices of each sample of the rank 2 batch tensor
-        Tensor<4> softmax_grad(softmax.dimension(0),
-                               softmax.dimension(1),
-                               softmax.dimension(2),
-                               softmax.dimension(2));
-
-#pragma omp parallel for simd default(none) shared(softmax, softmax_grad)
-        for (Eigen::Index a = 0; a < softmax.dimension(0); a++) {
-            for (Eigen::Index b = 0; b < softmax.dimension(1); b++) {
-                // begin calculating the Jacobian matrix of each row
-                // according to the formula, where S is the softmax gradient Jacobian
-                // S_i * (1 - S_i)   for i == j
-                // -S_i * S_j        for i != j
-                // or compactly as S_i * (d_ij - S_j), where d_ij = Kronecker delta (fancy ternary)
-                for (Eigen::Index row = 0; row < softmax.dimension(2); row++) {
-                    for (Eigen::Index col = 0; col < softmax.dimension(2); col++) {
-                        if (row != col) {
-                            softmax_grad(a, b, row, col) =
-                                    -softmax(a, b, row) * softmax(a, b, col);
-                        }
-                        else {
-                            softmax_grad(a, b, row, col) =
-                                    softmax(a, b, row) * (1 - softmax(a, b, row));
-                        }
+        const Eigen::Index dim_b = softmax.dimension(1);
+        const Eigen::Index features = softmax.dimension(2);
+
+        // the outer two dims are flattened, each index is one Jacobian matrix
+        ParallelFor(device, softmax.dimension(0) * dim_b, features * features,
+                    [&](Eigen::Index i) {
+            Eigen::Index a = i / dim_b;
+            Eigen::Index b = i % dim_b;
+
+            // begin calculating the Jacobian matrix of each row
+            // according to the formula, where S is the softmax gradient Jacobian
+            // S_i * (1 - S_i)   for i == j
+            // -S_i * S_j        for i != j
+            // or compactly as S_i * (d_ij - S_j), where d_ij = Kronecker delta (fancy ternary)
+            for (Eigen::Index row = 0; row < features; row++) {
+                for (Eigen::Index col = 0; col < features; col++) {
+                    if (row != col) {
+                        softmax_grad(a, b, row, col) =
+                                -softmax(a, b, row) * softmax(a, b, col);
+                    }
+                    else {
+                        softmax_grad(a, b, row, col) =
+                                softmax(a, b, row) * (1 - softmax(a, b, row));
                     }
                 }
             }
-        }
-
-        return softmax_grad;
+        });
     }
 
 
-    static Tensor<5> Gradients4D(const Tensor<4> &softmax)
+    static void Gradients4D(const Tensor<4> &softmax, Tensor<5> &softmax_grad,
+                            const Device &device)
     {
-        // create a rank 3 tensor, [N,row,col] where the last 2 dims are the
-        // Jacobian matrices of each sample of the rank 2 batch tensor
-        Tensor<5> softmax_grad(softmax.dimension(0),
-                               softmax.dimension(1),
-                               softmax.dimension(2),
-                               softmax.dimension(3),
-                               softmax.dimension(3));
-
-#ifdef _OPENMP
-#pragma omp parallel for simd default(none) shared(softmax, softmax_grad)
-#endif
-        for (Eigen::Index a = 0; a < softmax.dimension(0); a++) {
-            for (Eigen::Index b = 0; b < softmax.dimension(1); b++) {
-                for (Eigen::Index c = 0; c < softmax.dimension(2); c++) {
-                    // begin calculating the Jacobian matrix of each row
-                    // according to the formula, where S is the softmax gradient Jacobian
-                    // S_i * (1 - S_i)   for i == j
-                    // -S_i * S_j        for i != j
-                    // or compactly as S_i * (d_ij - S_j), where d_ij = Kronecker delta (fancy ternary)
-                    for (Eigen::Index row = 0; row < softmax.dimension(3); row++) {
-                        for (Eigen::Index col = 0;
-                             col < softmax.dimension(3); col++) {
-                            if (row != col) {
-                                softmax_grad(a, b, c, row, col) =
-                                        -softmax(a, b, c, row) *
-                                        softmax(a, b, c, col);
-                            }
-                            else {
-                                softmax_grad(a, b, c, row, col) =
-                                        softmax(a, b, c, row) *
-                                        (1 - softmax(a, b, c, row));
-                            }
-                        }
+        const Eigen::Index dim_b = softmax.dimension(1);
+        const Eigen::Index dim_c = softmax.dimension(2);
+        const Eigen::Index features = softmax.dimension(3);
+
+        // the outer three dims are flattened, each index is one Jacobian matrix
+        ParallelFor(device, softmax.dimension(0) * dim_b * dim_c,
+                    features * features, [&](Eigen::Index i) {
+            Eigen::Index a = i / (dim_b * dim_c);
+            Eigen::Index b = i / dim_c % dim_b;
+            Eigen::Index c = i % dim_c;
+
+            // begin calculating the Jacobian matrix of each row
+            // according to the formula, where S is the softmax gradient Jacobian
+            // S_i * (1 - S_i)   for i == j
+            // -S_i * S_j        for i != j
+            // or compactly as S_i * (d_ij - S_j), where d_ij = Kronecker delta (fancy ternary)
+            for (Eigen::Index row = 0; row < features; row++) {
+                for (Eigen::Index col = 0; col < features; col++) {
+                    if (row != col) {
+                        softmax_grad(a, b, c, row, col) =
+                                -softmax(a, b, c, row) *
+                                softmax(a, b, c, col);
+                    }
+                    else {
+                        softmax_grad(a, b, c, row, col) =
+                                softmax(a, b, c, row) *
+                                (1 - softmax(a, b, c, row));
                     }
                 }
             }
-        }
-
-        return softmax_grad;
+        });
     }
 };
 
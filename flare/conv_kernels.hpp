@@ -0,0 +1,821 @@
+//
+// Created by R on 10/18/26.
+//
+
+#ifndef FLARE_CONV_KERNELS_HPP
+#define FLARE_CONV_KERNELS_HPP
+
+#include "flare/fl_types.hpp"
+#include "flare/gemm.hpp"
+#include "flare/parallel.hpp"
+#include <vector>
+
+namespace fl
+{
+
+/**
+ * How Conv2D computes its forward convolution
+ *
+ * AUTO           ConvKernels::Choose picks one from the input shape
+ * TUNED          times every algorithm that can run the shape on the first
+ *                Forward of each input shape and keeps the fastest
+ * IM2COL         extract the image patches, then contract them with the kernels,
+ *                or Gemm them with packed kernels for GemmBackend::PACKED
+ * DIRECT         multiply the input pixels with the packed kernels tap by tap,
+ *                no patches are materialized
+ * WINOGRAD_2X2   Winograd F(2x2, 3x3), 2.25x fewer multiplications
+ * WINOGRAD_4X4   Winograd F(4x4, 3x3), 4x fewer multiplications, slightly less
+ *                accurate
+ *
+ * The Winograd kernels only run 3x3 kernels with stride and dilation 1, other
+ * shapes fall back to AUTO's choice
+ */
+enum class ConvAlgorithm
+{
+    AUTO, TUNED, IM2COL, DIRECT, WINOGRAD_2X2, WINOGRAD_4X4
+};
+
+
+/**
+ * Shape of a 2D convolution of an NHWC input with [F, KH, KW, C / groups]
+ * kernels, the kernels in ConvKernels read zeros for every tap outside the
+ * input. With groups, filter f only reads the channels of group
+ * f / (F / groups)
+ */
+struct ConvShape
+{
+    Eigen::Index batches, input_h, input_w, channels;
+    Eigen::Index output_h, output_w, filters;
+    Eigen::Index kernel_h, kernel_w;
+    Eigen::Index stride_h, stride_w;
+    Eigen::Index dilation_h, dilation_w;
+    Eigen::Index pad_top, pad_bottom, pad_left, pad_right;
+    Eigen::Index groups = 1;
+
+
+    // one channel per group, each filter convolves a single channel
+    bool Depthwise() const
+    {
+        return this->groups > 1 && this->groups == this->channels;
+    }
+};
+
+
+/**
+ * Forward convolutions that skip im2col. Both read the NHWC input in place and
+ * write the NHWC output, the filters are the columns of packed matrices so the
+ * inner loops are the GemmSimd microkernel's broadcast and fma
+ *
+ * Only for row major tensors, like Gemm
+ */
+class ConvKernels
+{
+public:
+    static bool WinogradRuns(const ConvShape &shape)
+    {
+        return shape.kernel_h == 3 && shape.kernel_w == 3 &&
+               shape.stride_h == 1 && shape.stride_w == 1 &&
+               shape.dilation_h == 1 && shape.dilation_w == 1;
+    }
+
+
+    /**
+     * The algorithm ConvAlgorithm::AUTO runs. Winograd once there are enough
+     * channels and filters for its transforms to be cheap next to the
+     * multiplications, F(4x4) unless the output is smaller than its tile. The
+     * direct convolution when the kernels are small or 1x1, writing and
+     * reading the patches costs more than multiplying them there, even 1x1
+     * patches are a copy of the input. im2col otherwise, the contraction's
+     * blocking wins on deep kernels
+     */
+    static ConvAlgorithm Choose(const ConvShape &shape)
+    {
+        if (ConvKernels::WinogradRuns(shape) &&
+            shape.channels >= 32 && shape.filters >= 32) {
+            return shape.output_h >= 4 && shape.output_w >= 4
+                   ? ConvAlgorithm::WINOGRAD_4X4 : ConvAlgorithm::WINOGRAD_2X2;
+        }
+
+        const Eigen::Index taps = shape.kernel_h * shape.kernel_w;
+
+        if (taps == 1 || taps * shape.channels <= 128) {
+            return ConvAlgorithm::DIRECT;
+        }
+
+        return ConvAlgorithm::IM2COL;
+    }
+
+
+    /**
+     * Direct convolution, each output pixel sums the kernel taps' rows of the
+     * packed kernels scaled by the channels of the input pixel under the tap.
+     * GemmSimd::rows pixels of an output row are computed against one panel
+     * of filters at a time with the tile in registers, taps that fall in the
+     * padding read zeros. Like Gemm's depth blocks, the taps are walked in
+     * blocks whose rows of the panel fit in L1, the output row accumulates
+     * between blocks
+     *
+     * Grouped convolutions run once per group, each with its group's kernels
+     *
+     * @param input     NHWC input
+     * @param kernels   the group's kernels packed as [KH * KW * C / groups, F / groups]
+     * @param output    NHWC output, [N, output_h, output_w, F]
+     * @param group     group whose channels are read and filters written
+     */
+    static void Direct(const ConvShape &shape, const Scalar *input,
+                       const PackedMatrix &kernels, Scalar *output,
+                       const Device &device, Eigen::Index group = 0)
+    {
+        using S = GemmSimd;
+        constexpr int mr = S::rows;
+        constexpr Eigen::Index nr = S::cols;
+        const Eigen::Index channels = shape.channels / shape.groups;
+        const Eigen::Index filters = shape.filters / shape.groups;
+        const Eigen::Index taps = shape.kernel_h * shape.kernel_w;
+        const Eigen::Index tap_block = std::max<Eigen::Index>(
+                1, ConvKernels::depth / channels);
+        const Eigen::Index blocks = (shape.output_w + mr - 1) / mr;
+        // read by the taps in the padding, from the arena so a step doesn't allocate
+        Scalar *zeros = static_cast<Scalar *>(device.allocate(channels * sizeof(Scalar)));
+        std::fill_n(zeros, channels, 0);
+
+        const double cost = 2.0 * shape.output_w * filters * taps * channels;
+
+        // each (N, output row) writes its own pixels
+        ParallelFor(device, shape.batches * shape.output_h, cost, [&](Eigen::Index row) {
+            const Eigen::Index oh = row % shape.output_h;
+            const Scalar *image = input + (row / shape.output_h) * shape.input_h *
+                                          shape.input_w * shape.channels +
+                                  group * channels;
+            Scalar tile[mr * nr];
+
+            for (Eigen::Index p = 0; p < kernels.Panels(); p++) {
+                const Eigen::Index col = p * nr;
+                const Eigen::Index cols = std::min(nr, filters - col);
+
+                for (Eigen::Index first = 0; first < taps; first += tap_block) {
+                    const Eigen::Index last = std::min(taps, first + tap_block);
+
+                    for (Eigen::Index block = 0; block < blocks; block++) {
+                        const Eigen::Index ow = block * mr;
+                        const Eigen::Index pixels =
+                                std::min<Eigen::Index>(mr, shape.output_w - ow);
+                        Scalar *result = output + (row * shape.output_w + ow) * shape.filters +
+                                         group * filters + col;
+
+                        // the tile goes through a buffer, it may hang over the row
+                        // or the filters
+                        std::fill_n(tile, mr * nr, 0);
+
+                        for (Eigen::Index r = 0; first > 0 && r < pixels; r++) {
+                            std::copy_n(result + r * shape.filters, cols, tile + r * nr);
+                        }
+
+                        typename S::Register acc[mr][2];
+
+                        for (int r = 0; r < mr; r++) {
+                            acc[r][0] = S::Load(tile + r * nr);
+                            acc[r][1] = S::Load(tile + r * nr + S::width);
+                        }
+
+                        for (Eigen::Index tap = first; tap < last; tap++) {
+                            const Eigen::Index ih = oh * shape.stride_h - shape.pad_top +
+                                                    (tap / shape.kernel_w) * shape.dilation_h;
+
+                            if (ih < 0 || ih >= shape.input_h) {
+                                continue; // the tap is in the top or bottom padding
+                            }
+
+                            const Scalar *a[mr];
+
+                            for (int r = 0; r < mr; r++) {
+                                const Eigen::Index iw = (ow + r) * shape.stride_w -
+                                                        shape.pad_left +
+                                                        (tap % shape.kernel_w) *
+                                                        shape.dilation_w;
+                                const bool inside = r < pixels && iw >= 0 &&
+                                                    iw < shape.input_w;
+                                a[r] = inside ? image + (ih * shape.input_w + iw) *
+                                                        shape.channels
+                                              : zeros;
+                            }
+
+                            const Scalar *panel = kernels.Panel(p) + tap * channels * nr;
+
+                            for (Eigen::Index c = 0; c < channels; c++) {
+                                const typename S::Register b0 = S::Load(panel + c * nr);
+                                const typename S::Register b1 =
+                                        S::Load(panel + c * nr + S::width);
+
+                                for (int r = 0; r < mr; r++) {
+                                    const typename S::Register a_rc = S::Broadcast(a[r][c]);
+                                    acc[r][0] = S::Fma(a_rc, b0, acc[r][0]);
+                                    acc[r][1] = S::Fma(a_rc, b1, acc[r][1]);
+                                }
+                            }
+                        }
+
+                        for (int r = 0; r < mr; r++) {
+                            S::Store(tile + r * nr, acc[r][0]);
+                            S::Store(tile + r * nr + S::width, acc[r][1]);
+                        }
+
+                        for (Eigen::Index r = 0; r < pixels; r++) {
+                            std::copy_n(tile + r * nr, cols, result + r * shape.filters);
+                        }
+                    }
+                }
+            }
+        });
+
+        device.deallocate(zeros);
+    }
+
+
+    /**
+     * im2col of one group's channels, the patch of output pixel (n, oh, ow) is
+     * row (n * output_h + oh) * output_w + ow holding each tap's input pixel,
+     * zeros for taps in the padding
+     *
+     * @param input     NHWC input
+     * @param patches   [N * output_h * output_w, KH * KW * C / groups]
+     * @param group     group whose channels are copied
+     */
+    static void Im2col(const ConvShape &shape, const Scalar *input, Scalar *patches,
+                       const Device &device, Eigen::Index group = 0)
+    {
+        const Eigen::Index channels = shape.channels / shape.groups;
+        const Eigen::Index taps = shape.kernel_h * shape.kernel_w;
+        const Eigen::Index patch_size = taps * channels;
+
+        ParallelFor(device, shape.batches * shape.output_h,
+                    1.0 * shape.output_w * patch_size, [&](Eigen::Index row) {
+            const Eigen::Index n = row / shape.output_h;
+            const Eigen::Index oh = row % shape.output_h;
+            Scalar *patch = patches + row * shape.output_w * patch_size;
+            std::fill_n(patch, shape.output_w * patch_size, 0);
+
+            for (Eigen::Index ow = 0; ow < shape.output_w; ow++) {
+                ConvKernels::ForEachTap(shape, input, n, oh, ow,
+                                        [&](Eigen::Index tap, const Scalar *x) {
+                    std::copy_n(x + group * channels, channels,
+                                patch + ow * patch_size + tap * channels);
+                });
+            }
+        });
+    }
+
+
+    /**
+     * col2im, the inverse of Im2col summing each patch entry into the input
+     * pixel it was read from. Each input row gathers the patches whose taps
+     * read it, it only writes the group's channels
+     *
+     * @param patches   [N * output_h * output_w, KH * KW * C / groups]
+     * @param result    NHWC, [N, input_h, input_w, C]
+     * @param group     group whose channels are written
+     */
+    static void Col2im(const ConvShape &shape, const Scalar *patches, Scalar *result,
+                       const Device &device, Eigen::Index group = 0)
+    {
+        const Eigen::Index channels = shape.channels / shape.groups;
+        const Eigen::Index patch_size = shape.kernel_h * shape.kernel_w * channels;
+
+        ParallelFor(device, shape.batches * shape.input_h,
+                    1.0 * shape.kernel_h * shape.output_w * shape.kernel_w * channels,
+                    [&](Eigen::Index row) {
+            const Eigen::Index n = row / shape.input_h;
+            const Eigen::Index ih = row % shape.input_h;
+            Scalar *dx_row = result + row * shape.input_w * shape.channels +
+                             group * channels;
+
+            for (Eigen::Index iw = 0; iw < shape.input_w; iw++) {
+                std::fill_n(dx_row + iw * shape.channels, channels, 0);
+            }
+
+            for (Eigen::Index kh = 0; kh < shape.kernel_h; kh++) {
+                const Eigen::Index oh_strided = ih + shape.pad_top - kh * shape.dilation_h;
+
+                if (oh_strided < 0 || oh_strided % shape.stride_h != 0 ||
+                    oh_strided / shape.stride_h >= shape.output_h) {
+                    continue; // no output row read input row ih with this kernel row
+                }
+
+                const Eigen::Index oh = oh_strided / shape.stride_h;
+
+                for (Eigen::Index ow = 0; ow < shape.output_w; ow++) {
+                    const Scalar *patch = patches +
+                                          ((n * shape.output_h + oh) * shape.output_w +
+                                           ow) * patch_size;
+
+                    for (Eigen::Index kw = 0; kw < shape.kernel_w; kw++) {
+                        const Eigen::Index iw = ow * shape.stride_w - shape.pad_left +
+                                                kw * shape.dilation_w;
+
+                        if (iw < 0 || iw >= shape.input_w) {
+                            continue;
+                        }
+
+                        const Scalar *tap = patch + (kh * shape.kernel_w + kw) * channels;
+                        Scalar *pixel = dx_row + iw * shape.channels;
+
+                        for (Eigen::Index c = 0; c < channels; c++) {
+                            pixel[c] += tap[c];
+                        }
+                    }
+                }
+            }
+        });
+    }
+
+
+    /**
+     * Depthwise convolution, groups == channels, filter f convolves channel
+     * f / multiplier alone. Each output pixel sums its taps' input pixels times
+     * the taps' rows of the kernels, vectorized over the channels
+     *
+     * @param input     NHWC input
+     * @param kernels   kernels as [KH * KW, F]
+     * @param output    NHWC output, [N, output_h, output_w, F]
+     */
+    static void Depthwise(const ConvShape &shape, const Scalar *input,
+                          const Scalar *kernels, Scalar *output, const Device &device)
+    {
+        const Eigen::Index filters = shape.filters;
+
+        // each (N, output row) writes its own pixels
+        ParallelFor(device, shape.batches * shape.output_h,
+                    2.0 * shape.output_w * shape.kernel_h * shape.kernel_w * filters,
+                    [&](Eigen::Index row) {
+            const Eigen::Index n = row / shape.output_h;
+            const Eigen::Index oh = row % shape.output_h;
+
+            for (Eigen::Index ow = 0; ow < shape.output_w; ow++) {
+                Scalar *pixel = output + (row * shape.output_w + ow) * filters;
+                std::fill_n(pixel, filters, 0);
+
+                ConvKernels::ForEachTap(shape, input, n, oh, ow,
+                                        [&](Eigen::Index tap, const Scalar *x) {
+                    ConvKernels::MultiplyAdd(shape, pixel, x, kernels + tap * filters);
+                });
+            }
+        });
+    }
+
+
+    /**
+     * Kernel gradients of a depthwise convolution, dL/dk[tap][f] sums
+     * dL/dZ[f] times the channel of f under the tap over every output pixel.
+     * The output rows are split into one chunk per thread, each accumulates
+     * its own [KH * KW, F] partial sums and the partials are added up
+     *
+     * @param input       NHWC input of Forward
+     * @param gradients   dL/dZ, NHWC
+     * @param result      [KH * KW, F] kernel gradients
+     */
+    static void DepthwiseBackwardKernel(const ConvShape &shape, const Scalar *input,
+                                        const Scalar *gradients, Scalar *result,
+                                        const Device &device)
+    {
+        const Eigen::Index filters = shape.filters;
+        const Eigen::Index size = shape.kernel_h * shape.kernel_w * filters;
+        const Eigen::Index rows = shape.batches * shape.output_h;
+        const Eigen::Index chunks = std::max<Eigen::Index>(
+                1, std::min<Eigen::Index>(rows, device.numThreads()));
+
+        Scalar *partials = static_cast<Scalar *>(
+                device.allocate(chunks * size * sizeof(Scalar)));
+
+        ParallelFor(device, chunks, 2.0 * rows / chunks * shape.output_w * size,
+                    [&](Eigen::Index chunk) {
+            Scalar *partial = partials + chunk * size;
+            std::fill_n(partial, size, 0);
+
+            for (Eigen::Index row = chunk * rows / chunks;
+                 row < (chunk + 1) * rows / chunks; row++) {
+                const Eigen::Index n = row / shape.output_h;
+                const Eigen::Index oh = row % shape.output_h;
+
+                for (Eigen::Index ow = 0; ow < shape.output_w; ow++) {
+                    const Scalar *dz = gradients + (row * shape.output_w + ow) * filters;
+
+                    ConvKernels::ForEachTap(shape, input, n, oh, ow,
+                                            [&](Eigen::Index tap, const Scalar *x) {
+                        ConvKernels::MultiplyAdd(shape, partial + tap * filters, x, dz);
+                    });
+                }
+            }
+        });
+
+        std::copy_n(partials, size, result);
+
+        for (Eigen::Index chunk = 1; chunk < chunks; chunk++) {
+            for (Eigen::Index i = 0; i < size; i++) {
+                result[i] += partials[chunk * size + i];
+            }
+        }
+
+        device.deallocate(partials);
+    }
+
+
+    /**
+     * Input gradients of a depthwise convolution. Like col2im each input row
+     * gathers the output pixels whose taps read it, channel c sums dL/dZ times
+     * the tap's kernels over its multiplier filters
+     *
+     * @param gradients   dL/dZ, NHWC
+     * @param kernels     kernels as [KH * KW, F]
+     * @param result      NHWC input gradients
+     */
+    static void DepthwiseBackwardInput(const ConvShape &shape, const Scalar *gradients,
+                                       const Scalar *kernels, Scalar *result,
+                                       const Device &device)
+    {
+        const Eigen::Index channels = shape.channels;
+        const Eigen::Index filters = shape.filters;
+        const Eigen::Index multiplier = filters / channels;
+
+        ParallelFor(device, shape.batches * shape.input_h,
+                    2.0 * shape.kernel_h * shape.output_w * shape.kernel_w * filters,
+                    [&](Eigen::Index row) {
+            const Eigen::Index n = row / shape.input_h;
+            const Eigen::Index ih = row % shape.input_h;
+            Scalar *dx_row = result + row * shape.input_w * channels;
+            std::fill_n(dx_row, shape.input_w * channels, 0);
+
+            for (Eigen::Index kh = 0; kh < shape.kernel_h; kh++) {
+                const Eigen::Index oh_strided = ih + shape.pad_top - kh * shape.dilation_h;
+
+                if (oh_strided < 0 || oh_strided % shape.stride_h != 0 ||
+                    oh_strided / shape.stride_h >= shape.output_h) {
+                    continue; // no output row read input row ih with this kernel row
+                }
+
+                const Eigen::Index oh = oh_strided / shape.stride_h;
+
+                for (Eigen::Index ow = 0; ow < shape.output_w; ow++) {
+                    const Scalar *dz = gradients + ((n * shape.output_h + oh) *
+                                                    shape.output_w + ow) * filters;
+
+                    for (Eigen::Index kw = 0; kw < shape.kernel_w; kw++) {
+                        const Eigen::Index iw = ow * shape.stride_w - shape.pad_left +
+                                                kw * shape.dilation_w;
+
+                        if (iw < 0 || iw >= shape.input_w) {
+                            continue;
+                        }
+
+                        const Scalar *k = kernels + (kh * shape.kernel_w + kw) * filters;
+                        Scalar *dx = dx_row + iw * channels;
+
+                        if (multiplier == 1) {
+                            ConvKernels::MultiplyAdd(shape, dx, dz, k);
+                            continue;
+                        }
+
+                        for (Eigen::Index c = 0; c < channels; c++) {
+                            for (Eigen::Index m = 0; m < multiplier; m++) {
+                                dx[c] += dz[c * multiplier + m] * k[c * multiplier + m];
+                            }
+                        }
+                    }
+                }
+            }
+        });
+    }
+
+
+    /**
+     * Transform 3x3 kernels for Winograd F(MxM, 3x3), U = G g G^T for every
+     * filter and channel, packed as one [C, F] matrix per position of U
+     *
+     * @param kernels   [F, 3, 3, C] kernels
+     * @param packed    resized to (M + 2)^2 matrices
+     */
+    template<int M>
+    static void PackWinograd(const Tensor<4> &kernels, std::vector<PackedMatrix> &packed)
+    {
+        using T = WinogradTransforms<M>;
+        constexpr int alpha = T::alpha;
+        const Eigen::Index filters = kernels.dimension(0);
+        const Eigen::Index channels = kernels.dimension(3);
+        std::vector<Scalar> u(alpha * alpha * channels * filters);
+
+        for (Eigen::Index f = 0; f < filters; f++) {
+            for (Eigen::Index c = 0; c < channels; c++) {
+                Scalar g_gt[alpha][3] = {}; // G g
+
+                for (int i = 0; i < alpha; i++) {
+                    for (int j = 0; j < 3; j++) {
+                        for (int k = 0; k < 3; k++) {
+                            g_gt[i][j] += T::G[i][k] * kernels(f, k, j, c);
+                        }
+                    }
+                }
+
+                for (int i = 0; i < alpha; i++) {
+                    for (int j = 0; j < alpha; j++) {
+                        Scalar value = 0;
+
+                        for (int k = 0; k < 3; k++) {
+                            value += g_gt[i][k] * T::G[j][k];
+                        }
+
+                        u[((i * alpha + j) * channels + c) * filters + f] = value;
+                    }
+                }
+            }
+        }
+
+        packed.resize(alpha * alpha);
+
+        for (int xi = 0; xi < alpha * alpha; xi++) {
+            packed[xi].Pack(u.data() + xi * channels * filters, channels, filters,
+                            filters, 1);
+        }
+    }
+
+
+    /**
+     * Winograd F(MxM, 3x3) convolution. The output is cut into MxM tiles, the
+     * (M + 2)x(M + 2) input tile under each is transformed to V = B^T d B,
+     * then for each of the (M + 2)^2 positions the [tiles, C] slice of V is
+     * multiplied with that position's [C, F] slice of U in one Gemm, and every
+     * tile of the product is transformed back with Y = A^T m A. The transforms
+     * run on whole channel vectors, the transformed tiles are device temporaries
+     *
+     * @param input     NHWC input
+     * @param kernels   kernels packed by PackWinograd<M>
+     * @param output    NHWC output, [N, output_h, output_w, F]
+     */
+    template<int M>
+    static void Winograd(const ConvShape &shape, const Scalar *input,
+                         const std::vector<PackedMatrix> &kernels, Scalar *output,
+                         const Device &device)
+    {
+        using T = WinogradTransforms<M>;
+        constexpr int alpha = T::alpha;
+        constexpr int positions = alpha * alpha;
+        const Eigen::Index channels = shape.channels;
+        const Eigen::Index filters = shape.filters;
+        const Eigen::Index tiles_h = (shape.output_h + M - 1) / M;
+        const Eigen::Index tiles_w = (shape.output_w + M - 1) / M;
+        const Eigen::Index tiles = shape.batches * tiles_h * tiles_w;
+
+        // [positions, tiles, C] and [positions, tiles, F]
+        Scalar *v = static_cast<Scalar *>(
+                device.allocate(positions * tiles * channels * sizeof(Scalar)));
+        Scalar *m = static_cast<Scalar *>(
+                device.allocate(positions * tiles * filters * sizeof(Scalar)));
+
+        // V = B^T d B, each (N, tile row) transforms its own tiles
+        ParallelFor(device, shape.batches * tiles_h,
+                    4.0 * tiles_w * positions * alpha * channels, [&](Eigen::Index row) {
+            const Eigen::Index n = row / tiles_h;
+            const Eigen::Index th = row % tiles_h;
+            Scalar *d = ThreadScratch(positions * channels, 0);
+            Scalar *bt_d = ThreadScratch(positions * channels, 1);
+
+            for (Eigen::Index tw = 0; tw < tiles_w; tw++) {
+                const Eigen::Index tile = row * tiles_w + tw;
+
+                for (int i = 0; i < alpha; i++) {
+                    const Eigen::Index ih = th * M - shape.pad_top + i;
+
+                    for (int j = 0; j < alpha; j++) {
+                        const Eigen::Index iw = tw * M - shape.pad_left + j;
+                        Scalar *pixel = d + (i * alpha + j) * channels;
+
+                        if (ih < 0 || ih >= shape.input_h || iw < 0 || iw >= shape.input_w) {
+                            std::fill_n(pixel, channels, 0);
+                        }
+                        else {
+                            std::copy_n(input + ((n * shape.input_h + ih) *
+                                                 shape.input_w + iw) * channels,
+                                        channels, pixel);
+                        }
+                    }
+                }
+
+                ConvKernels::Combine<alpha, alpha, alpha>(
+                        T::BT, d, alpha * channels, channels,
+                        bt_d, alpha * channels, channels, channels);
+                ConvKernels::Combine<alpha, alpha, alpha>(
+                        T::BT, bt_d, channels, alpha * channels,
+                        v + tile * channels, tiles * channels,
+                        alpha * tiles * channels, channels);
+            }
+        });
+
+        // one Gemm per position and block of tiles
+        const Eigen::Index block = 256;
+        const Eigen::Index blocks = (tiles + block - 1) / block;
+
+        ParallelFor(device, positions * blocks, 2.0 * block * channels * filters,
+                    [&](Eigen::Index i) {
+            const Eigen::Index xi = i / blocks;
+            const Eigen::Index first = (i % blocks) * block;
+            const Eigen::Index rows = std::min(block, tiles - first);
+
+            Gemm::Run(rows, v + (xi * tiles + first) * channels, channels, 1,
+                      kernels[xi], m + (xi * tiles + first) * filters, filters,
+                      Eigen::DefaultDevice());
+        });
+
+        // Y = A^T m A, tiles hanging over the output are cut
+        ParallelFor(device, shape.batches * tiles_h,
+                    2.0 * tiles_w * (alpha + M) * M * alpha * filters, [&](Eigen::Index row) {
+            const Eigen::Index n = row / tiles_h;
+            const Eigen::Index th = row % tiles_h;
+            const Eigen::Index rows = std::min<Eigen::Index>(M, shape.output_h - th * M);
+            Scalar *at_m = ThreadScratch(M * alpha * filters, 0);
+            Scalar *y = ThreadScratch(M * M * filters, 1);
+
+            for (Eigen::Index tw = 0; tw < tiles_w; tw++) {
+                const Eigen::Index tile = row * tiles_w + tw;
+                const Eigen::Index cols = std::min<Eigen::Index>(M, shape.output_w - tw * M);
+
+                ConvKernels::Combine<M, alpha, alpha>(
+                        T::AT, m + tile * filters, alpha * tiles * filters,
+                        tiles * filters, at_m, alpha * filters, filters, filters);
+                ConvKernels::Combine<M, alpha, M>(
+                        T::AT, at_m, filters, alpha * filters,
+                        y, filters, M * filters, filters);
+
+                for (Eigen::Index i = 0; i < rows; i++) {
+                    std::copy_n(y + i * M * filters, cols * filters,
+                                output + ((n * shape.output_h + th * M + i) *
+                                          shape.output_w + tw * M) * filters);
+                }
+            }
+        });
+
+        device.deallocate(m);
+        device.deallocate(v);
+    }
+
+private:
+    // rows of a panel in a block of taps, keeps the block (depth x cols) in L1
+    static constexpr Eigen::Index depth = 16384 / (GemmSimd::cols * sizeof(Scalar));
+
+
+    /**
+     * Calls f(tap, pixel) for every tap of output pixel (n, oh, ow) that falls
+     * inside the input, pixel points to the input pixel's channels
+     */
+    template<typename Function>
+    static void ForEachTap(const ConvShape &shape, const Scalar *input, Eigen::Index n,
+                           Eigen::Index oh, Eigen::Index ow, Function &&f)
+    {
+        for (Eigen::Index kh = 0; kh < shape.kernel_h; kh++) {
+            const Eigen::Index ih = oh * shape.stride_h - shape.pad_top +
+                                    kh * shape.dilation_h;
+
+            if (ih < 0 || ih >= shape.input_h) {
+                continue;
+            }
+
+            for (Eigen::Index kw = 0; kw < shape.kernel_w; kw++) {
+                const Eigen::Index iw = ow * shape.stride_w - shape.pad_left +
+                                        kw * shape.dilation_w;
+
+                if (iw < 0 || iw >= shape.input_w) {
+                    continue;
+                }
+
+                f(kh * shape.kernel_w + kw,
+                  input + ((n * shape.input_h + ih) * shape.input_w + iw) * shape.channels);
+            }
+        }
+    }
+
+
+    /**
+     * y[f] += x[f / multiplier] * k[f] over a depthwise convolution's filters,
+     * GemmSimd registers at a time when every channel has one filter
+     */
+    static void MultiplyAdd(const ConvShape &shape, Scalar *y, const Scalar *x,
+                            const Scalar *k)
+    {
+        using S = GemmSimd;
+        const Eigen::Index filters = shape.filters;
+        const Eigen::Index multiplier = filters / shape.channels;
+        Eigen::Index f = 0;
+
+        if (multiplier == 1) {
+            for (; f + S::width <= filters; f += S::width) {
+                S::Store(y + f, S::Fma(S::Load(x + f), S::Load(k + f), S::Load(y + f)));
+            }
+
+            for (; f < filters; f++) {
+                y[f] += x[f] * k[f];
+            }
+
+            return;
+        }
+
+        for (; f < filters; f++) {
+            y[f] += x[f / multiplier] * k[f];
+        }
+    }
+
+
+    /**
+     * Transform matrices of Winograd F(MxM, 3x3) from Lavin and Gray, "Fast
+     * Algorithms for Convolutional Neural Networks", Y = A^T [(G g G^T) . (B^T d B)] A
+     */
+    template<int M>
+    struct WinogradTransforms;
+
+
+    /**
+     * out[i][j] = sum_k L[i][k] * x[k][j] for an R x K matrix L and a K x J
+     * grid of vectors of length len, x[k][j] starts at x + k * x_k + j * x_j
+     * and out[i][j] at out + i * out_i + j * out_j. With the strides swapped
+     * it multiplies with L^T from the right instead
+     */
+    template<int R, int K, int J>
+    static void Combine(const Scalar (&l)[R][K], const Scalar *x,
+                        Eigen::Index x_k, Eigen::Index x_j,
+                        Scalar *out, Eigen::Index out_i, Eigen::Index out_j,
+                        Eigen::Index len)
+    {
+        for (int i = 0; i < R; i++) {
+            for (int j = 0; j < J; j++) {
+                Scalar *result = out + i * out_i + j * out_j;
+                std::fill_n(result, len, 0);
+
+                for (int k = 0; k < K; k++) {
+                    const Scalar coefficient = l[i][k];
+
+                    if (coefficient == 0) {
+                        continue;
+                    }
+
+                    const Scalar *vector = x + k * x_k + j * x_j;
+
+                    for (Eigen::Index c = 0; c < len; c++) {
+                        result[c] += coefficient * vector[c];
+                    }
+                }
+            }
+        }
+    }
+};
+
+
+template<>
+struct ConvKernels::WinogradTransforms<2>
+{
+    static constexpr int alpha = 4;
+
+    static constexpr Scalar BT[4][4] = {
+            {1, 0, -1, 0},
+            {0, 1, 1, 0},
+            {0, -1, 1, 0},
+            {0, 1, 0, -1}};
+
+    static constexpr Scalar G[4][3] = {
+            {1, 0, 0},
+            {0.5, 0.5, 0.5},
+            {0.5, -0.5, 0.5},
+            {0, 0, 1}};
+
+    static constexpr Scalar AT[2][4] = {
+            {1, 1, 1, 0},
+            {0, 1, -1, -1}};
+};
+
+
+template<>
+struct ConvKernels::WinogradTransforms<4>
+{
+    static constexpr int alpha = 6;
+
+    static constexpr Scalar BT[6][6] = {
+            {4, 0, -5, 0, 1, 0},
+            {0, -4, -4, 1, 1, 0},
+            {0, 4, -4, -1, 1, 0},
+            {0, -2, -1, 2, 1, 0},
+            {0, 2, -1, -2, 1, 0},
+            {0, 4, 0, -5, 0, 1}};
+
+    static constexpr Scalar G[6][3] = {
+            {1.0 / 4, 0, 0},
+            {-1.0 / 6, -1.0 / 6, -1.0 / 6},
+            {-1.0 / 6, 1.0 / 6, -1.0 / 6},
+            {1.0 / 24, 1.0 / 12, 1.0 / 6},
+            {1.0 / 24, -1.0 / 12, 1.0 / 6},
+            {0, 0, 1}};
+
+    static constexpr Scalar AT[4][6] = {
+            {1, 1, 1, 1, 1, 0},
+            {0, 1, -1, 2, -2, 0},
+            {0, 1, 1, 4, 4, 0},
+            {0, 1, -1, 8, -8, 1}};
+};
+
+} // namespace fl
+
+#endif //FLARE_CONV_KERNELS_HPP
@@ -0,0 +1,333 @@
+//
+// Created by R on 10/17/26.
+//
+
+#ifndef FLARE_DATA_LOADER_HPP
+#define FLARE_DATA_LOADER_HPP
+
+#include "flare/fl_types.hpp"
+#include <algorithm>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <random>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace fl
+{
+
+/**
+ * Assembles batches on background threads while the model trains. Samples are
+ * produced on demand by a user function, so the dataset doesn't have to fit in
+ * memory and reading, decoding and augmenting run in parallel with training
+ *
+ * Producer threads claim batches in order and write each sample straight into
+ * its slot of a bounded ring of batch tensors, Next() hands the batches out in
+ * order. At most prefetch batches are held in memory. Producers run ahead into
+ * the following epoch, each epoch has its own shuffle
+ *
+ *     DataLoader<3, 1> loader(count, Dims<3>(28, 28, 1), Dims<1>(10),
+ *         [](size_t i, TensorMap<3> sample, TensorMap<1> label) {
+ *             ... decode sample i into sample and label
+ *         }, 64);
+ *     model.Fit(loader, epochs, loss, opt);
+ */
+template<int SampleRank, int LabelRank>
+class DataLoader
+{
+public:
+    using BatchSample = Tensor<SampleRank + 1>;
+    using BatchLabel = Tensor<LabelRank + 1>;
+
+    // writes sample i of the dataset into the given sample and label tensors
+    using LoadFunction = std::function<void(size_t index,
+                                            TensorMap<SampleRank> sample,
+                                            TensorMap<LabelRank> label)>;
+
+    /**
+     * @param size          number of samples in the dataset
+     * @param sample_dims   dimensions of one sample
+     * @param label_dims    dimensions of one label
+     * @param load          called concurrently from the producer threads,
+     *                      must be thread safe
+     * @param batch_size    samples per batch, the last batch of an epoch holds
+     *                      the remainder
+     * @param shuffle       visit the samples in a new random order every epoch
+     * @param workers       number of producer threads
+     * @param prefetch      number of batches buffered ahead of training
+     * @param seed          seed of the shuffle, epochs use seed + epoch
+     */
+    DataLoader(size_t size, const Dims<SampleRank> &sample_dims,
+               const Dims<LabelRank> &label_dims, LoadFunction load,
+               int batch_size, bool shuffle = true,
+               int workers = std::max(1u, std::thread::hardware_concurrency() / 2),
+               int prefetch = 4, uint64_t seed = std::random_device()())
+            : size(size), sample_dims(sample_dims), label_dims(label_dims),
+              load(std::move(load)), batch_size(batch_size), shuffle(shuffle),
+              seed(seed), slots(std::max(prefetch, 1))
+    {
+        if (size == 0 || batch_size < 1 || workers < 1) {
+            throw std::invalid_argument(
+                    "DataLoader SIZE, BATCH SIZE AND WORKERS MUST BE POSITIVE");
+        }
+
+        this->batches_per_epoch = (size + batch_size - 1) / batch_size;
+
+        for (int i = 0; i < workers; i++) {
+            this->producers.emplace_back([this]() { this->Produce(); });
+        }
+    }
+
+
+    /**
+     * Loader over samples already in memory, the vectors must outlive the loader
+     */
+    DataLoader(const std::vector<Tensor<SampleRank>> &samples,
+               const std::vector<Tensor<LabelRank>> &labels, int batch_size,
+               bool shuffle = true, int workers = 1, int prefetch = 4)
+            : DataLoader(DataLoader::MatchingSize(samples, labels),
+                         samples.empty() ? Dims<SampleRank>() : samples.front().dimensions(),
+                         labels.empty() ? Dims<LabelRank>() : labels.front().dimensions(),
+                         [&samples, &labels](size_t i, TensorMap<SampleRank> sample,
+                                             TensorMap<LabelRank> label) {
+                             sample = samples[i];
+                             label = labels[i];
+                         }, batch_size, shuffle, workers, prefetch)
+    {
+        // nothing to do
+    }
+
+
+    DataLoader(const DataLoader &) = delete;
+
+    DataLoader &operator=(const DataLoader &) = delete;
+
+
+    ~DataLoader()
+    {
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->stop = true;
+        }
+
+        this->slot_freed.notify_all();
+
+        for (std::thread &producer: this->producers) {
+            producer.join();
+        }
+    }
+
+
+    /**
+     * Blocks until the next batch is ready. The returned tensors stay valid
+     * until the following call, which gives their slot back to the producers.
+     * Rethrows any exception thrown by the load function for this batch
+     *
+     * @return   sample and label tensors of the batch, in epoch order
+     */
+    std::pair<const BatchSample &, const BatchLabel &> Next()
+    {
+        std::unique_lock<std::mutex> lock(this->mutex);
+
+        if (this->consumed > 0) {
+            // release the slot of the batch returned by the previous call
+            this->slots[(this->consumed - 1) % this->slots.size()].state = Slot::FREE;
+            this->slot_freed.notify_all();
+        }
+
+        Slot &slot = this->slots[this->consumed % this->slots.size()];
+        this->slot_ready.wait(lock, [&slot]() { return slot.state == Slot::READY; });
+        slot.state = Slot::IN_USE;
+        this->consumed++;
+
+        // shuffles of finished epochs are no longer needed
+        this->orders.erase(this->orders.begin(), this->orders.lower_bound(
+                static_cast<int>((this->consumed - 1) / this->batches_per_epoch)));
+
+        if (slot.error) {
+            std::rethrow_exception(std::exchange(slot.error, nullptr));
+        }
+
+        return {slot.sample, slot.label};
+    }
+
+
+    /**
+     * @return   number of batches per epoch
+     */
+    size_t Batches() const
+    {
+        return this->batches_per_epoch;
+    }
+
+private:
+    struct Slot
+    {
+        enum State
+        {
+            FREE, FILLING, READY, IN_USE
+        };
+
+        State state = FREE;
+        BatchSample sample;
+        BatchLabel label;
+        std::exception_ptr error;
+    };
+
+
+    static size_t MatchingSize(const std::vector<Tensor<SampleRank>> &samples,
+                               const std::vector<Tensor<LabelRank>> &labels)
+    {
+        if (samples.size() != labels.size()) {
+            throw std::invalid_argument("DataLoader inputs should match labels 1:1");
+        }
+
+        return samples.size();
+    }
+
+
+    void Produce()
+    {
+        std::unique_lock<std::mutex> lock(this->mutex);
+
+        while (true) {
+            // claim the next batch, wait for the consumer to free its slot
+            size_t batch = this->claimed++;
+            Slot &slot = this->slots[batch % this->slots.size()];
+
+            this->slot_freed.wait(lock, [this, &slot, batch]() {
+                return this->stop ||
+                       (slot.state == Slot::FREE && this->InWindow(batch));
+            });
+
+            if (this->stop) {
+                return;
+            }
+
+            slot.state = Slot::FILLING;
+
+            int epoch = static_cast<int>(batch / this->batches_per_epoch);
+            std::shared_ptr<const std::vector<size_t>> order = this->Order(epoch);
+            lock.unlock();
+
+            try {
+                this->Fill(slot, *order, batch % this->batches_per_epoch);
+            }
+            catch (...) {
+                slot.error = std::current_exception();
+            }
+
+            lock.lock();
+            slot.state = Slot::READY;
+            this->slot_ready.notify_all();
+        }
+    }
+
+
+    // a batch may take a slot once the batch one lap behind it was consumed,
+    // producers running ahead can't take a slot out of order
+    bool InWindow(size_t batch) const
+    {
+        return batch < this->consumed + this->slots.size();
+    }
+
+
+    // sample order of an epoch, created by the first producer to reach it,
+    // called with the mutex held
+    std::shared_ptr<const std::vector<size_t>> Order(int epoch)
+    {
+        auto &order = this->orders[epoch];
+
+        if (!order) {
+            auto indices = std::make_shared<std::vector<size_t>>(this->size);
+            std::iota(indices->begin(), indices->end(), 0);
+
+            if (this->shuffle) {
+                std::mt19937_64 generator(this->seed + epoch);
+                std::shuffle(indices->begin(), indices->end(), generator);
+            }
+
+            order = std::move(indices);
+        }
+
+        return order;
+    }
+
+
+    // load the samples of one batch directly into the slot's tensors
+    void Fill(Slot &slot, const std::vector<size_t> &order, size_t batch)
+    {
+        const size_t first = batch * this->batch_size;
+        const Eigen::Index count = static_cast<Eigen::Index>(
+                std::min<size_t>(this->batch_size, this->size - first));
+
+        Dims<SampleRank + 1> batch_sample_dims;
+        Dims<LabelRank + 1> batch_label_dims;
+        batch_sample_dims[0] = count;
+        batch_label_dims[0] = count;
+        std::copy_n(this->sample_dims.begin(), SampleRank, batch_sample_dims.begin() + 1);
+        std::copy_n(this->label_dims.begin(), LabelRank, batch_label_dims.begin() + 1);
+
+        // only the last batch of an epoch changes size
+        if (slot.sample.dimensions() != batch_sample_dims) {
+            slot.sample.resize(batch_sample_dims);
+        }
+
+        if (slot.label.dimensions() != batch_label_dims) {
+            slot.label.resize(batch_label_dims);
+        }
+
+        const Eigen::Index sample_size = this->sample_dims.TotalSize();
+        const Eigen::Index label_size = this->label_dims.TotalSize();
+
+        for (Eigen::Index i = 0; i < count; i++) {
+#ifndef FLARE_COLMAJOR
+            // row major, each sample of the batch is contiguous
+            this->load(order[first + i],
+                       TensorMap<SampleRank>(slot.sample.data() + i * sample_size,
+                                             this->sample_dims),
+                       TensorMap<LabelRank>(slot.label.data() + i * label_size,
+                                            this->label_dims));
+#else
+            Tensor<SampleRank> sample(this->sample_dims);
+            Tensor<LabelRank> label(this->label_dims);
+            this->load(order[first + i], TensorMap<SampleRank>(sample.data(), this->sample_dims),
+                       TensorMap<LabelRank>(label.data(), this->label_dims));
+            slot.sample.chip(i, 0) = sample;
+            slot.label.chip(i, 0) = label;
+#endif
+        }
+    }
+
+
+    const size_t size;
+    const Dims<SampleRank> sample_dims;
+    const Dims<LabelRank> label_dims;
+    const LoadFunction load;
+    const int batch_size;
+    const bool shuffle;
+    const uint64_t seed;
+    size_t batches_per_epoch;
+
+    // guarded by mutex
+    std::mutex mutex;
+    std::condition_variable slot_freed;
+    std::condition_variable slot_ready;
+    std::vector<Slot> slots; // batch b is buffered in slot b % slots.size()
+    std::map<int, std::shared_ptr<const std::vector<size_t>>> orders; // per epoch
+    size_t claimed = 0; // batches taken by producers, over all epochs
+    size_t consumed = 0; // batches returned by Next
+    bool stop = false;
+
+    std::vector<std::thread> producers;
+};
+
+} // namespace fl
+
+#endif //FLARE_DATA_LOADER_HPP
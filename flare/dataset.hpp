@@ -5,6 +5,11 @@
 #ifndef FLARE_DATASET_H
 #define FLARE_DATASET_H
 
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <numeric>
+#include <random>
 #include <vector>
 #include <sstream>
 #include <fstream>
@@ -16,10 +21,32 @@
 #endif
 
 #include "flare/fl_types.hpp"
+#include "flare/execution_context.hpp"
+#include "flare/mapped_file.hpp"
+#include "flare/dataset_file.hpp"
+#include "flare/parallel.hpp"
 
 namespace fl
 {
 
+/**
+ * Result of reading a csv file into a Dataset
+ */
+struct CSVParseStats
+{
+    size_t rows = 0; // rows added to the dataset
+    size_t skipped = 0; // rows with an unexpected number of numeric values
+    size_t bytes = 0; // file size
+    double seconds = 0;
+
+
+    double MegabytesPerSecond() const
+    {
+        return this->seconds > 0 ? this->bytes / 1e6 / this->seconds : 0;
+    }
+};
+
+
 template<int SampleRank, int LabelRank>
 class Dataset
 {
@@ -183,66 +210,180 @@ public:
     }
 
 
-    void Add(const std::string &path_to_csv,
-             const std::vector<int> &label_col_indices,
-             char delimiter = ',', bool ignore_mismatch = true)
+    /**
+     * Append the rows of a csv file, the first row is the header and is skipped.
+     * The file is memory mapped and parsed in windows, each window split into
+     * chunks that are parsed concurrently on the default execution context
+     * straight into the sample and label tensors
+     *
+     * @param path_to_csv         csv file
+     * @param label_col_indices   columns that form the label, in column order,
+     *                            every other column is a sample feature
+     * @param delimiter           column separator
+     * @param ignore_mismatch     skip rows that don't have the expected number of
+     *                            numeric values instead of throwing
+     * @return                    rows read and throughput
+     */
+    CSVParseStats Add(const std::string &path_to_csv,
+                      const std::vector<int> &label_col_indices,
+                      char delimiter = ',', bool ignore_mismatch = true)
     {
-        // sort into descending order and remove uniques from vector
-        std::vector<int> _label_col_indices = label_col_indices;
-        std::sort(_label_col_indices.begin(), _label_col_indices.end(),
-                  std::greater<>());
-        _label_col_indices.erase(
-                std::unique(_label_col_indices.begin(), _label_col_indices.end()),
-                _label_col_indices.end());
-
-        // string holds the current csv row as string
-        std::string csv_row;
-        std::ifstream csv(path_to_csv); // holds csv file in memory
-        std::getline(csv, csv_row); // skip header
+        auto start_time = std::chrono::steady_clock::now();
 
-        // iterate through each csv row
-        while (std::getline(csv, csv_row)) {
-            std::vector<Scalar> sample;
-            std::vector<Scalar> label;
+        // is_label[col] is 1 for label columns, columns past its end are features
+        std::vector<char> is_label;
 
-            std::stringstream row_string(csv_row);
-            std::string csv_col_value;
-            int index = 0;
-
-            // iterate through each csv value
-            while (std::getline(row_string, csv_col_value, delimiter)) {
-                std::vector<int> label_indices = _label_col_indices;
-
-                // while iterating through each csv row value, if the current index is
-                // one of the column label indices (whose vector was sorted descending),
-                // add it to the label vector, else to the sample vector
-                if (_label_col_indices.empty() || index != label_indices.back()) {
-                    sample.push_back(
-                            !csv_col_value.empty() ? std::stod(csv_col_value) : 0);
-                    index++;
+        for (int col: label_col_indices) {
+            if (col < 0) {
+                throw std::invalid_argument(
+                        "Dataset::Add INVALID LABEL COLUMN " + std::to_string(col));
+            }
+
+            is_label.resize(std::max<size_t>(is_label.size(), col + 1), 0);
+            is_label[col] = 1;
+        }
+
+        MappedFile csv(path_to_csv);
+        const char *cursor = csv.data();
+        const char *const end = csv.data() + csv.size();
+        cursor = Dataset::NextLine(cursor, end); // skip header
+
+        const Device &device = ExecutionContext::Default().GetDevice();
+        const int chunks = 4 * ExecutionContext::Default().GetThreads();
+        const size_t window_bytes = chunks * csv_chunk_bytes;
+
+        CSVParseStats stats;
+        stats.bytes = csv.size();
+
+        while (cursor < end) {
+            // the window ends on a line boundary, chunks split it at line boundaries
+            const char *window_end = Dataset::NextLine(
+                    cursor + std::min<size_t>(window_bytes, end - cursor) - 1, end);
+            csv.WillNeed(cursor - csv.data(), window_end - cursor);
+
+            std::vector<const char *> bounds(chunks + 1, window_end);
+            bounds[0] = cursor;
+
+            for (int k = 1; k < chunks; k++) {
+                const char *split = cursor + (window_end - cursor) * k / chunks;
+                bounds[k] = std::max(bounds[k - 1], Dataset::LineStart(split, cursor));
+            }
+
+            // first pass, count the rows of each chunk so every chunk knows where
+            // its rows go
+            std::vector<size_t> first_row(chunks + 1, 0);
+
+            ParallelFor(device, chunks, csv_chunk_bytes, [&](Eigen::Index k) {
+                first_row[k + 1] = Dataset::CountRows(bounds[k], bounds[k + 1]);
+            });
+
+            std::partial_sum(first_row.begin(), first_row.end(), first_row.begin());
+
+            const size_t previous_rows = this->prebatch_samples.size();
+            this->prebatch_samples.resize(previous_rows + first_row.back());
+            this->prebatch_labels.resize(previous_rows + first_row.back());
+
+            // second pass, parse every row into its preallocated tensors
+            std::vector<char> valid(first_row.back(), 1);
+            std::vector<std::string> errors(chunks);
+
+            ParallelFor(device, chunks, 2 * csv_chunk_bytes, [&](Eigen::Index k) {
+                size_t row = first_row[k];
+
+                for (const char *line = bounds[k]; line < bounds[k + 1];) {
+                    const char *line_end = std::find(line, bounds[k + 1], '\n');
+
+                    if (!Dataset::IsBlank(line, line_end)) {
+                        Tensor<SampleRank> &sample =
+                                this->prebatch_samples[previous_rows + row];
+                        Tensor<LabelRank> &label =
+                                this->prebatch_labels[previous_rows + row];
+                        sample.resize(this->sample_dims);
+                        label.resize(this->label_dims);
+
+                        if (!Dataset::ParseRow(line, line_end, delimiter, is_label,
+                                               sample, label)) {
+                            valid[row] = 0;
+
+                            if (errors[k].empty()) {
+                                errors[k] = std::string(line, line_end);
+                            }
+                        }
+
+                        row++;
+                    }
+
+                    line = line_end + 1;
                 }
-                else {
-                    label.push_back(std::stod(csv_col_value));
-                    label_indices.pop_back();
+            });
+
+            for (const std::string &error: errors) {
+                if (!error.empty() && !ignore_mismatch) {
+                    // the dataset keeps only the rows of the windows before
+                    this->prebatch_samples.resize(previous_rows);
+                    this->prebatch_labels.resize(previous_rows);
+
+                    throw std::invalid_argument(std::string(
+                            "Dataset::Add EXPECTED " +
+                            std::to_string(this->sample_dims.TotalSize()) +
+                            " FEATURES AND " +
+                            std::to_string(this->label_dims.TotalSize()) +
+                            " LABELS, GOT CSV ROW: " + error));
                 }
             }
 
-            // check that the csv row has the expected amount of features
-            if ((this->sample_dims.TotalSize() + this->label_dims.TotalSize()) !=
-                sample.size() && !ignore_mismatch) {
-                throw std::invalid_argument(std::string(
-                        "Dataset::Add EXPECTED " +
-                        std::to_string(this->sample_dims.TotalSize()) +
-                        " FEATURES AND " +
-                        std::to_string(this->label_dims.TotalSize()) +
-                        " LABELS, GOT CSV ROW: " + csv_row));
+            // drop the rows that failed to parse, keeping the order of the rest
+            size_t kept = previous_rows;
+
+            for (size_t row = 0; row < valid.size(); row++) {
+                if (valid[row]) {
+                    std::swap(this->prebatch_samples[kept],
+                              this->prebatch_samples[previous_rows + row]);
+                    std::swap(this->prebatch_labels[kept],
+                              this->prebatch_labels[previous_rows + row]);
+                    kept++;
+                }
             }
 
-            this->prebatch_samples.push_back(
-                    TensorMap<SampleRank>(sample.data(), this->sample_dims));
-            this->prebatch_labels.push_back(
-                    TensorMap<LabelRank>(label.data(), this->label_dims));
+            this->prebatch_samples.resize(kept);
+            this->prebatch_labels.resize(kept);
+            stats.rows += kept - previous_rows;
+            stats.skipped += valid.size() - (kept - previous_rows);
+
+            csv.DontNeed(cursor - csv.data(), window_end - cursor);
+            cursor = window_end;
         }
+
+        stats.seconds = std::chrono::duration<double>(
+                std::chrono::steady_clock::now() - start_time).count();
+
+        return stats;
+    }
+
+
+    /**
+     * Write every sample added so far, batched or not, to a binary dataset file
+     * that MappedDataset opens without parsing
+     *
+     * @param path   output file, overwritten
+     */
+    void Save(const std::string &path) const
+    {
+        DatasetWriter<SampleRank, LabelRank> writer(path, this->sample_dims,
+                                                    this->label_dims);
+
+        for (size_t i = 0; i < this->prebatch_samples.size(); i++) {
+            writer.Add(this->prebatch_samples[i], this->prebatch_labels[i]);
+        }
+
+        for (size_t batch = 0; batch < this->training_samples.size(); batch++) {
+            for (Eigen::Index i = 0; i < this->training_samples[batch].dimension(0); i++) {
+                writer.Add(Tensor<SampleRank>(this->training_samples[batch].chip(i, 0)),
+                           Tensor<LabelRank>(this->training_labels[batch].chip(i, 0)));
+            }
+        }
+
+        writer.Close();
     }
 
 
@@ -277,6 +418,111 @@ public:
     std::vector<Tensor<LabelRank + 1>> training_labels;
 
 protected:
+    // bytes of csv parsed by one task
+    static constexpr size_t csv_chunk_bytes = 4 << 20;
+
+
+    // start of the line after the one containing position, or end
+    static const char *NextLine(const char *position, const char *end)
+    {
+        const char *newline = std::find(position, end, '\n');
+        return newline == end ? end : newline + 1;
+    }
+
+
+    // start of the line containing position
+    static const char *LineStart(const char *position, const char *begin)
+    {
+        while (position > begin && *(position - 1) != '\n') {
+            position--;
+        }
+
+        return position;
+    }
+
+
+    static bool IsBlank(const char *begin, const char *end)
+    {
+        return std::all_of(begin, end, [](char c) {
+            return c == '\r' || c == ' ' || c == '\t';
+        });
+    }
+
+
+    static size_t CountRows(const char *begin, const char *end)
+    {
+        size_t rows = 0;
+
+        for (const char *line = begin; line < end;) {
+            const char *line_end = std::find(line, end, '\n');
+            rows += Dataset::IsBlank(line, line_end) ? 0 : 1;
+            line = line_end + 1;
+        }
+
+        return rows;
+    }
+
+
+    // parse one csv row, false if a value isn't numeric or the row doesn't have
+    // exactly the expected number of features and labels
+    static bool ParseRow(const char *begin, const char *end, char delimiter,
+                         const std::vector<char> &is_label,
+                         Tensor<SampleRank> &sample, Tensor<LabelRank> &label)
+    {
+        Scalar *sample_data = sample.data();
+        Scalar *label_data = label.data();
+        Eigen::Index features = 0;
+        Eigen::Index labels = 0;
+        size_t col = 0;
+
+        for (const char *field = begin; field <= end; col++) {
+            const char *field_end = std::find(field, end, delimiter);
+
+            // trim whitespace, quotes and the \r of windows line endings
+            const char *first = field;
+            const char *last = field_end;
+
+            while (first < last && (*first == ' ' || *first == '"' || *first == '+')) {
+                first++;
+            }
+
+            while (last > first && (last[-1] == ' ' || last[-1] == '"' ||
+                                    last[-1] == '\r')) {
+                last--;
+            }
+
+            Scalar value = 0; // empty values are 0
+
+            if (first < last) {
+                auto [parsed_end, error] = std::from_chars(first, last, value);
+
+                if (error != std::errc() || parsed_end != last) {
+                    return false;
+                }
+            }
+
+            if (col < is_label.size() && is_label[col]) {
+                if (labels == label.size()) {
+                    return false;
+                }
+
+                label_data[labels++] = value;
+            }
+            else {
+                if (features == sample.size()) {
+                    return false;
+                }
+
+                sample_data[features++] = value;
+            }
+
+            field = field_end + 1;
+        }
+
+        return features == sample.size() && labels == label.size();
+    }
+
+
     void NormalizePreBatch()
     {
         for (Tensor<SampleRank> &tensor: this->prebatch_samples) {
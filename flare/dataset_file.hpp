@@ -0,0 +1,412 @@
+//
+// Created by R on 10/17/26.
+//
+
+#ifndef FLARE_DATASET_FILE_HPP
+#define FLARE_DATASET_FILE_HPP
+
+#include "flare/fl_types.hpp"
+#include "flare/mapped_file.hpp"
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+namespace fl
+{
+
+/**
+ * Binary dataset file layout, all values in the writing machine's byte order
+ *
+ *     header        DatasetFileHeader
+ *     sample dims   int64 x sample_rank
+ *     label dims    int64 x label_rank
+ *     samples       count samples of Scalar, one after another, at samples_offset
+ *     labels        count labels of Scalar, one after another, at labels_offset
+ *
+ * Both blocks start on a 64 byte boundary. Each sample is stored in the
+ * tensor's row major order, so with the default row major tensors consecutive
+ * samples form a batch tensor in place
+ */
+struct DatasetFileHeader
+{
+    static constexpr char expected_magic[4] = {'F', 'L', 'D', 'S'};
+    static constexpr uint32_t current_version = 1;
+    static constexpr uint64_t alignment = 64;
+
+    char magic[4] = {'F', 'L', 'D', 'S'};
+    uint32_t version = current_version;
+    uint32_t scalar_bytes = sizeof(Scalar); // 4 for float, 8 for double
+    uint32_t sample_rank = 0;
+    uint32_t label_rank = 0;
+    uint32_t reserved = 0;
+    uint64_t count = 0;
+    uint64_t samples_offset = 0;
+    uint64_t labels_offset = 0;
+
+
+    static uint64_t Align(uint64_t offset)
+    {
+        return (offset + alignment - 1) / alignment * alignment;
+    }
+};
+
+
+/**
+ * Writes samples one at a time, so datasets larger than memory can be
+ * converted, e.g. while parsing images. Labels are staged in a temporary file
+ * next to the output and appended by Close
+ */
+template<int SampleRank, int LabelRank>
+class DatasetWriter
+{
+public:
+    DatasetWriter(const std::string &path, const Dims<SampleRank> &sample_dims,
+                  const Dims<LabelRank> &label_dims)
+            : path(path), labels_path(path + ".labels"),
+              sample_dims(sample_dims), label_dims(label_dims),
+              file(path, std::ios::binary | std::ios::trunc),
+              labels_file(labels_path, std::ios::binary | std::ios::trunc)
+    {
+        if (!this->file.is_open() || !this->labels_file.is_open()) {
+            throw std::invalid_argument("DatasetWriter UNABLE TO CREATE " + path);
+        }
+
+        this->header.sample_rank = SampleRank;
+        this->header.label_rank = LabelRank;
+        this->header.samples_offset = DatasetFileHeader::Align(
+                sizeof(DatasetFileHeader) +
+                sizeof(int64_t) * (SampleRank + LabelRank));
+
+        // header is rewritten with the final count and offsets by Close
+        this->WriteHeader();
+    }
+
+
+    DatasetWriter(const DatasetWriter &) = delete;
+
+    DatasetWriter &operator=(const DatasetWriter &) = delete;
+
+
+    ~DatasetWriter()
+    {
+        try {
+            this->Close();
+        }
+        catch (...) {
+            // destructors don't throw, call Close to see errors
+        }
+    }
+
+
+    void Add(const Tensor<SampleRank> &sample, const Tensor<LabelRank> &label)
+    {
+        if (sample.dimensions() != this->sample_dims ||
+            label.dimensions() != this->label_dims) {
+            std::ostringstream error_msg;
+            error_msg << "DatasetWriter::Add EXPECTED SAMPLE,LABEL DIMENSIONS "
+                      << this->sample_dims << "," << this->label_dims
+                      << ", INSTEAD GOT " << sample.dimensions() << ","
+                      << label.dimensions();
+            throw std::invalid_argument(error_msg.str());
+        }
+
+        DatasetWriter::Write(this->file, sample);
+        DatasetWriter::Write(this->labels_file, label);
+        this->header.count++;
+    }
+
+
+    /**
+     * Append the labels and finish the header, called by the destructor
+     */
+    void Close()
+    {
+        if (this->closed) {
+            return;
+        }
+
+        this->closed = true;
+        this->labels_file.close();
+
+        const uint64_t samples_end = this->header.samples_offset +
+                                     this->header.count * this->sample_dims.TotalSize() *
+                                     sizeof(Scalar);
+        this->header.labels_offset = DatasetFileHeader::Align(samples_end);
+
+        this->file.seekp(0, std::ios::end);
+        DatasetWriter::Pad(this->file, this->header.labels_offset - samples_end);
+
+        if (this->header.count > 0) {
+            std::ifstream labels(this->labels_path, std::ios::binary);
+            this->file << labels.rdbuf();
+        }
+
+        std::remove(this->labels_path.c_str());
+
+        this->WriteHeader();
+        this->file.close();
+
+        if (this->file.fail()) {
+            throw std::runtime_error("DatasetWriter FAILED TO WRITE " + this->path);
+        }
+    }
+
+private:
+    template<int TensorRank>
+    static void Write(std::ofstream &stream, const Tensor<TensorRank> &tensor)
+    {
+        if constexpr (static_cast<int>(Tensor<TensorRank>::Layout) == Eigen::RowMajor) {
+            stream.write(reinterpret_cast<const char *>(tensor.data()),
+                         tensor.size() * sizeof(Scalar));
+        }
+        else {
+            // the file is always row major
+            Dims<TensorRank> reverse_dims;
+
+            for (int i = 0; i < TensorRank; i++) {
+                reverse_dims[i] = TensorRank - 1 - i;
+            }
+
+            Tensor<TensorRank> row_major = tensor.shuffle(reverse_dims);
+            stream.write(reinterpret_cast<const char *>(row_major.data()),
+                         row_major.size() * sizeof(Scalar));
+        }
+    }
+
+
+    static void Pad(std::ofstream &stream, uint64_t bytes)
+    {
+        for (uint64_t i = 0; i < bytes; i++) {
+            stream.put(0);
+        }
+    }
+
+
+    void WriteHeader()
+    {
+        this->file.seekp(0);
+        this->file.write(reinterpret_cast<const char *>(&this->header),
+                         sizeof(this->header));
+
+        for (int i = 0; i < SampleRank; i++) {
+            int64_t dim = this->sample_dims[i];
+            this->file.write(reinterpret_cast<const char *>(&dim), sizeof(dim));
+        }
+
+        for (int i = 0; i < LabelRank; i++) {
+            int64_t dim = this->label_dims[i];
+            this->file.write(reinterpret_cast<const char *>(&dim), sizeof(dim));
+        }
+
+        DatasetWriter::Pad(this->file, this->header.samples_offset - this->file.tellp());
+    }
+
+
+    std::string path;
+    std::string labels_path;
+    Dims<SampleRank> sample_dims;
+    Dims<LabelRank> label_dims;
+    std::ofstream file;
+    std::ofstream labels_file;
+    DatasetFileHeader header;
+    bool closed = false;
+};
+
+
+/**
+ * Read-only dataset backed by a memory mapped file written by DatasetWriter or
+ * Dataset::Save. Opening is instant whatever the size, pages are read when a
+ * batch is first used and are shared through the page cache by every process
+ * training on the same file
+ *
+ * Batches are maps over the file, no data is copied. To train in the
+ * background use Load with a DataLoader:
+ *
+ *     MappedDataset<3, 1> data("mnist.flds");
+ *     DataLoader<3, 1> loader(data.Size(), data.GetSampleDims(), data.GetLabelDims(),
+ *         [&data](size_t i, TensorMap<3> sample, TensorMap<1> label) {
+ *             data.Load(i, sample, label);
+ *         }, 64);
+ */
+template<int SampleRank, int LabelRank>
+class MappedDataset
+{
+public:
+    explicit MappedDataset(const std::string &path) : file(path)
+    {
+        if (this->file.size() < sizeof(DatasetFileHeader)) {
+            throw std::invalid_argument("MappedDataset " + path +
+                                        " IS NOT A DATASET FILE");
+        }
+
+        std::copy_n(this->file.data(), sizeof(this->header),
+                    reinterpret_cast<char *>(&this->header));
+
+        if (!std::equal(std::begin(DatasetFileHeader::expected_magic),
+                        std::end(DatasetFileHeader::expected_magic),
+                        this->header.magic) ||
+            this->header.version != DatasetFileHeader::current_version) {
+            throw std::invalid_argument("MappedDataset " + path +
+                                        " IS NOT A DATASET FILE");
+        }
+
+        if (this->header.scalar_bytes != sizeof(Scalar) ||
+            this->header.sample_rank != SampleRank ||
+            this->header.label_rank != LabelRank) {
+            throw std::invalid_argument(
+                    "MappedDataset " + path + " HOLDS RANK " +
+                    std::to_string(this->header.sample_rank) + "," +
+                    std::to_string(this->header.label_rank) + " DATA OF " +
+                    std::to_string(this->header.scalar_bytes) +
+                    " BYTE SCALARS, EXPECTED RANK " + std::to_string(SampleRank) +
+                    "," + std::to_string(LabelRank) + " OF " +
+                    std::to_string(sizeof(Scalar)));
+        }
+
+        const char *dims = this->file.data() + sizeof(DatasetFileHeader);
+
+        for (int i = 0; i < SampleRank; i++, dims += sizeof(int64_t)) {
+            int64_t dim;
+            std::copy_n(dims, sizeof(dim), reinterpret_cast<char *>(&dim));
+            this->sample_dims[i] = dim;
+        }
+
+        for (int i = 0; i < LabelRank; i++, dims += sizeof(int64_t)) {
+            int64_t dim;
+            std::copy_n(dims, sizeof(dim), reinterpret_cast<char *>(&dim));
+            this->label_dims[i] = dim;
+        }
+
+        const uint64_t labels_end = this->header.labels_offset +
+                                    this->header.count * this->label_dims.TotalSize() *
+                                    sizeof(Scalar);
+
+        if (labels_end > this->file.size()) {
+            throw std::invalid_argument("MappedDataset " + path + " IS TRUNCATED");
+        }
+
+        this->samples = reinterpret_cast<const Scalar *>(
+                this->file.data() + this->header.samples_offset);
+        this->labels = reinterpret_cast<const Scalar *>(
+                this->file.data() + this->header.labels_offset);
+    }
+
+
+    /**
+     * @return   number of samples
+     */
+    size_t Size() const
+    {
+        return this->header.count;
+    }
+
+
+    const Dims<SampleRank> &GetSampleDims() const
+    {
+        return this->sample_dims;
+    }
+
+
+    const Dims<LabelRank> &GetLabelDims() const
+    {
+        return this->label_dims;
+    }
+
+
+    /**
+     * Samples [first, first + count) as one batch tensor, without copying.
+     * Only available with row major tensors, the file's layout
+     */
+    TensorMapConst<SampleRank + 1> Samples(size_t first, size_t count) const
+    {
+        static_assert(static_cast<int>(Tensor<SampleRank>::Layout) == Eigen::RowMajor,
+                      "MappedDataset batches require row major tensors");
+        return MappedDataset::Map<SampleRank>(this->samples, this->sample_dims,
+                                              first, count);
+    }
+
+
+    TensorMapConst<LabelRank + 1> Labels(size_t first, size_t count) const
+    {
+        static_assert(static_cast<int>(Tensor<LabelRank>::Layout) == Eigen::RowMajor,
+                      "MappedDataset batches require row major tensors");
+        return MappedDataset::Map<LabelRank>(this->labels, this->label_dims,
+                                             first, count);
+    }
+
+
+    /**
+     * Copy one sample and its label, e.g. into a DataLoader's batch
+     */
+    void Load(size_t index, TensorMap<SampleRank> sample, TensorMap<LabelRank> label) const
+    {
+        this->CheckRange(index, 1);
+        MappedDataset::Copy<SampleRank>(
+                this->samples + index * this->sample_dims.TotalSize(),
+                this->sample_dims, sample);
+        MappedDataset::Copy<LabelRank>(
+                this->labels + index * this->label_dims.TotalSize(),
+                this->label_dims, label);
+    }
+
+private:
+    void CheckRange(size_t first, size_t count) const
+    {
+        if (first + count > this->header.count) {
+            throw std::out_of_range("MappedDataset SAMPLES " + std::to_string(first) +
+                                    " TO " + std::to_string(first + count) +
+                                    " OUT OF RANGE");
+        }
+    }
+
+
+    template<int TensorRank>
+    static void Copy(const Scalar *data, const Dims<TensorRank> &dims,
+                     TensorMap<TensorRank> &target)
+    {
+        if constexpr (static_cast<int>(Tensor<TensorRank>::Layout) == Eigen::RowMajor) {
+            std::copy_n(data, dims.TotalSize(), target.data());
+        }
+        else {
+            // the file is always row major, i.e. column major with reversed dims
+            Dims<TensorRank> reverse_dims;
+            Dims<TensorRank> file_dims;
+
+            for (int i = 0; i < TensorRank; i++) {
+                reverse_dims[i] = TensorRank - 1 - i;
+                file_dims[i] = dims[TensorRank - 1 - i];
+            }
+
+            target = TensorMapConst<TensorRank>(data, file_dims).shuffle(reverse_dims);
+        }
+    }
+
+
+    template<int TensorRank>
+    TensorMapConst<TensorRank + 1> Map(const Scalar *data, const Dims<TensorRank> &dims,
+                                       size_t first, size_t count) const
+    {
+        this->CheckRange(first, count);
+
+        Dims<TensorRank + 1> batch_dims;
+        batch_dims[0] = static_cast<Eigen::Index>(count);
+        std::copy_n(dims.begin(), TensorRank, batch_dims.begin() + 1);
+
+        return TensorMapConst<TensorRank + 1>(data + first * dims.TotalSize(),
+                                              batch_dims);
+    }
+
+
+    MappedFile file;
+    DatasetFileHeader header;
+    Dims<SampleRank> sample_dims;
+    Dims<LabelRank> label_dims;
+    const Scalar *samples = nullptr;
+    const Scalar *labels = nullptr;
+};
+
+} // namespace fl
+
+#endif //FLARE_DATASET_FILE_HPP
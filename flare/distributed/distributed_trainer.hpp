@@ -0,0 +1,237 @@
+//
+// Created by R on 10/17/26.
+//
+
+#ifndef FLARE_DISTRIBUTED_TRAINER_HPP
+#define FLARE_DISTRIBUTED_TRAINER_HPP
+
+#include "flare/fl_types.hpp"
+#include "flare/sequential.hpp"
+#include "flare/distributed/ring_communicator.hpp"
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+
+namespace fl
+{
+
+/**
+ * Trains one replica of a model per process. Every process runs Forward and
+ * Backward on its own batches, the layers' weight gradients are averaged across
+ * all processes with a ring all-reduce, then every process applies the same
+ * update. Parameters start from rank 0's weights, so with the same optimizer
+ * settings every process keeps identical weights and optimizer state without
+ * the state itself being sent
+ *
+ *     int rank = RingCommunicator::ForkLocalProcesses(4);
+ *     RingCommunicator comm(rank, 4);
+ *     Sequential model {...};
+ *     DistributedTrainer(model, comm).Fit(inputs, labels, epochs, loss, opt);
+ */
+class DistributedTrainer
+{
+public:
+    /**
+     * @param model   this process's replica, same layers on every process
+     * @param comm    ring connecting the processes, must outlive the trainer
+     */
+    DistributedTrainer(Sequential &model, RingCommunicator &comm)
+            : model(model), comm(comm)
+    {
+        // nothing to do
+    }
+
+
+    /**
+     * Copy the learnable parameters of one process's model to all the others
+     *
+     * @param root   rank whose parameters are kept
+     */
+    void BroadcastParameters(int root = 0)
+    {
+        this->Pack(&Layer::GetParameters);
+        this->comm.Broadcast(this->buffer.data(), this->buffer.size(), root);
+        this->Unpack(&Layer::GetParameters);
+    }
+
+
+    /**
+     * Sum the layers' weight gradients across all processes and scale them by
+     * 1 / world size, call between Backward and Update
+     */
+    void AllReduceGradients()
+    {
+        this->Pack(&Layer::GetParameterGradients);
+        this->comm.AllReduce(this->buffer.data(), this->buffer.size());
+
+        const Scalar scale = Scalar(1) / this->comm.GetWorldSize();
+
+        for (Scalar &value: this->buffer) {
+            value *= scale;
+        }
+
+        this->Unpack(&Layer::GetParameterGradients);
+    }
+
+
+    /**
+     * Every process must pass the same dataset, batch m is trained by rank
+     * m % world size. Each epoch runs inputs.size() / world size steps on every
+     * process so the collectives stay in lockstep, the remaining batches are
+     * skipped
+     *
+     * Progress is printed by rank 0 only, the loss shown is the mean over all
+     * processes. Metrics are computed on this process's batches only
+     */
+    template<int TensorSampleRank, int TensorLabelRank>
+    void Fit(const std::vector<fl::Tensor<TensorSampleRank>> &inputs,
+             const std::vector<fl::Tensor<TensorLabelRank>> &labels, int epochs,
+             LossFunction <TensorLabelRank> &loss_function, Optimizer &opt,
+             const std::vector<fl::Metric<TensorLabelRank> *> &metrics = {})
+    {
+        const int world_size = this->comm.GetWorldSize();
+        const int rank = this->comm.GetRank();
+
+        if (inputs.size() != labels.size() ||
+            inputs.size() < static_cast<size_t>(world_size)) {
+            throw std::invalid_argument(
+                    "DistributedTrainer::Fit INPUTS SHOULD MATCH LABELS 1:1 AND "
+                    "HAVE AT LEAST ONE BATCH PER PROCESS");
+        }
+
+        this->model.ValidateLayers();
+
+        ExecutionContext &context = this->model.GetExecutionContext();
+        loss_function.SetExecutionContext(context);
+        opt.SetExecutionContext(context);
+
+        for (auto metric: metrics) {
+            metric->SetExecutionContext(context);
+        }
+
+        this->BroadcastParameters();
+
+        const int steps = static_cast<int>(inputs.size()) / world_size;
+        const int epoch_count_length = std::to_string(epochs).length();
+
+        this->model.Training(true);
+
+        for (int e = 0; e < epochs; e++) {
+            auto start_time = std::chrono::high_resolution_clock::now();
+            Scalar loss_sum = 0;
+
+            for (int step = 0; step < steps; step++) {
+                int m = step * world_size + rank;
+
+                this->model.Forward(inputs[m]);
+                this->model.Backward(labels[m], loss_function);
+
+                for (auto metric: metrics) {
+                    (*metric)(this->GetOutput<TensorLabelRank>(), labels[m]);
+                }
+
+                this->AllReduceGradients();
+                this->model.Update(opt);
+                loss_sum += loss_function.GetLoss();
+            }
+
+            // mean epoch loss over all processes
+            this->comm.AllReduce(&loss_sum, 1);
+
+            if (rank == 0) {
+                auto elapsed_time = std::chrono::duration_cast<std::chrono::seconds>(
+                        std::chrono::high_resolution_clock::now() - start_time);
+
+                std::cout << "Epoch "
+                          << std::setw(epoch_count_length) << std::setfill(' ')
+                          << e + 1 << " " << elapsed_time.count() << "s loss: "
+                          << std::setprecision(4) << std::fixed
+                          << loss_sum / (steps * world_size);
+
+                for (auto metric: metrics) {
+                    std::cout << ", " << *metric;
+                }
+
+                std::cout << std::endl;
+            }
+
+            for (auto metric: metrics) {
+                metric->Reset();
+            }
+        }
+
+        this->model.Training(false);
+    }
+
+
+    /**
+     * Check that every process holds the same parameters, e.g. after Fit
+     *
+     * @return   true on every process if all parameters match rank 0's
+     */
+    bool ParametersConsistent()
+    {
+        this->Pack(&Layer::GetParameters);
+        std::vector<Scalar> root_parameters = this->buffer;
+        this->comm.Broadcast(root_parameters.data(), root_parameters.size());
+
+        Scalar mismatches = root_parameters == this->buffer ? 0 : 1;
+        this->comm.AllReduce(&mismatches, 1);
+
+        return mismatches == 0;
+    }
+
+private:
+    template<int OutputRank>
+    const Tensor<OutputRank> &GetOutput() const
+    {
+        if constexpr (OutputRank == 2) {
+            return this->model.layers.back()->GetOutput2D();
+        }
+        else if constexpr (OutputRank == 3) {
+            return this->model.layers.back()->GetOutput3D();
+        }
+        else {
+            return this->model.layers.back()->GetOutput4D();
+        }
+    }
+
+
+    using ViewGetter = std::vector<TensorMap<1>> (Layer::*)();
+
+    // copy the views of every layer into one contiguous buffer
+    void Pack(ViewGetter get_views)
+    {
+        this->buffer.clear();
+
+        for (Layer *layer: this->model.layers) {
+            for (auto &view: (layer->*get_views)()) {
+                this->buffer.insert(this->buffer.end(), view.data(),
+                                    view.data() + view.size());
+            }
+        }
+    }
+
+
+    // copy the buffer back into the views, in the order Pack used
+    void Unpack(ViewGetter get_views)
+    {
+        const Scalar *source = this->buffer.data();
+
+        for (Layer *layer: this->model.layers) {
+            for (auto &view: (layer->*get_views)()) {
+                std::copy_n(source, view.size(), view.data());
+                source += view.size();
+            }
+        }
+    }
+
+
+    Sequential &model;
+    RingCommunicator &comm;
+    std::vector<Scalar> buffer; // all parameters or gradients of the model, flat
+};
+
+} // namespace fl
+
+#endif //FLARE_DISTRIBUTED_TRAINER_HPP
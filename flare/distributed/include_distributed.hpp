@@ -0,0 +1,12 @@
+//
+// Created by R on 10/17/26.
+//
+
+#ifndef FLARE_INCLUDE_DISTRIBUTED_HPP
+#define FLARE_INCLUDE_DISTRIBUTED_HPP
+
+// POSIX sockets only, so not part of flare/flare.hpp
+#include "flare/distributed/ring_communicator.hpp"
+#include "flare/distributed/distributed_trainer.hpp"
+
+#endif //FLARE_INCLUDE_DISTRIBUTED_HPP
@@ -0,0 +1,407 @@
+//
+// Created by R on 10/17/26.
+//
+
+#ifndef FLARE_RING_COMMUNICATOR_HPP
+#define FLARE_RING_COMMUNICATOR_HPP
+
+#include "flare/fl_types.hpp"
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace fl
+{
+
+/**
+ * Connects N processes in a ring over TCP, each process sends to the next rank
+ * and receives from the previous one. Provides the collectives needed for
+ * data-parallel training, all processes must call them in the same order
+ *
+ * Rank r listens on base_port + r of its own host. All processes must run
+ * the same build, scalars are sent as raw bytes
+ */
+class RingCommunicator
+{
+public:
+    /**
+     * Blocks until the ring is connected
+     *
+     * @param rank         this process's position in the ring, 0 to world_size - 1
+     * @param world_size   number of processes
+     * @param hosts        address of each rank, empty for all on 127.0.0.1
+     * @param base_port    rank r listens on base_port + r
+     * @param timeout      seconds to keep retrying to reach the next rank
+     */
+    RingCommunicator(int rank, int world_size,
+                     const std::vector<std::string> &hosts = {},
+                     int base_port = 29500, int timeout = 60)
+            : rank(rank), world_size(world_size)
+    {
+        if (world_size < 1 || rank < 0 || rank >= world_size) {
+            throw std::invalid_argument(
+                    "RingCommunicator INVALID RANK " + std::to_string(rank) +
+                    " FOR WORLD SIZE " + std::to_string(world_size));
+        }
+
+        if (!hosts.empty() && hosts.size() != static_cast<size_t>(world_size)) {
+            throw std::invalid_argument(
+                    "RingCommunicator EXPECTED " + std::to_string(world_size) +
+                    " HOSTS, GOT " + std::to_string(hosts.size()));
+        }
+
+        if (world_size == 1) {
+            return; // nothing to communicate with
+        }
+
+        int next_rank = (rank + 1) % world_size;
+        std::string next_host = hosts.empty() ? "127.0.0.1" : hosts[next_rank];
+
+        // listen before connecting so neighbours can't wait on each other
+        int listen_fd = RingCommunicator::Listen(base_port + rank);
+
+        try {
+            this->next_fd = RingCommunicator::Connect(
+                    next_host, base_port + next_rank, timeout);
+            this->prev_fd = accept(listen_fd, nullptr, nullptr);
+        }
+        catch (...) {
+            close(listen_fd);
+            throw;
+        }
+
+        close(listen_fd);
+
+        if (this->prev_fd < 0) {
+            throw std::runtime_error(
+                    "RingCommunicator FAILED TO ACCEPT PREVIOUS RANK: " +
+                    std::string(std::strerror(errno)));
+        }
+
+        RingCommunicator::Configure(this->next_fd);
+        RingCommunicator::Configure(this->prev_fd);
+    }
+
+
+    RingCommunicator(const RingCommunicator &) = delete;
+
+    RingCommunicator &operator=(const RingCommunicator &) = delete;
+
+
+    ~RingCommunicator()
+    {
+        if (this->next_fd >= 0) {
+            close(this->next_fd);
+        }
+
+        if (this->prev_fd >= 0) {
+            close(this->prev_fd);
+        }
+    }
+
+
+    /**
+     * Sum data element-wise across all processes, every process receives the
+     * result. Uses the ring algorithm, reduce-scatter then all-gather, so each
+     * process sends about 2 * count values regardless of the world size
+     *
+     * @param data    values to sum, overwritten with the sums
+     * @param count   number of values, must match on every process
+     */
+    void AllReduce(Scalar *data, size_t count)
+    {
+        const size_t n = this->world_size;
+
+        if (n == 1 || count == 0) {
+            return;
+        }
+
+        // chunk c covers [offset(c), offset(c + 1)), the first chunks take the remainder
+        auto offset = [count, n](size_t chunk) {
+            return chunk * (count / n) + std::min(chunk, count % n);
+        };
+        auto size = [&offset](size_t chunk) {
+            return offset(chunk + 1) - offset(chunk);
+        };
+
+        this->buffer.resize(count / n + 1);
+
+        // reduce-scatter, after n - 1 steps chunk (rank + 1) % n holds the full sum
+        for (size_t step = 0; step < n - 1; step++) {
+            size_t send_chunk = (this->rank + n - step) % n;
+            size_t recv_chunk = (this->rank + n - step - 1) % n;
+
+            this->SendReceive(data + offset(send_chunk), size(send_chunk),
+                              this->buffer.data(), size(recv_chunk));
+
+            for (size_t i = 0; i < size(recv_chunk); i++) {
+                data[offset(recv_chunk) + i] += this->buffer[i];
+            }
+        }
+
+        // all-gather, pass the completed chunks around the ring
+        for (size_t step = 0; step < n - 1; step++) {
+            size_t send_chunk = (this->rank + 1 + n - step) % n;
+            size_t recv_chunk = (this->rank + n - step) % n;
+
+            this->SendReceive(data + offset(send_chunk), size(send_chunk),
+                              data + offset(recv_chunk), size(recv_chunk));
+        }
+    }
+
+
+    /**
+     * Copy data from the root process to every other process
+     *
+     * @param data    values to send on root, overwritten on the other processes
+     * @param count   number of values, must match on every process
+     * @param root    rank that owns the values
+     */
+    void Broadcast(Scalar *data, size_t count, int root = 0)
+    {
+        if (this->world_size == 1 || count == 0) {
+            return;
+        }
+
+        // pass the values along the ring, stopping before it returns to root
+        if (this->rank != root) {
+            this->SendReceive(nullptr, 0, data, count);
+        }
+
+        if ((this->rank + 1) % this->world_size != root) {
+            this->SendReceive(data, count, nullptr, 0);
+        }
+    }
+
+
+    /**
+     * Blocks until every process reached the barrier
+     */
+    void Barrier()
+    {
+        Scalar token = 0;
+        this->AllReduce(&token, 1);
+    }
+
+
+    int GetRank() const
+    {
+        return this->rank;
+    }
+
+
+    int GetWorldSize() const
+    {
+        return this->world_size;
+    }
+
+
+    /**
+     * Fork world_size - 1 child processes to test distributed training on one
+     * machine. Call before creating any layer or execution context, a forked
+     * child doesn't inherit the parent's worker threads
+     *
+     * @param world_size   total number of processes, including this one
+     * @return             rank of the calling process, 0 for the parent
+     */
+    static int ForkLocalProcesses(int world_size)
+    {
+        for (int rank = 1; rank < world_size; rank++) {
+            pid_t pid = fork();
+
+            if (pid < 0) {
+                throw std::runtime_error(
+                        "RingCommunicator::ForkLocalProcesses FORK FAILED: " +
+                        std::string(std::strerror(errno)));
+            }
+
+            if (pid == 0) {
+                return rank;
+            }
+        }
+
+        return 0;
+    }
+
+
+    /**
+     * Wait in the parent for all children created by ForkLocalProcesses
+     *
+     * @return   true if every child exited with status 0
+     */
+    static bool WaitForLocalProcesses()
+    {
+        bool success = true;
+        int status;
+
+        while (wait(&status) > 0) {
+            success &= WIFEXITED(status) && WEXITSTATUS(status) == 0;
+        }
+
+        return success;
+    }
+
+private:
+    static int Listen(int port)
+    {
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+
+        if (fd < 0) {
+            throw std::runtime_error("RingCommunicator FAILED TO CREATE SOCKET: " +
+                                     std::string(std::strerror(errno)));
+        }
+
+        int reuse = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+        sockaddr_in address {};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_ANY);
+        address.sin_port = htons(static_cast<uint16_t>(port));
+
+        if (bind(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0 ||
+            listen(fd, 1) < 0) {
+            std::string error = std::strerror(errno);
+            close(fd);
+            throw std::runtime_error("RingCommunicator FAILED TO LISTEN ON PORT " +
+                                     std::to_string(port) + ": " + error);
+        }
+
+        return fd;
+    }
+
+
+    static int Connect(const std::string &host, int port, int timeout)
+    {
+        addrinfo hints {};
+        hints.ai_family = AF_INET;
+        hints.ai_socktype = SOCK_STREAM;
+        addrinfo *result = nullptr;
+
+        if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints,
+                        &result) != 0 || result == nullptr) {
+            throw std::runtime_error("RingCommunicator UNABLE TO RESOLVE " + host);
+        }
+
+        // the next rank may not be listening yet, retry until the timeout
+        auto deadline = std::chrono::steady_clock::now() +
+                        std::chrono::seconds(timeout);
+
+        while (true) {
+            int fd = socket(AF_INET, SOCK_STREAM, 0);
+
+            if (fd >= 0 && connect(fd, result->ai_addr, result->ai_addrlen) == 0) {
+                freeaddrinfo(result);
+                return fd;
+            }
+
+            if (fd >= 0) {
+                close(fd);
+            }
+
+            if (std::chrono::steady_clock::now() > deadline) {
+                freeaddrinfo(result);
+                throw std::runtime_error(
+                        "RingCommunicator TIMED OUT CONNECTING TO " + host + ":" +
+                        std::to_string(port));
+            }
+
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        }
+    }
+
+
+    static void Configure(int fd)
+    {
+        int no_delay = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &no_delay, sizeof(no_delay));
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+    }
+
+
+    // send to the next rank while receiving from the previous one, both at
+    // once so a ring of blocking sends can't deadlock on full socket buffers
+    void SendReceive(const Scalar *send_data, size_t send_count,
+                     Scalar *recv_data, size_t recv_count)
+    {
+        const char *send_bytes = reinterpret_cast<const char *>(send_data);
+        char *recv_bytes = reinterpret_cast<char *>(recv_data);
+        const size_t send_total = send_count * sizeof(Scalar);
+        const size_t recv_total = recv_count * sizeof(Scalar);
+        size_t sent = 0;
+        size_t received = 0;
+
+        while (sent < send_total || received < recv_total) {
+            pollfd fds[2] = {
+                    {this->next_fd, static_cast<short>(sent < send_total ? POLLOUT : 0), 0},
+                    {this->prev_fd, static_cast<short>(received < recv_total ? POLLIN : 0), 0}};
+
+            if (poll(fds, 2, -1) < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+
+                throw std::runtime_error("RingCommunicator POLL FAILED: " +
+                                         std::string(std::strerror(errno)));
+            }
+
+            if (sent < send_total && (fds[0].revents & (POLLERR | POLLHUP))) {
+                throw std::runtime_error("RingCommunicator NEXT RANK DISCONNECTED");
+            }
+
+            if (fds[0].revents & POLLOUT) {
+                ssize_t bytes = send(this->next_fd, send_bytes + sent,
+                                     send_total - sent, MSG_NOSIGNAL);
+
+                if (bytes < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+                    throw std::runtime_error("RingCommunicator SEND FAILED: " +
+                                             std::string(std::strerror(errno)));
+                }
+
+                sent += bytes > 0 ? bytes : 0;
+            }
+
+            if (fds[1].revents & (POLLIN | POLLHUP | POLLERR)) {
+                ssize_t bytes = recv(this->prev_fd, recv_bytes + received,
+                                     recv_total - received, 0);
+
+                if (bytes == 0) {
+                    throw std::runtime_error(
+                            "RingCommunicator PREVIOUS RANK DISCONNECTED");
+                }
+
+                if (bytes < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+                    throw std::runtime_error("RingCommunicator RECEIVE FAILED: " +
+                                             std::string(std::strerror(errno)));
+                }
+
+                received += bytes > 0 ? bytes : 0;
+            }
+        }
+    }
+
+
+    int rank;
+    int world_size;
+    int next_fd = -1; // socket to rank + 1
+    int prev_fd = -1; // socket from rank - 1
+    std::vector<Scalar> buffer; // receives chunks during reduce-scatter
+};
+
+} // namespace fl
+
+#endif //FLARE_RING_COMMUNICATOR_HPP
@@ -0,0 +1,215 @@
+//
+// Created by R on 10/17/26.
+//
+
+#ifndef FLARE_EXECUTION_CONTEXT_HPP
+#define FLARE_EXECUTION_CONTEXT_HPP
+
+#include "flare/fl_types.hpp"
+#include "flare/tensor_arena.hpp"
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__) && !defined(FLARE_DO_NOT_USE_THREADS)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace fl
+{
+
+/**
+ * Owns the thread pool and the device that evaluate tensor operations.
+ *
+ * One context is shared by a model's layers, optimizer, loss and metrics so the
+ * process runs a single set of worker threads instead of one pool per object.
+ * Anything not given a context uses the process-wide ExecutionContext::Default()
+ *
+ * Temporaries of the device's tensor operations are recycled by the context's
+ * TensorArena, so a model on its own context also has its own arena
+ *
+ * With FLARE_DO_NOT_USE_THREADS defined there is no pool, tensor operations run
+ * on the calling thread and the thread count is always 1
+ */
+class ExecutionContext
+{
+public:
+    /**
+     * @param threads   number of worker threads, defaults to hardware concurrency
+     * @param cpus      CPU ids to pin the worker threads to, round-robin, leave
+     *                  empty to let the OS schedule them (pinning is Linux only)
+     */
+    explicit ExecutionContext(int threads = ExecutionContext::HardwareThreads(),
+                              const std::vector<int> &cpus = {})
+#ifndef FLARE_DO_NOT_USE_THREADS
+            : pool(ExecutionContext::CreatePool(std::max(threads, 1), cpus)),
+              device(this->pool.get(), std::max(threads, 1), &this->arena)
+#endif
+    {
+        if (threads < 1) {
+            throw std::invalid_argument(
+                    "ExecutionContext THREADS MUST BE POSITIVE, GOT " +
+                    std::to_string(threads));
+        }
+    }
+
+
+    ExecutionContext(const ExecutionContext &) = delete;
+
+    ExecutionContext &operator=(const ExecutionContext &) = delete;
+
+
+    /**
+     * @return   process-wide context sized to the hardware concurrency, created
+     *           on first use
+     */
+    static ExecutionContext &Default()
+    {
+        static ExecutionContext context;
+        return context;
+    }
+
+
+    const Device &GetDevice() const
+    {
+        return this->device;
+    }
+
+
+    /**
+     * @return   the allocator of the device's temporaries, e.g. to check that a
+     *           step after warmup made no HeapAllocations()
+     */
+    TensorArena &GetArena()
+    {
+        return this->arena;
+    }
+
+
+    int GetThreads() const
+    {
+#ifndef FLARE_DO_NOT_USE_THREADS
+        return this->device.numThreads();
+#else
+        return 1;
+#endif
+    }
+
+
+    static int HardwareThreads()
+    {
+        int threads = static_cast<int>(std::thread::hardware_concurrency());
+        return threads > 0 ? threads : 1;
+    }
+
+
+    /**
+     * Read the CPUs belonging to a NUMA node from sysfs, to be passed as the
+     * cpus argument when a model should stay on one node
+     *
+     * @param node   NUMA node id
+     * @return       CPU ids of the node
+     */
+    static std::vector<int> NumaNodeCpus(int node)
+    {
+        std::ifstream file("/sys/devices/system/node/node" +
+                           std::to_string(node) + "/cpulist");
+
+        if (!file.is_open()) {
+            throw std::invalid_argument(
+                    "ExecutionContext::NumaNodeCpus UNABLE TO READ CPUS OF NODE " +
+                    std::to_string(node));
+        }
+
+        // cpulist format is a comma separated list of ids and ranges, "0-3,8,10-11"
+        std::vector<int> cpus;
+        std::string range;
+
+        while (std::getline(file, range, ',')) {
+            std::istringstream range_stream(range);
+            int first, last;
+            char dash;
+
+            if (!(range_stream >> first)) {
+                continue;
+            }
+
+            if (!(range_stream >> dash >> last)) {
+                last = first;
+            }
+
+            for (int cpu = first; cpu <= last; cpu++) {
+                cpus.push_back(cpu);
+            }
+        }
+
+        return cpus;
+    }
+
+private:
+    // declared first, outlives the device and the pool's threads
+    TensorArena arena;
+
+#ifndef FLARE_DO_NOT_USE_THREADS
+    /**
+     * Thread environment that pins each worker thread to the next CPU of the set
+     * before it starts running pool tasks
+     */
+    struct PinnedThreadEnvironment : Eigen::StlThreadEnvironment
+    {
+        explicit PinnedThreadEnvironment(std::vector<int> cpus)
+                : cpus(std::make_shared<const std::vector<int>>(std::move(cpus))),
+                  next(std::make_shared<std::atomic<size_t>>(0))
+        {
+            // nothing to do
+        }
+
+
+        EnvThread *CreateThread(std::function<void()> f)
+        {
+            int cpu = (*this->cpus)[this->next->fetch_add(1) % this->cpus->size()];
+
+            return new EnvThread([cpu, f = std::move(f)]() {
+#ifdef __linux__
+                cpu_set_t cpu_set;
+                CPU_ZERO(&cpu_set);
+                CPU_SET(cpu, &cpu_set);
+                pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+#endif
+                f();
+            });
+        }
+
+
+        // the environment is copied into the pool, copies share the cpu counter
+        std::shared_ptr<const std::vector<int>> cpus;
+        std::shared_ptr<std::atomic<size_t>> next;
+    };
+
+
+    static std::unique_ptr<Eigen::ThreadPoolInterface>
+    CreatePool(int threads, const std::vector<int> &cpus)
+    {
+        if (cpus.empty()) {
+            return std::make_unique<Eigen::ThreadPool>(threads);
+        }
+
+        return std::make_unique<Eigen::ThreadPoolTempl<PinnedThreadEnvironment>>(
+                threads, true, PinnedThreadEnvironment(cpus));
+    }
+
+
+    std::unique_ptr<Eigen::ThreadPoolInterface> pool;
+#endif
+
+    Device device;
+};
+
+} // namespace fl
+
+#endif //FLARE_EXECUTION_CONTEXT_HPP
@@ -58,6 +58,13 @@ using TensorMapConst = Eigen::TensorMap<const Tensor<TensorRank>>;
 using ContractDim = Eigen::array<Eigen::IndexPair<int>, 1>;
 using Axes = Eigen::IndexPair<int>;
 
+// device that evaluates tensor expressions, single threaded without a thread pool
+#ifndef FLARE_DO_NOT_USE_THREADS
+using Device = Eigen::ThreadPoolDevice;
+#else
+using Device = Eigen::DefaultDevice;
+#endif
+
 }
 
 
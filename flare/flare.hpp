@@ -7,6 +7,7 @@
 
 #include "fl_types.hpp"
 #include "fl_assert.hpp"
+#include "execution_context.hpp"
 
 
 #include "activations/include_activations.hpp"
@@ -18,7 +19,10 @@
 
 
 #include "sequential.hpp"
+#include "profiler.hpp"
+#include "timeline.hpp"
 #include "dataset.hpp"
+#include "data_loader.hpp"
 #include "tokenizer.hpp"
 
 
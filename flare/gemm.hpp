@@ -0,0 +1,373 @@
+//
+// Created by R on 10/18/26.
+//
+
+#ifndef FLARE_GEMM_HPP
+#define FLARE_GEMM_HPP
+
+#include "flare/fl_types.hpp"
+#include <algorithm>
+#include <type_traits>
+#include <vector>
+
+#if defined(__AVX512F__) || (defined(__AVX2__) && defined(__FMA__))
+#include <immintrin.h>
+#endif
+
+namespace fl
+{
+
+/**
+ * How a layer multiplies its inputs with its weights
+ *
+ * CONTRACTION   Eigen tensor contraction, packs both operands on every call
+ * PACKED        Gemm on weights packed once per update, for small batches where
+ *               the contraction's packing and dispatch dominate
+ */
+enum class GemmBackend
+{
+    CONTRACTION, PACKED
+};
+
+
+/**
+ * Register-blocked SIMD tile of the Gemm microkernel, AVX-512 or AVX2 + FMA
+ * when the compiler targets them (e.g. FLARE_NATIVE), plain loops otherwise
+ */
+struct GemmSimd
+{
+#if defined(__AVX512F__)
+#ifdef FLARE_FLOAT
+    using Register = __m512;
+    static constexpr int width = 16;
+    static Register Zero() { return _mm512_setzero_ps(); }
+    static Register Load(const Scalar *p) { return _mm512_loadu_ps(p); }
+    static void Store(Scalar *p, Register r) { _mm512_storeu_ps(p, r); }
+    static Register Broadcast(Scalar s) { return _mm512_set1_ps(s); }
+    static Register Fma(Register a, Register b, Register c) { return _mm512_fmadd_ps(a, b, c); }
+#else
+    using Register = __m512d;
+    static constexpr int width = 8;
+    static Register Zero() { return _mm512_setzero_pd(); }
+    static Register Load(const Scalar *p) { return _mm512_loadu_pd(p); }
+    static void Store(Scalar *p, Register r) { _mm512_storeu_pd(p, r); }
+    static Register Broadcast(Scalar s) { return _mm512_set1_pd(s); }
+    static Register Fma(Register a, Register b, Register c) { return _mm512_fmadd_pd(a, b, c); }
+#endif
+    static constexpr int rows = 8; // 16 of the 32 registers hold the tile
+#elif defined(__AVX2__) && defined(__FMA__)
+#ifdef FLARE_FLOAT
+    using Register = __m256;
+    static constexpr int width = 8;
+    static Register Zero() { return _mm256_setzero_ps(); }
+    static Register Load(const Scalar *p) { return _mm256_loadu_ps(p); }
+    static void Store(Scalar *p, Register r) { _mm256_storeu_ps(p, r); }
+    static Register Broadcast(Scalar s) { return _mm256_set1_ps(s); }
+    static Register Fma(Register a, Register b, Register c) { return _mm256_fmadd_ps(a, b, c); }
+#else
+    using Register = __m256d;
+    static constexpr int width = 4;
+    static Register Zero() { return _mm256_setzero_pd(); }
+    static Register Load(const Scalar *p) { return _mm256_loadu_pd(p); }
+    static void Store(Scalar *p, Register r) { _mm256_storeu_pd(p, r); }
+    static Register Broadcast(Scalar s) { return _mm256_set1_pd(s); }
+    static Register Fma(Register a, Register b, Register c) { return _mm256_fmadd_pd(a, b, c); }
+#endif
+    static constexpr int rows = 6; // 12 of the 16 registers hold the tile
+#else
+    static constexpr int width = 16 / sizeof(Scalar);
+
+    struct Register
+    {
+        Scalar v[width];
+    };
+
+    static Register Zero() { return Register {}; }
+
+    static Register Load(const Scalar *p)
+    {
+        Register r;
+        std::copy_n(p, width, r.v);
+        return r;
+    }
+
+    static void Store(Scalar *p, const Register &r) { std::copy_n(r.v, width, p); }
+
+    static Register Broadcast(Scalar s)
+    {
+        Register r;
+        std::fill_n(r.v, width, s);
+        return r;
+    }
+
+    static Register Fma(const Register &a, const Register &b, Register c)
+    {
+        for (int i = 0; i < width; i++) {
+            c.v[i] += a.v[i] * b.v[i];
+        }
+
+        return c;
+    }
+
+    static constexpr int rows = 4;
+#endif
+    static constexpr int cols = 2 * width;
+};
+
+
+/**
+ * Right-hand side of a Gemm, a rows x cols matrix rearranged into panels of
+ * GemmSimd::cols columns. Within a panel each row's columns are contiguous so
+ * the microkernel streams through it, the last panel is zero padded
+ *
+ * Weights are packed once after they change and reused by every Forward
+ */
+class PackedMatrix
+{
+public:
+    /**
+     * Pack the matrix whose element (r, c) is source[r * row_stride + c * col_stride]
+     */
+    void Pack(const Scalar *source, Eigen::Index rows, Eigen::Index cols,
+              Eigen::Index row_stride, Eigen::Index col_stride)
+    {
+        constexpr Eigen::Index nr = GemmSimd::cols;
+        this->rows = rows;
+        this->cols = cols;
+        this->data.assign(this->Panels() * rows * nr, 0);
+
+        for (Eigen::Index p = 0; p < this->Panels(); p++) {
+            Scalar *panel = this->data.data() + p * rows * nr;
+            const Eigen::Index panel_cols = std::min(nr, cols - p * nr);
+
+            for (Eigen::Index r = 0; r < rows; r++) {
+                for (Eigen::Index c = 0; c < panel_cols; c++) {
+                    panel[r * nr + c] =
+                            source[r * row_stride + (p * nr + c) * col_stride];
+                }
+            }
+        }
+    }
+
+
+    // pack a row major matrix
+    void Pack(const Tensor<2> &matrix)
+    {
+        this->Pack(matrix.data(), matrix.dimension(0), matrix.dimension(1),
+                   matrix.dimension(1), 1);
+    }
+
+
+    // pack the transpose of a row major matrix
+    void PackTransposed(const Tensor<2> &matrix)
+    {
+        this->Pack(matrix.data(), matrix.dimension(1), matrix.dimension(0), 1,
+                   matrix.dimension(1));
+    }
+
+
+    Eigen::Index Rows() const
+    {
+        return this->rows;
+    }
+
+
+    Eigen::Index Cols() const
+    {
+        return this->cols;
+    }
+
+
+    Eigen::Index Panels() const
+    {
+        return (this->cols + GemmSimd::cols - 1) / GemmSimd::cols;
+    }
+
+
+    const Scalar *Panel(Eigen::Index p) const
+    {
+        return this->data.data() + p * this->rows * GemmSimd::cols;
+    }
+
+
+    size_t Bytes() const
+    {
+        return this->data.size() * sizeof(Scalar);
+    }
+
+private:
+    Eigen::Index rows = 0;
+    Eigen::Index cols = 0;
+    std::vector<Scalar> data;
+};
+
+
+/**
+ * C = A * B for a small or medium A and a packed B. Column panels of B are
+ * spread over the device's threads, each panel is walked in blocks of depth
+ * that fit in L1 and multiplied with GemmSimd::rows rows of A at a time,
+ * the tile of C stays in registers for the whole block
+ *
+ * Only for row major tensors, FLARE_COLMAJOR builds use the contraction
+ */
+class Gemm
+{
+public:
+    static constexpr bool available =
+            static_cast<int>(Tensor<2>::Layout) == Eigen::RowMajor;
+
+    // does nothing to C after it's computed
+    struct NoEpilogue
+    {
+        void operator()(Scalar *, Eigen::Index, Eigen::Index, Eigen::Index,
+                        Eigen::Index) const
+        {}
+    };
+
+
+    /**
+     * @param m          rows of A and C
+     * @param a          A, element (r, k) is a[r * a_row_stride + k * a_col_stride]
+     * @param b          B, packed
+     * @param c          C, row major with leading dimension ldc
+     * @param epilogue   epilogue(c + col, ldc, col, m, cols) is called once the
+     *                   columns [col, col + cols) of C are final, while they are
+     *                   still in cache
+     */
+    template<typename DeviceType, typename Epilogue = NoEpilogue>
+    static void Run(Eigen::Index m, const Scalar *a, Eigen::Index a_row_stride,
+                    Eigen::Index a_col_stride, const PackedMatrix &b, Scalar *c,
+                    Eigen::Index ldc, const DeviceType &device,
+                    Epilogue &&epilogue = Epilogue())
+    {
+        constexpr Eigen::Index nr = GemmSimd::cols;
+        constexpr Eigen::Index mr = GemmSimd::rows;
+        const Eigen::Index k = b.Rows();
+        const Eigen::Index n = b.Cols();
+
+        auto run_panels = [&](Eigen::Index first, Eigen::Index last) {
+            for (Eigen::Index p = first; p < last; p++) {
+                const Eigen::Index col = p * nr;
+                const Eigen::Index cols = std::min(nr, n - col);
+
+                for (Eigen::Index kb = 0; kb < k; kb += Gemm::depth) {
+                    const Eigen::Index kc = std::min(Gemm::depth, k - kb);
+                    const Scalar *panel = b.Panel(p) + kb * nr;
+
+                    for (Eigen::Index i = 0; i < m; i += mr) {
+                        Gemm::Tile<mr>(std::min(mr, m - i), kc,
+                                       a + i * a_row_stride + kb * a_col_stride,
+                                       a_row_stride, a_col_stride, panel,
+                                       c + i * ldc + col, ldc, cols, kb > 0);
+                    }
+                }
+
+                epilogue(c + col, ldc, col, m, cols);
+            }
+        };
+
+#ifndef FLARE_DO_NOT_USE_THREADS
+        if constexpr (std::is_same_v<DeviceType, Eigen::ThreadPoolDevice>) {
+            const double flops = 2.0 * m * k * nr;
+
+            // parallelFor takes a std::function, one captured reference fits in
+            // it without a heap allocation, run_panels' captures don't
+            device.parallelFor(b.Panels(), Eigen::TensorOpCost(
+                                       (m + nr) * k * sizeof(Scalar),
+                                       m * nr * sizeof(Scalar), flops),
+                               [&run_panels](Eigen::Index first, Eigen::Index last) {
+                                   run_panels(first, last);
+                               });
+            return;
+        }
+#endif
+        run_panels(0, b.Panels());
+    }
+
+private:
+    // depth of a block, keeps a block of a panel (depth x cols) in L1
+    static constexpr Eigen::Index depth = 16384 / (GemmSimd::cols * sizeof(Scalar));
+
+
+    // picks the tile height, rows <= Rows
+    template<int Rows>
+    static void Tile(Eigen::Index rows, Eigen::Index kc, const Scalar *a,
+                     Eigen::Index a_row_stride, Eigen::Index a_col_stride,
+                     const Scalar *panel, Scalar *c, Eigen::Index ldc,
+                     Eigen::Index cols, bool accumulate)
+    {
+        if constexpr (Rows > 1) {
+            if (rows < Rows) {
+                Gemm::Tile<Rows - 1>(rows, kc, a, a_row_stride, a_col_stride, panel,
+                                     c, ldc, cols, accumulate);
+                return;
+            }
+        }
+
+        Gemm::Microkernel<Rows>(kc, a, a_row_stride, a_col_stride, panel, c, ldc,
+                                cols, accumulate);
+    }
+
+
+    // C[Rows, cols] (+)= A[Rows, kc] * panel[kc, cols], cols <= GemmSimd::cols
+    template<int Rows>
+    static void Microkernel(Eigen::Index kc, const Scalar *a,
+                            Eigen::Index a_row_stride, Eigen::Index a_col_stride,
+                            const Scalar *panel, Scalar *c, Eigen::Index ldc,
+                            Eigen::Index cols, bool accumulate)
+    {
+        using S = GemmSimd;
+        constexpr int nr = S::cols;
+
+        // a partial tile goes through a buffer so the stores stay in bounds
+        Scalar buffer[Rows * nr];
+        Scalar *tile = c;
+        Eigen::Index tile_ld = ldc;
+
+        if (cols < nr) {
+            tile = buffer;
+            tile_ld = nr;
+            std::fill_n(buffer, Rows * nr, 0);
+
+            for (int r = 0; r < Rows; r++) {
+                if (accumulate) {
+                    std::copy_n(c + r * ldc, cols, buffer + r * nr);
+                }
+            }
+        }
+
+        typename S::Register acc[Rows][2];
+
+        for (int r = 0; r < Rows; r++) {
+            acc[r][0] = accumulate ? S::Load(tile + r * tile_ld) : S::Zero();
+            acc[r][1] = accumulate ? S::Load(tile + r * tile_ld + S::width) : S::Zero();
+        }
+
+        for (Eigen::Index k = 0; k < kc; k++) {
+            const typename S::Register b0 = S::Load(panel + k * nr);
+            const typename S::Register b1 = S::Load(panel + k * nr + S::width);
+
+            for (int r = 0; r < Rows; r++) {
+                const typename S::Register a_rk =
+                        S::Broadcast(a[r * a_row_stride + k * a_col_stride]);
+                acc[r][0] = S::Fma(a_rk, b0, acc[r][0]);
+                acc[r][1] = S::Fma(a_rk, b1, acc[r][1]);
+            }
+        }
+
+        for (int r = 0; r < Rows; r++) {
+            S::Store(tile + r * tile_ld, acc[r][0]);
+            S::Store(tile + r * tile_ld + S::width, acc[r][1]);
+        }
+
+        if (cols < nr) {
+            for (int r = 0; r < Rows; r++) {
+                std::copy_n(buffer + r * nr, cols, c + r * ldc);
+            }
+        }
+    }
+};
+
+} // namespace fl
+
+#endif //FLARE_GEMM_HPP
@@ -6,6 +6,9 @@
 #define FLARE_ACTIVATION_H
 
 #include "layer.hpp"
+#include "flare/parallel.hpp"
+#include "flare/activations/linear.hpp"
+#include "flare/activations/relu.hpp"
 
 namespace fl
 {
@@ -26,6 +29,14 @@ public:
 
     void Update(Optimizer &) override;
 
+    Layer *Clone() const override;
+
+    size_t GetTensorBytes() const override;
+
+    void SetInferenceOnly(bool inference_only) override;
+
+    bool GetLeak(Scalar &leak) const override;
+
     const Tensor<2> &GetOutput2D() const override;
 
     const Tensor<3> &GetOutput3D() const override;
@@ -39,15 +50,13 @@ public:
     const Tensor<4> &GetInputGradients4D() override;
 
 protected:
-    Tensor<TensorRank> X;
+    LayerInput<TensorRank> X;
     Tensor<TensorRank> Z;
     Tensor<TensorRank> dL_dZ;
     Tensor<TensorRank> dL_dX;
 
-    // multithreading
-    Eigen::ThreadPool pool = Eigen::ThreadPool(
-            (int) std::thread::hardware_concurrency());
-    Eigen::ThreadPoolDevice device = Eigen::ThreadPoolDevice(&pool, 2);
+    // Softmax's Jacobians, kept between steps
+    Tensor<TensorRank + 1> softmax_grad;
 };
 
 } // namespace fl
@@ -8,9 +8,7 @@ namespace fl
 {
 
 template<typename activation, int TensorRank>
-Activation<activation, TensorRank>::Activation():
-        pool((int) std::thread::hardware_concurrency()),
-        device(&pool, 2)
+Activation<activation, TensorRank>::Activation()
 {
     this->name = "activation";
     this->input_rank = TensorRank;
@@ -21,10 +19,21 @@ Activation<activation, TensorRank>::Activation():
 template<typename activation, int TensorRank>
 void Activation<activation, TensorRank>::Forward(const Tensor <TensorRank> &inputs)
 {
-    this->X.resize(inputs.dimensions());
-    this->X.device(this->device) = inputs;
+    if (!this->inference_only) {
+        this->X.Set(inputs, this->borrow_input, this->device);
+    }
+
     this->Z.resize(inputs.dimensions());
-    this->Z.device(this->device) = activation::Activate(inputs);
+
+    if constexpr (std::is_same_v<activation, Softmax>) {
+        Softmax::Activate(inputs, this->Z, this->device);
+    }
+    else if constexpr (std::is_same_v<activation, Linear>) {
+        ParallelCopy(this->device, inputs, this->Z);
+    }
+    else {
+        this->Z.device(this->device) = activation::Activate(inputs);
+    }
 }
 
 
@@ -56,7 +65,7 @@ void Activation<activation, TensorRank>::Backward(
                          << this->Z.dimensions() << ", instead got "
                          << gradients.dimensions());
     this->dL_dZ.resize(gradients.dimensions());
-    this->dL_dZ.device(this->device) = gradients;
+    ParallelCopy(this->device, gradients, this->dL_dZ);
 }
 
 
@@ -88,6 +97,49 @@ void Activation<activation, TensorRank>::Update(Optimizer &)
 }
 
 
+template<typename activation, int TensorRank>
+Layer *Activation<activation, TensorRank>::Clone() const
+{
+    return new Activation<activation, TensorRank>(*this);
+}
+
+
+template<typename activation, int TensorRank>
+bool Activation<activation, TensorRank>::GetLeak(Scalar &leak) const
+{
+    if constexpr (std::is_same_v<activation, ReLU>) {
+        leak = 0;
+        return true;
+    }
+    else if constexpr (std::is_same_v<activation, Linear>) {
+        leak = 1;
+        return true;
+    }
+    else {
+        return false;
+    }
+}
+
+
+template<typename activation, int TensorRank>
+size_t Activation<activation, TensorRank>::GetTensorBytes() const
+{
+    return Layer::TensorBytes(this->X, this->Z, this->dL_dZ, this->dL_dX,
+                              this->softmax_grad);
+}
+
+
+template<typename activation, int TensorRank>
+void Activation<activation, TensorRank>::SetInferenceOnly(bool inference_only)
+{
+    Layer::SetInferenceOnly(inference_only);
+
+    if (inference_only) {
+        Layer::FreeTensors(this->X, this->dL_dZ, this->dL_dX, this->softmax_grad);
+    }
+}
+
+
 template<typename activation, int TensorRank>
 const Tensor<2> &Activation<activation, TensorRank>::GetOutput2D() const
 {
@@ -136,28 +188,26 @@ const Tensor<2> &Activation<activation, TensorRank>::GetInputGradients2D()
                 std::to_string(TensorRank) + " TENSOR");
     }
     else if constexpr(std::is_same_v<activation, Softmax>) {
-        Tensor<3> softmax_grad(this->Z.dimension(0), this->Z.dimension(1),
-                               this->Z.dimension(1));
-        softmax_grad = Softmax::Gradients(this->Z);
+        Softmax::Gradients(this->Z, this->softmax_grad, this->device);
 
-        this->dL_dX.resize(this->X.dimensions());
+        this->dL_dX.resize(this->X->dimensions());
 
         ContractDim matmul {Axes(0, 1)};
 
-#ifdef _OPENMP
-#pragma omp parallel for num_threads(2) default(none) shared(softmax_grad, matmul)
-#endif
-        for (int a = 0; a < this->dL_dZ.dimension(0); a++) {
+        const Eigen::Index features = this->dL_dZ.dimension(1);
+
+        ParallelFor(this->device, this->dL_dZ.dimension(0),
+                    features * features, [&](Eigen::Index a) {
             this->dL_dX.chip(a, 0) = this->dL_dZ.chip(a, 0)
-                    .contract(softmax_grad.chip(a, 0), matmul);
-        }
+                    .contract(this->softmax_grad.chip(a, 0), matmul);
+        });
     }
     else {
         // forward pass: z = g(x)
         // backward pass (input): dL/dX = dL/dZ * dZ/dX = dL/dZ * g'(x)
-        this->dL_dX.resize(this->X.dimensions());
+        this->dL_dX.resize(this->X->dimensions());
         this->dL_dX.template device(this->device) =
-                this->dL_dZ * activation::Gradients(this->X);
+                this->dL_dZ * activation::Gradients(*this->X);
     }
 
     return this->dL_dX;
@@ -173,31 +223,30 @@ const Tensor<3> &Activation<activation, TensorRank>::GetInputGradients3D()
                 std::to_string(TensorRank) + " TENSOR");
     }
     else if constexpr(std::is_same_v<activation, Softmax>) {
-        Tensor<4> softmax_grad(this->Z.dimension(0), this->Z.dimension(1),
-                               this->Z.dimension(2), this->Z.dimension(2));
-        softmax_grad = Softmax::Gradients(this->Z);
+        Softmax::Gradients(this->Z, this->softmax_grad, this->device);
 
-        this->dL_dX.resize(this->X.dimensions());
+        this->dL_dX.resize(this->X->dimensions());
 
         ContractDim matmul {Axes(0, 1)};
 
-#ifdef _OPENMP
-#pragma omp parallel for num_threads(2) default(none) shared(softmax_grad, matmul)
-#endif
-        for (int a = 0; a < this->dL_dZ.dimension(0); a++) {
-            for (int b = 0; b < this->dL_dZ.dimension(1); b++) {
-                this->dL_dX.chip(a, 0).chip(b, 0) =
-                        this->dL_dZ.chip(a, 0).chip(b, 0)
-                                .contract(softmax_grad.chip(a, 0).chip(b, 0),
-                                          matmul);
+        const Eigen::Index dim_b = this->dL_dZ.dimension(1);
+        const Eigen::Index features = this->dL_dZ.dimension(2);
+
+        ParallelFor(this->device, this->dL_dZ.dimension(0) * dim_b,
+                    features * features, [&](Eigen::Index i) {
+            Eigen::Index a = i / dim_b;
+            Eigen::Index b = i % dim_b;
 
-            }
-        }
+            this->dL_dX.chip(a, 0).chip(b, 0) =
+                    this->dL_dZ.chip(a, 0).chip(b, 0)
+                            .contract(this->softmax_grad.chip(a, 0).chip(b, 0),
+                                      matmul);
+        });
     }
     else {
-        this->dL_dX.resize(this->X.dimensions());
+        this->dL_dX.resize(this->X->dimensions());
         this->dL_dX.template device(this->device) =
-                this->dL_dZ * activation::Gradients(this->X);
+                this->dL_dZ * activation::Gradients(*this->X);
     }
 
     return this->dL_dX;
@@ -213,37 +262,36 @@ const Tensor<4> &Activation<activation, TensorRank>::GetInputGradients4D()
                 std::to_string(TensorRank) + " TENSOR");
     }
     else if constexpr(std::is_same_v<activation, Softmax>) {
-        Tensor<5> softmax_grad(this->Z.dimension(0), this->Z.dimension(1),
-                               this->Z.dimension(2), this->Z.dimension(3),
-                               this->Z.dimension(3));
-        softmax_grad = Softmax::Gradients(this->Z);
+        Softmax::Gradients(this->Z, this->softmax_grad, this->device);
 
-        this->dL_dX.resize(this->X.dimensions());
+        this->dL_dX.resize(this->X->dimensions());
 
         ContractDim matmul {Axes(0, 1)};
 
-#ifdef _OPENMP
-#pragma omp parallel for num_threads(2) default(none) shared(softmax_grad, matmul)
-#endif
-        for (int a = 0; a < this->dL_dZ.dimension(0); a++) {
-            for (int b = 0; b < this->dL_dZ.dimension(1); b++) {
-                for (int c = 0; c < this->dL_dZ.dimension(2); c++) {
-                    this->dL_dX.chip(a, 0).chip(b, 0).chip(c, 0) =
-                            this->dL_dZ.chip(a, 0)
-                                    .chip(b, 0)
-                                    .chip(c, 0)
-                                    .contract(softmax_grad
-                                                      .chip(a, 0)
-                                                      .chip(b, 0)
-                                                      .chip(c, 0), matmul);
-                }
-            }
-        }
+        const Eigen::Index dim_b = this->dL_dZ.dimension(1);
+        const Eigen::Index dim_c = this->dL_dZ.dimension(2);
+        const Eigen::Index features = this->dL_dZ.dimension(3);
+
+        ParallelFor(this->device, this->dL_dZ.dimension(0) * dim_b * dim_c,
+                    features * features, [&](Eigen::Index i) {
+            Eigen::Index a = i / (dim_b * dim_c);
+            Eigen::Index b = i / dim_c % dim_b;
+            Eigen::Index c = i % dim_c;
+
+            this->dL_dX.chip(a, 0).chip(b, 0).chip(c, 0) =
+                    this->dL_dZ.chip(a, 0)
+                            .chip(b, 0)
+                            .chip(c, 0)
+                            .contract(this->softmax_grad
+                                              .chip(a, 0)
+                                              .chip(b, 0)
+                                              .chip(c, 0), matmul);
+        });
     }
     else {
-        this->dL_dX.resize(this->X.dimensions());
+        this->dL_dX.resize(this->X->dimensions());
         this->dL_dX.template device(this->device) =
-                this->dL_dZ * activation::Gradients(this->X);
+                this->dL_dZ * activation::Gradients(*this->X);
     }
 
     return this->dL_dX;
@@ -29,6 +29,19 @@ public:
 
     void Update(Optimizer &opt) override;
 
+    std::vector<TensorMap<1>> GetParameters() override;
+
+    std::vector<TensorMap<1>> GetParameterGradients() override;
+
+    Layer *Clone() const override;
+
+    size_t GetTensorBytes() const override;
+
+    void SetInferenceOnly(bool inference_only) override;
+
+    // channel normalization of the moving statistics outside training
+    bool GetChannelAffine(Tensor<1> &scale, Tensor<1> &shift) const override;
+
     const Tensor<2> &GetOutput2D() const override;
 
     const Tensor<3> &GetOutput3D() const override;
@@ -59,7 +72,7 @@ public:
 private:
     void CalculateInputGradients(const Tensor<TensorRank> &gradients);
 
-    Tensor<TensorRank> X; // inputs
+    LayerInput<TensorRank> X; // inputs
     Tensor<TensorRank> X_norm;
     Tensor<TensorRank> Z; // outputs
 
@@ -87,10 +100,6 @@ private:
     Dims<TensorRank> restore_bcast;
     Dims<TensorRank - NormDimCount> collapsed_dims; // dimensions not in norm_axes
 
-    // multithreading
-    Eigen::ThreadPool pool = Eigen::ThreadPool((int) std::thread::hardware_concurrency());
-    Eigen::ThreadPoolDevice device = Eigen::ThreadPoolDevice(&pool, 2);
-
     // false for inference, true for training
     bool training_mode = false;
 };
@@ -38,14 +38,12 @@ template<int TensorRank, int NormDimCount>
 void BatchNormalization<TensorRank, NormDimCount>::Forward(
         const Tensor<TensorRank> &inputs)
 {
-    this->X.resize(inputs.dimensions());
-    this->X.device(this->device) = inputs;
+    if (!this->inference_only) {
+        this->X.Set(inputs, this->borrow_input, this->device);
+    }
 
     // this resizing is required for multithreading
-    this->X_norm.resize(inputs.dimensions());
     this->Z.resize(inputs.dimensions());
-    this->input_minus_mean.resize(inputs.dimensions());
-    this->variance_plus_epsilon.resize(inputs.dimensions());
 
     if (!this->weights_are_set) [[unlikely]] {
         Dims<NormDimCount> weight_dims;
@@ -83,6 +81,8 @@ void BatchNormalization<TensorRank, NormDimCount>::Forward(
     if (this->training_mode) {
         // the following implements Algorithm 1 of the batch normalization paper
         // by Sergey Ioffe and Christian Szegedy
+        this->input_minus_mean.resize(inputs.dimensions());
+        this->variance_plus_epsilon.resize(inputs.dimensions());
 
         // mini-batch mean, cached for reuse in backpropagation
         this->input_minus_mean.template device(this->device) =
@@ -199,7 +199,7 @@ void BatchNormalization<TensorRank, NormDimCount>::Backward(
                          << gradients.dimensions());
 
     this->dL_dZ.resize(gradients.dimensions());
-    this->dL_dZ.device(this->device) = gradients;
+    ParallelCopy(this->device, gradients, this->dL_dZ);
 
     // TODO: resize and use device for evaluation
     this->dL_dy = (this->dL_dZ * this->X_norm).sum(this->collapsed_dims);
@@ -220,6 +220,93 @@ void BatchNormalization<TensorRank, NormDimCount>::Update(Optimizer &opt)
 }
 
 
+template<int TensorRank, int NormDimCount>
+std::vector<TensorMap<1>> BatchNormalization<TensorRank, NormDimCount>::GetParameters()
+{
+    std::vector<TensorMap<1>> parameters;
+
+    if (this->scale) {
+        parameters.push_back(Layer::FlatView(this->gamma));
+    }
+
+    if (this->center) {
+        parameters.push_back(Layer::FlatView(this->beta));
+    }
+
+    return parameters;
+}
+
+
+template<int TensorRank, int NormDimCount>
+std::vector<TensorMap<1>> BatchNormalization<TensorRank, NormDimCount>::GetParameterGradients()
+{
+    std::vector<TensorMap<1>> gradients;
+
+    if (this->scale) {
+        gradients.push_back(Layer::FlatView(this->dL_dy));
+    }
+
+    if (this->center) {
+        gradients.push_back(Layer::FlatView(this->dL_db));
+    }
+
+    return gradients;
+}
+
+
+template<int TensorRank, int NormDimCount>
+Layer *BatchNormalization<TensorRank, NormDimCount>::Clone() const
+{
+    return new BatchNormalization<TensorRank, NormDimCount>(*this);
+}
+
+
+template<int TensorRank, int NormDimCount>
+void BatchNormalization<TensorRank, NormDimCount>::SetInferenceOnly(bool inference_only)
+{
+    Layer::SetInferenceOnly(inference_only);
+
+    if (inference_only) {
+        // inference normalizes with the moving statistics, the batch's are
+        // only cached for Backward
+        Layer::FreeTensors(this->X, this->X_norm, this->dL_dZ, this->dL_db,
+                           this->dL_dy, this->dL_dX, this->input_minus_mean,
+                           this->variance_plus_epsilon);
+    }
+}
+
+
+template<int TensorRank, int NormDimCount>
+bool BatchNormalization<TensorRank, NormDimCount>::GetChannelAffine(
+        Tensor<1> &scale, Tensor<1> &shift) const
+{
+    if constexpr (NormDimCount == 1) {
+        if (!this->weights_are_set || this->training_mode ||
+            this->norm_axes[0] != TensorRank - 1) {
+            return false;
+        }
+
+        // gamma * (x - mean) / sqrt(var + epsilon) + beta
+        scale = this->gamma * (this->moving_variance + this->epsilon).rsqrt();
+        shift = this->beta - this->moving_mean * scale;
+        return true;
+    }
+    else {
+        return false;
+    }
+}
+
+
+template<int TensorRank, int NormDimCount>
+size_t BatchNormalization<TensorRank, NormDimCount>::GetTensorBytes() const
+{
+    return Layer::TensorBytes(this->X, this->X_norm, this->Z, this->dL_dZ, this->dL_db,
+                              this->dL_dy, this->dL_dX, this->input_minus_mean,
+                              this->variance_plus_epsilon, this->moving_mean,
+                              this->moving_variance, this->beta, this->gamma);
+}
+
+
 #ifdef _WIN32
 #pragma GCC diagnostic ignored "-Wreturn-local-addr"
 #elif defined __unix__ || defined __APPLE__ || defined __linux__
@@ -294,7 +381,7 @@ BatchNormalization<TensorRank, NormDimCount>::GetInputGradients2D()
                 std::to_string(TensorRank) + " TENSOR");
     }
 
-    this->dL_dX.resize(this->X.dimensions());
+    this->dL_dX.resize(this->X->dimensions());
     this->CalculateInputGradients(this->dL_dZ);
     return this->dL_dX;
 }
@@ -317,7 +404,7 @@ BatchNormalization<TensorRank, NormDimCount>::GetInputGradients3D()
                 std::to_string(TensorRank) + " TENSOR");
     }
 
-    this->dL_dX.resize(this->X.dimensions());
+    this->dL_dX.resize(this->X->dimensions());
     this->CalculateInputGradients(this->dL_dZ);
     return this->dL_dX;
 }
@@ -340,7 +427,7 @@ BatchNormalization<TensorRank, NormDimCount>::GetInputGradients4D()
                 std::to_string(TensorRank) + " TENSOR");
     }
 
-    this->dL_dX.resize(this->X.dimensions());
+    this->dL_dX.resize(this->X->dimensions());
     this->CalculateInputGradients(this->dL_dZ);
     return this->dL_dX;
 }
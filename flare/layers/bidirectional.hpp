@@ -6,6 +6,8 @@
 #define FLARE_BIDIRECTIONAL_HPP
 
 #include "lstm.hpp"
+#include <array>
+#include <memory>
 
 namespace fl
 {
@@ -36,6 +38,22 @@ public:
 
     void Update(Optimizer &optimizer) override;
 
+    std::vector<TensorMap<1>> GetParameters() override;
+
+    std::vector<TensorMap<1>> GetParameterGradients() override;
+
+    Layer *Clone() const override;
+
+    size_t GetTensorBytes() const override;
+
+    void SetInferenceOnly(bool inference_only) override;
+
+    void SetGemmBackend(GemmBackend backend) override;
+
+    void Freeze(bool frozen) override;
+
+    void SetCheckpointing(Eigen::Index segment) override;
+
     const Tensor<2> &GetOutput2D() const override;
 
     const Tensor<3> &GetOutput3D() const override;
@@ -56,6 +74,8 @@ public:
 
     void Load(const std::string &path) override;
 
+    void SetExecutionContext(ExecutionContext &context) override;
+
 private:
     void SetSubLayerNames();
 
@@ -77,17 +97,13 @@ private:
 
     Layer *forward_rnn;
     Layer *reverse_rnn;
+    std::array<std::shared_ptr<Layer>, 2> owned_rnns; // set only on clones
 
     Dims<3, bool> rev_time_dim {false, true, false};
     Dims<3> input_dims;
 
     Tensor<ReturnSequences ? 3 : 2> h;
     Tensor<3> dL_dx;
-
-    // multithreading
-    Eigen::ThreadPool pool = Eigen::ThreadPool(
-            (int) std::thread::hardware_concurrency());
-    Eigen::ThreadPoolDevice device = Eigen::ThreadPoolDevice(&pool, 2);
 };
 
 } // namespace fl
@@ -130,6 +130,63 @@ void Bidirectional<Merge, Activation, GateActivation, ReturnSequences>::Update(
 }
 
 
+template<int Merge, typename Activation, typename GateActivation, bool ReturnSequences>
+std::vector<TensorMap<1>>
+Bidirectional<Merge, Activation, GateActivation, ReturnSequences>::GetParameters()
+{
+    std::vector<TensorMap<1>> parameters = this->forward_rnn->GetParameters();
+    std::vector<TensorMap<1>> reverse = this->reverse_rnn->GetParameters();
+    parameters.insert(parameters.end(), reverse.begin(), reverse.end());
+    return parameters;
+}
+
+
+template<int Merge, typename Activation, typename GateActivation, bool ReturnSequences>
+std::vector<TensorMap<1>>
+Bidirectional<Merge, Activation, GateActivation, ReturnSequences>::GetParameterGradients()
+{
+    std::vector<TensorMap<1>> gradients = this->forward_rnn->GetParameterGradients();
+    std::vector<TensorMap<1>> reverse = this->reverse_rnn->GetParameterGradients();
+    gradients.insert(gradients.end(), reverse.begin(), reverse.end());
+    return gradients;
+}
+
+
+template<int Merge, typename Activation, typename GateActivation, bool ReturnSequences>
+Layer *Bidirectional<Merge, Activation, GateActivation, ReturnSequences>::Clone() const
+{
+    // the clone owns copies of both directions, it must not share weights
+    auto *clone = new Bidirectional(*this);
+    clone->owned_rnns = {std::shared_ptr<Layer>(this->forward_rnn->Clone()),
+                         std::shared_ptr<Layer>(this->reverse_rnn->Clone())};
+    clone->forward_rnn = clone->owned_rnns[0].get();
+    clone->reverse_rnn = clone->owned_rnns[1].get();
+    return clone;
+}
+
+
+template<int Merge, typename Activation, typename GateActivation, bool ReturnSequences>
+void Bidirectional<Merge, Activation, GateActivation, ReturnSequences>::SetInferenceOnly(bool inference_only)
+{
+    Layer::SetInferenceOnly(inference_only);
+    this->forward_rnn->SetInferenceOnly(inference_only);
+    this->reverse_rnn->SetInferenceOnly(inference_only);
+
+    if (inference_only) {
+        Layer::FreeTensors(this->dL_dx);
+    }
+}
+
+
+template<int Merge, typename Activation, typename GateActivation, bool ReturnSequences>
+size_t Bidirectional<Merge, Activation, GateActivation, ReturnSequences>::GetTensorBytes() const
+{
+    return Layer::TensorBytes(this->h, this->dL_dx) +
+           this->forward_rnn->GetTensorBytes() +
+           this->reverse_rnn->GetTensorBytes();
+}
+
+
 template<int Merge, typename Activation, typename GateActivation, bool ReturnSequences>
 const Tensor<2> &
 Bidirectional<Merge, Activation, GateActivation, ReturnSequences>::GetOutput2D() const
@@ -408,4 +465,41 @@ void Bidirectional<Merge, Activation, GateActivation, ReturnSequences>::Load(
 }
 
 
+template<int Merge, typename Activation, typename GateActivation, bool ReturnSequences>
+void Bidirectional<Merge, Activation, GateActivation, ReturnSequences>::SetExecutionContext(
+        ExecutionContext &context)
+{
+    Layer::SetExecutionContext(context);
+    this->forward_rnn->SetExecutionContext(context);
+    this->reverse_rnn->SetExecutionContext(context);
+}
+
+
+template<int Merge, typename Activation, typename GateActivation, bool ReturnSequences>
+void Bidirectional<Merge, Activation, GateActivation, ReturnSequences>::SetGemmBackend(
+        GemmBackend backend)
+{
+    this->forward_rnn->SetGemmBackend(backend);
+    this->reverse_rnn->SetGemmBackend(backend);
+}
+
+
+template<int Merge, typename Activation, typename GateActivation, bool ReturnSequences>
+void Bidirectional<Merge, Activation, GateActivation, ReturnSequences>::Freeze(
+        bool frozen)
+{
+    this->forward_rnn->Freeze(frozen);
+    this->reverse_rnn->Freeze(frozen);
+}
+
+
+template<int Merge, typename Activation, typename GateActivation, bool ReturnSequences>
+void Bidirectional<Merge, Activation, GateActivation, ReturnSequences>::SetCheckpointing(
+        Eigen::Index segment)
+{
+    this->forward_rnn->SetCheckpointing(segment);
+    this->reverse_rnn->SetCheckpointing(segment);
+}
+
+
 } // namespace fl
\ No newline at end of file
@@ -6,10 +6,15 @@
 #define FLARE_CONV2D_HPP
 
 #include "layer.hpp"
+#include "flare/conv_kernels.hpp"
+#include "flare/activations/linear.hpp"
+#include <chrono>
+#include <limits>
 
 namespace fl
 {
 
+// threads is no longer used, the layer runs on the model's execution context
 template<typename Activation, int threads = 2>
 class Conv2D : public Layer
 {
@@ -25,10 +30,12 @@ public:
      * @param dilation       dilation dimensions, Dilation(height, width)
      * @param padding        padding type, Padding::PADDING_VALID or Padding::PADDING_SAME
      * @param initializer    kernel initialization method
+     * @param groups         channels and filters are split into groups, each
+     *                       group of filters only convolves its group of channels
      */
     Conv2D(int num_filters, int input_channels, const Kernel &kernel,
            const Stride &stride, const Dilation &dilation, Padding padding,
-           const Initializer<4> &initializer = GlorotUniform<4>());
+           const Initializer<4> &initializer = GlorotUniform<4>(), int groups = 1);
 
     Conv2D(int num_filters, int input_channels, const Kernel &kernel,
            Padding padding = Padding::PADDING_VALID,
@@ -46,6 +53,40 @@ public:
 
     void Update(Optimizer &optimizer) override;
 
+    std::vector<TensorMap<1>> GetParameters() override;
+
+    std::vector<TensorMap<1>> GetParameterGradients() override;
+
+    Layer *Clone() const override;
+
+    size_t GetTensorBytes() const override;
+
+    /**
+     * With GemmBackend::PACKED, Forward multiplies the image patches with
+     * kernels packed once per Update instead of contracting
+     */
+    void SetGemmBackend(GemmBackend backend) override;
+
+    void Freeze(bool frozen) override;
+
+    void SetInferenceOnly(bool inference_only) override;
+
+    /**
+     * Linear layers scale their kernels by the channel scale and add the
+     * shift and leaky ReLU in the pass that activates the output. The weights
+     * of Save, Load, GetWeights4D and SetWeights stay the unfolded ones
+     */
+    bool Fold(const Tensor<1> &scale, const Tensor<1> &shift, Scalar leak) override;
+
+    void Unfold() override;
+
+    /**
+     * Choose how Forward convolves, ConvAlgorithm::AUTO by default. Backward
+     * and Conv2DTranspose always use the im2col convolutions, grouped layers
+     * always convolve directly
+     */
+    void SetConvAlgorithm(ConvAlgorithm algorithm);
+
     const Tensor<4> &GetOutput4D() const override;
 
     const Tensor<4> &GetInputGradients4D() override;
@@ -86,64 +127,14 @@ public:
             Eigen::Index pad_top, Eigen::Index pad_bottom,
             Eigen::Index pad_left, Eigen::Index pad_right);
 
-
-    /**
-     * Backpropagation, calculate derivative of loss w.r.t. kernels is the convolution
-     * between layer input and output gradients propagated back from the next layer
-     *
-     * @param layer_input   Layer input tensor in format NHWC
-     * @param gradients     Output gradients in format FHWC, plays role of kernel
-     * @param stride        Forward propagation's dilation dimensions (h, w)
-     * @param dilation      Forward propagation's stride dimensions (h, w)
-     * @param inflate       Dilation on the layer input tensor
-     * @param output_dims   Expected dimensions of the resultant dL/dk tensor (same as kernels)
-     * @param pad_top       input tensor top side padding
-     * @param pad_bottom    input tensor bottom side padding
-     * @param pad_left      input tensor left side padding
-     * @param pad_right     input tensor right side padding
-     * @return              Tensor<4> NHWC as tensor op
-     */
-    EIGEN_STRONG_INLINE
-    static auto ConvolutionBackwardKernel(
-            const Tensor<4> &layer_input, const Tensor<4> &gradients,
-            const Stride &stride, const Dilation &dilation, const Inflate &inflate,
-            const Dims<4> &output_dims,
-            Eigen::Index pad_top, Eigen::Index pad_bottom,
-            Eigen::Index pad_left, Eigen::Index pad_right);
-
-
-    /**
-     * Backpropagation through inputs, derivative of loss w.r.t. inputs is the
-     * "full" convolution between output gradients dL/dZ and layer kernels
-     *
-     * @param gradients     Output gradients in format NHWF (aka NHWC for next layer)
-     * @param kernels       Layer kernels in format FHWC
-     * @param stride        Forward propagation's dilation (not stride) dimensions (h, w)
-     * @param dilation      Forward propagation's stride (not dilation) dimensions (h, w)
-     * @param inflate       Dilation on the gradients tensor
-     * @param result_dims   Dimensions of the forward propagation input tensor
-     * @param pad_top       gradient tensor top side padding
-     * @param pad_bottom    gradient tensor bottom side padding
-     * @param pad_left      gradient tensor left side padding
-     * @param pad_right     gradient tensor right side padding
-     * @return              Tensor<4> NHWC as a tensor op
-     */
-    EIGEN_STRONG_INLINE
-    static auto ConvolutionBackwardInput(
-             const Tensor<4> &gradients,  const Tensor<4> &kernels,
-             const Stride &stride,  const Dilation &dilation,  const Inflate &inflate,
-             const Dims<4> &result_dims,
-            Eigen::Index pad_top, Eigen::Index pad_bottom,
-            Eigen::Index pad_left, Eigen::Index pad_right);
-
 protected:
-    Tensor<4> X; // layer input image
+    LayerInput<4> X; // layer input image
     Tensor<4> Z; // layer input convolved with kernels
     Tensor<4> A; // activated output of layer inout convolved with kernels
     Tensor<4> dL_dZ; // gradients of layer output, received from next layer
     Tensor<4> dL_dX; // gradients of layer input
 
-    Tensor<4> kernels; // weights, NHWC format, N = num filters
+    Tensor<4> kernels; // weights, NHWC format, N = num filters, C = channels / groups
     Tensor<4> b; // bias
     Tensor<4> dL_dk; // loss gradients w.r.t. kernels
     Tensor<4> dL_db; // loss gradients w.r.t. bias
@@ -153,10 +144,62 @@ protected:
     const Kernel kernel_dim;
     const Stride stride;
     const Dilation dilation;
-
-    // multithreading
-    Eigen::ThreadPool pool;
-    Eigen::ThreadPoolDevice device;
+    const Eigen::Index groups;
+
+    // pack the kernels for GemmBackend::PACKED or a frozen layer if they changed
+    void PackKernels();
+
+    // pack the kernels if they changed, whatever the GemmBackend
+    void RepackKernels();
+
+    // kernel gradients of a grouped convolution, one contraction per group
+    void BackwardGroups(const ConvShape &shape);
+
+    // shape of the convolution of an input with these dimensions, with the
+    // output size and SAME padding of Forward
+    ConvShape Shape(const Dims<4> &input_dims) const;
+
+    // the algorithm Forward runs for the shape, times them first for TUNED
+    ConvAlgorithm Algorithm(const Tensor<4> &inputs, Tensor<4> &output,
+                            const ConvShape &shape);
+
+    // output = inputs convolved with the kernels, before the activation
+    void Convolve(const Tensor<4> &inputs, Tensor<4> &output,
+                  const ConvShape &shape, ConvAlgorithm algorithm);
+
+    // A = leaky(output + folded_shift), the activation of a folded layer
+    void ActivateFolded(const Tensor<4> &output);
+
+    // kernels = unfolded_kernels scaled by folded_scale, repacked
+    void ScaleFoldedKernels();
+
+    // replace the kernels, folded like the old ones if the layer is folded
+    void SetKernels(const Tensor<4> &weights);
+
+    // whether Forward multiplies with packed_kernels
+    bool Packed() const
+    {
+        return this->gemm == GemmBackend::PACKED || this->frozen;
+    }
+
+    GemmBackend gemm = GemmBackend::CONTRACTION;
+    PackedMatrix packed_kernels; // kernels as [kernel H * W * C, F], packed
+    std::vector<PackedMatrix> packed_groups; // packed_kernels of each group
+    Tensor<2> depthwise_kernels; // kernels as [kernel H * W, F], one channel per group
+    bool packed_stale = true; // kernels changed since they were packed
+    bool frozen = false; // packed_kernels is kept for inference
+
+    ConvAlgorithm algorithm = ConvAlgorithm::AUTO;
+    ConvAlgorithm tuned = ConvAlgorithm::IM2COL; // fastest for tuned_dims
+    Dims<4> tuned_dims; // input dimensions TUNED timed the algorithms on
+    std::vector<PackedMatrix> winograd_kernels; // G g G^T, one [C, F] per position
+    int winograd_tile = 0; // output tile of winograd_kernels, 0 when stale
+
+    bool folded = false; // kernels are scaled by Fold
+    Tensor<4> unfolded_kernels; // kernels of before Fold
+    Tensor<1> folded_scale; // of each filter's kernel, empty for none
+    Tensor<1> folded_shift; // added to each filter's output
+    Scalar folded_leak = 1; // slope of the negative outputs
 
 };
 
@@ -11,11 +11,9 @@ template<typename Activation, int Threads>
 Conv2D<Activation, Threads>::Conv2D(
         int num_filters, int input_channels, const Kernel &kernel,
         const Stride &stride, const Dilation &dilation, Padding padding,
-        const Initializer<4> &initializer) :
-        kernel_dim(kernel), stride(stride), dilation(dilation),
+        const Initializer<4> &initializer, int groups) :
         padding(padding == 1 ? Eigen::PADDING_VALID : Eigen::PADDING_SAME),
-        pool((int) std::thread::hardware_concurrency()),
-        device(&pool, Threads)
+        kernel_dim(kernel), stride(stride), dilation(dilation), groups(groups)
 {
 #ifdef FLARE_COLMAJOR
     throw std::invalid_argument(
@@ -36,10 +34,16 @@ Conv2D<Activation, Threads>::Conv2D(
         throw std::invalid_argument("DILATION DIMS MUST BE GREATER THAN 0");
     }
 
+    if (groups <= 0 || input_channels % groups != 0 || num_filters % groups != 0) {
+        throw std::invalid_argument(
+                "CONV2D CHANNELS AND FILTERS MUST BE DIVISIBLE BY GROUPS");
+    }
+
+    // each filter only sees its group's channels
     auto receptive_field_size = kernel.TotalSize(); // kernel height * width
     this->kernels = initializer.Initialize(
-            Dims<4>(num_filters, kernel[0], kernel[1], input_channels),
-            static_cast<int>(input_channels * receptive_field_size),
+            Dims<4>(num_filters, kernel[0], kernel[1], input_channels / groups),
+            static_cast<int>(input_channels / groups * receptive_field_size),
             static_cast<int>(num_filters * receptive_field_size));
 
     this->dL_dk.resize(this->kernels.dimensions());
@@ -61,51 +65,238 @@ Conv2D<Activation, Threads>::Conv2D(
 template<typename Activation, int Threads>
 void Conv2D<Activation, Threads>::Forward(const Tensor<4> &inputs)
 {
-    fl_assert(inputs.dimension(3) == this->kernels.dimensions().back(),
+    fl_assert(inputs.dimension(3) == this->kernels.dimensions().back() * this->groups,
               "Conv2D::Forward EXPECTED A TENSOR WITH "
-                      << this->kernels.dimensions().back() << "CHANNELS" <<
+                      << this->kernels.dimensions().back() * this->groups << "CHANNELS" <<
                       ", INSTEAD GOT " << inputs.dimensions().back());
 
-    this->X.resize(inputs.dimensions());
-    this->X.device(this->device) = inputs;
+    if (!this->inference_only) {
+        this->X.Set(inputs, this->borrow_input, this->device);
+    }
+
+    const ConvShape shape = this->Shape(inputs.dimensions());
+
+    // without Backward Z isn't kept, A is activated in place
+    Tensor<4> &output = this->inference_only ? this->A : this->Z;
+    output.resize(shape.batches, shape.output_h, shape.output_w, shape.filters);
+    this->A.resize(output.dimensions());
 
+    this->Convolve(inputs, output, shape, this->Algorithm(inputs, output, shape));
+
+    if (this->folded) {
+        this->ActivateFolded(output);
+    }
+    else if constexpr (std::is_same_v<Activation, Linear>) {
+        ParallelCopy(this->device, output, this->A);
+    }
+    else {
+        this->A.template device(this->device) = Activation::Activate(output);
+    }
+}
+
+
+template<typename Activation, int Threads>
+void Conv2D<Activation, Threads>::ActivateFolded(const Tensor<4> &output)
+{
+    const Eigen::Index filters = this->folded_shift.size();
+    const Scalar *z = output.data();
+    const Scalar *shift = this->folded_shift.data();
+    const Scalar leak = this->folded_leak;
+    Scalar *a = this->A.data();
+
+    // output may be A, each value is read before it is written. Branch free
+    // so the filters loop vectorizes and mixed signs don't mispredict
+    ParallelFor(this->device, output.size() / filters, 4.0 * filters, [&](Eigen::Index i) {
+        const Scalar *z_row = z + i * filters;
+        Scalar *a_row = a + i * filters;
+
+        for (Eigen::Index f = 0; f < filters; f++) {
+            const Scalar value = z_row[f] + shift[f];
+            a_row[f] = std::max(value, Scalar(0)) + leak * std::min(value, Scalar(0));
+        }
+    });
+}
+
+
+template<typename Activation, int Threads>
+ConvShape Conv2D<Activation, Threads>::Shape(const Dims<4> &input_dims) const
+{
     Eigen::Index output_h;
     Eigen::Index output_w;
     Eigen::Index pad_h = 0;
     Eigen::Index pad_w = 0;
 
     if (this->padding == Eigen::PADDING_VALID) {
-        output_h = 1 + (this->X.dimension(1) -
+        output_h = 1 + (input_dims[1] -
                         this->dilation[0] * (this->kernel_dim[0] - 1) - 1) /
                        this->stride[0];
-        output_w = 1 + (this->X.dimension(2) -
+        output_w = 1 + (input_dims[2] -
                         this->dilation[1] * (this->kernel_dim[1] - 1) - 1) /
                        this->stride[1];
     }
     else {
         // same padding for strided convolutions will have resolution decreased
-        output_h = std::ceil(this->X.dimension(1) / this->stride[0]);
-        output_w = std::ceil(this->X.dimension(2) / this->stride[1]);
+        output_h = std::ceil(input_dims[1] / this->stride[0]);
+        output_w = std::ceil(input_dims[2] / this->stride[1]);
 
         // if uneven padding, extra goes to bottom/right
         pad_h = (output_h - 1) * this->stride[0] -
-                this->X.dimension(1) +
+                input_dims[1] +
                 this->dilation[0] * (this->kernel_dim[0] - 1) + 1;
         pad_w = (output_w - 1) * this->stride[1] -
-                this->X.dimension(2) +
+                input_dims[2] +
                 this->dilation[1] * (this->kernel_dim[1] - 1) + 1;
     }
 
-    this->Z.resize(inputs.dimension(0), output_h, output_w,
-                   this->kernels.dimension(0));
-    this->A.resize(this->Z.dimensions());
+    return {input_dims[0], input_dims[1], input_dims[2], input_dims[3],
+            output_h, output_w, this->kernels.dimension(0),
+            this->kernel_dim[0], this->kernel_dim[1], this->stride[0], this->stride[1],
+            this->dilation[0], this->dilation[1],
+            pad_h / 2, pad_h - pad_h / 2, pad_w / 2, pad_w - pad_w / 2, this->groups};
+}
+
+
+template<typename Activation, int Threads>
+ConvAlgorithm Conv2D<Activation, Threads>::Algorithm(
+        const Tensor<4> &inputs, Tensor<4> &output, const ConvShape &shape)
+{
+    const bool winograd_runs = ConvKernels::WinogradRuns(shape);
+
+    if (!Gemm::available) {
+        return ConvAlgorithm::IM2COL;
+    }
+
+    if (shape.groups > 1) {
+        return ConvAlgorithm::DIRECT; // only Direct and Depthwise convolve groups
+    }
+
+    switch (this->algorithm) {
+        case ConvAlgorithm::AUTO:
+            return ConvKernels::Choose(shape);
+        case ConvAlgorithm::TUNED:
+            break;
+        case ConvAlgorithm::WINOGRAD_2X2:
+        case ConvAlgorithm::WINOGRAD_4X4:
+            return winograd_runs ? this->algorithm : ConvKernels::Choose(shape);
+        default:
+            return this->algorithm;
+    }
 
-    this->Z.template device(this->device) = Conv2D::ConvolutionForward(
-            inputs, this->kernels, this->stride,
-            this->dilation, Inflate(1, 1), this->Z.dimensions(),
-            pad_h / 2, pad_h - pad_h / 2, pad_w / 2, pad_w - pad_w / 2);
+    if (inputs.dimensions() != this->tuned_dims) {
+        double fastest = std::numeric_limits<double>::max();
+
+        for (ConvAlgorithm candidate: {ConvAlgorithm::IM2COL, ConvAlgorithm::DIRECT,
+                                       ConvAlgorithm::WINOGRAD_2X2,
+                                       ConvAlgorithm::WINOGRAD_4X4}) {
+            if (!winograd_runs && (candidate == ConvAlgorithm::WINOGRAD_2X2 ||
+                                   candidate == ConvAlgorithm::WINOGRAD_4X4)) {
+                continue;
+            }
+
+            // the first run packs the kernels, time the second
+            this->Convolve(inputs, output, shape, candidate);
+            auto start = std::chrono::steady_clock::now();
+            this->Convolve(inputs, output, shape, candidate);
+            std::chrono::duration<double> seconds =
+                    std::chrono::steady_clock::now() - start;
+
+            if (seconds.count() < fastest) {
+                fastest = seconds.count();
+                this->tuned = candidate;
+            }
+        }
+
+        this->tuned_dims = inputs.dimensions();
+    }
 
-    this->A.template device(this->device) = Activation::Activate(this->Z);
+    return this->tuned;
+}
+
+
+template<typename Activation, int Threads>
+void Conv2D<Activation, Threads>::Convolve(
+        const Tensor<4> &inputs, Tensor<4> &output, const ConvShape &shape,
+        ConvAlgorithm algorithm)
+{
+    switch (algorithm) {
+        case ConvAlgorithm::DIRECT:
+            this->RepackKernels();
+
+            if (shape.Depthwise()) {
+                ConvKernels::Depthwise(shape, inputs.data(),
+                                       this->depthwise_kernels.data(),
+                                       output.data(), this->device);
+                return;
+            }
+
+            if (shape.groups > 1) {
+                for (Eigen::Index g = 0; g < shape.groups; g++) {
+                    ConvKernels::Direct(shape, inputs.data(), this->packed_groups[g],
+                                        output.data(), this->device, g);
+                }
+
+                return;
+            }
+
+            ConvKernels::Direct(shape, inputs.data(), this->packed_kernels,
+                                output.data(), this->device);
+            return;
+        case ConvAlgorithm::WINOGRAD_2X2:
+            if (this->winograd_tile != 2) {
+                ConvKernels::PackWinograd<2>(this->kernels, this->winograd_kernels);
+                this->winograd_tile = 2;
+            }
+
+            ConvKernels::Winograd<2>(shape, inputs.data(), this->winograd_kernels,
+                                     output.data(), this->device);
+            return;
+        case ConvAlgorithm::WINOGRAD_4X4:
+            if (this->winograd_tile != 4) {
+                ConvKernels::PackWinograd<4>(this->kernels, this->winograd_kernels);
+                this->winograd_tile = 4;
+            }
+
+            ConvKernels::Winograd<4>(shape, inputs.data(), this->winograd_kernels,
+                                     output.data(), this->device);
+            return;
+        default:
+            break;
+    }
+
+    if (this->Packed()) {
+        // im2col once, then one matrix multiplication with the packed kernels
+        // whose result is already Z in NHWC
+        const Eigen::Index num_kernels = this->kernels.dimension(0);
+        const Eigen::Index kernel_size = this->kernels.size() / num_kernels;
+        const Eigen::Index rows = output.size() / num_kernels;
+
+        this->PackKernels();
+
+        // the patches are a device temporary, the context's arena recycles
+        // their block across calls and the model's other convolutions
+        Scalar *patch_data = static_cast<Scalar *>(
+                this->device.allocate(rows * kernel_size * sizeof(Scalar)));
+        TensorMap<2> patches(patch_data, rows, kernel_size);
+
+        patches.device(this->device) = inputs
+                .extract_image_patches(
+                        this->kernel_dim[0], this->kernel_dim[1],
+                        this->stride[0], this->stride[1],
+                        this->dilation[0], this->dilation[1], 1, 1,
+                        shape.pad_top, shape.pad_bottom, shape.pad_left, shape.pad_right,
+                        0.0)
+                .reshape(Dims<2>(rows, kernel_size));
+
+        Gemm::Run(rows, patch_data, kernel_size, 1, this->packed_kernels,
+                  output.data(), num_kernels, this->device);
+        this->device.deallocate(patch_data);
+    }
+    else {
+        output.template device(this->device) = Conv2D::ConvolutionForward(
+                inputs, this->kernels, this->stride,
+                this->dilation, Inflate(1, 1), output.dimensions(),
+                shape.pad_top, shape.pad_bottom, shape.pad_left, shape.pad_right);
+    }
 }
 
 
@@ -130,26 +321,82 @@ void Conv2D<Activation, Threads>::Backward(const Tensor<4> &gradients)
     this->dL_dZ.template device(this->device) =
             gradients * Activation::Gradients(this->Z);
 
-    // if uneven padding, extra goes to bottom/right, negative padding will remove
-    Eigen::Index pad_h =
-            (this->kernels.dimension(1) - 1) * this->dilation[0] -
-            this->X.dimension(1) +
-            this->stride[0] * (this->dL_dZ.dimension(1) - 1) + 1;
-    Eigen::Index pad_w =
-            (this->kernels.dimension(2) - 1) * this->dilation[1] -
-            this->X.dimension(2) +
-            this->stride[1] * (this->dL_dZ.dimension(2) - 1) + 1;
+    const ConvShape shape = this->Shape(this->X->dimensions());
+    const Eigen::Index rows = this->dL_dZ.size() / shape.filters;
+    const Eigen::Index taps = shape.kernel_h * shape.kernel_w;
+    const Eigen::Index kernel_size = taps * shape.channels;
+
+    if (shape.Depthwise()) {
+        // [KH * KW, F] like depthwise_kernels, transposed into the kernels' layout
+        Scalar *dk = static_cast<Scalar *>(
+                this->device.allocate(this->dL_dk.size() * sizeof(Scalar)));
 
-    this->dL_dk.template device(this->device) = Conv2D::ConvolutionBackwardKernel(
-            this->X, this->dL_dZ,
-            this->dilation, this->stride, Inflate(1, 1),
-            this->kernels.dimensions(),
-            pad_h / 2, pad_h - pad_h / 2, pad_w / 2, pad_w - pad_w / 2);
+        ConvKernels::DepthwiseBackwardKernel(shape, this->X->data(), this->dL_dZ.data(),
+                                             dk, this->device);
 
-    fl_assert(this->dL_dk.dimensions() == this->kernels.dimensions(),
-              "Conv2D::Backward EXPECTED KERNEL GRADIENTS DIMENSIONS "
-                      << this->kernels.dimensions() << ", GOT "
-                      << this->dL_dk.dimensions());
+        TensorMap<2>(this->dL_dk.data(), shape.filters, taps).device(this->device) =
+                TensorMap<2>(dk, taps, shape.filters).shuffle(Dims<2>(1, 0));
+
+        this->device.deallocate(dk);
+        return;
+    }
+
+    if (shape.groups > 1) {
+        this->BackwardGroups(shape);
+        return;
+    }
+
+    // dL/dk = dL/dZ^T x im2col(X), [F, N * H * W] x [N * H * W, KH * KW * C]
+    // the patches are the ones Forward multiplied with the kernels
+    Scalar *patch_data = static_cast<Scalar *>(
+            this->device.allocate(rows * kernel_size * sizeof(Scalar)));
+    TensorMap<2> patches(patch_data, rows, kernel_size);
+
+    ConvKernels::Im2col(shape, this->X->data(), patch_data, this->device);
+
+    TensorMap<2>(this->dL_dk.data(), shape.filters, kernel_size).device(this->device) =
+            this->dL_dZ.reshape(Dims<2>(rows, shape.filters))
+                    .contract(patches, ContractDim {Axes(0, 0)});
+
+    this->device.deallocate(patch_data);
+}
+
+
+template<typename Activation, int Threads>
+void Conv2D<Activation, Threads>::BackwardGroups(const ConvShape &shape)
+{
+    const Eigen::Index rows = this->dL_dZ.size() / shape.filters;
+    const Eigen::Index group_channels = shape.channels / shape.groups;
+    const Eigen::Index group_filters = shape.filters / shape.groups;
+    const Eigen::Index group_size = shape.kernel_h * shape.kernel_w * group_channels;
+
+    // each group's patches and gradients are copied out contiguous first, the
+    // contraction is several times slower reading them through a slice and
+    // extract_image_patches is slow on a few channels
+    Scalar *patch_data = static_cast<Scalar *>(
+            this->device.allocate(rows * group_size * sizeof(Scalar)));
+    Scalar *gradient_data = static_cast<Scalar *>(
+            this->device.allocate(rows * group_filters * sizeof(Scalar)));
+    TensorMap<2> patches(patch_data, rows, group_size);
+    TensorMap<2> gradients(gradient_data, rows, group_filters);
+
+    for (Eigen::Index g = 0; g < shape.groups; g++) {
+        ConvKernels::Im2col(shape, this->X->data(), patch_data, this->device, g);
+
+        const Scalar *group_gradients = this->dL_dZ.data() + g * group_filters;
+
+        ParallelFor(this->device, rows, group_filters, [&](Eigen::Index row) {
+            std::copy_n(group_gradients + row * shape.filters, group_filters,
+                        gradient_data + row * group_filters);
+        });
+
+        TensorMap<2>(this->dL_dk.data() + g * group_filters * group_size,
+                     group_filters, group_size).device(this->device) =
+                gradients.contract(patches, ContractDim {Axes(0, 0)});
+    }
+
+    this->device.deallocate(gradient_data);
+    this->device.deallocate(patch_data);
 }
 
 
@@ -157,6 +404,223 @@ template<typename Activation, int Threads>
 void Conv2D<Activation, Threads>::Update(Optimizer &optimizer)
 {
     optimizer.Minimize(this->kernels, this->dL_dk);
+
+    this->packed_stale = true;
+    this->winograd_tile = 0;
+    this->PackKernels();
+}
+
+
+template<typename Activation, int Threads>
+std::vector<TensorMap<1>> Conv2D<Activation, Threads>::GetParameters()
+{
+    // the caller may write the kernels through the view
+    this->packed_stale = true;
+    this->winograd_tile = 0;
+    return {Layer::FlatView(this->kernels)};
+}
+
+
+template<typename Activation, int Threads>
+std::vector<TensorMap<1>> Conv2D<Activation, Threads>::GetParameterGradients()
+{
+    return {Layer::FlatView(this->dL_dk)};
+}
+
+
+template<typename Activation, int Threads>
+Layer *Conv2D<Activation, Threads>::Clone() const
+{
+    return new Conv2D<Activation, Threads>(*this);
+}
+
+
+template<typename Activation, int Threads>
+size_t Conv2D<Activation, Threads>::GetTensorBytes() const
+{
+    size_t bytes = Layer::TensorBytes(this->X, this->Z, this->A, this->dL_dZ,
+                                      this->dL_dX, this->kernels, this->b,
+                                      this->dL_dk, this->dL_db,
+                                      this->unfolded_kernels, this->folded_scale,
+                                      this->folded_shift) +
+                   this->packed_kernels.Bytes() +
+                   Layer::TensorBytes(this->depthwise_kernels);
+
+    for (const PackedMatrix &position: this->winograd_kernels) {
+        bytes += position.Bytes();
+    }
+
+    for (const PackedMatrix &group: this->packed_groups) {
+        bytes += group.Bytes();
+    }
+
+    return bytes;
+}
+
+
+template<typename Activation, int Threads>
+void Conv2D<Activation, Threads>::SetGemmBackend(GemmBackend backend)
+{
+    this->gemm = Gemm::available ? backend : GemmBackend::CONTRACTION;
+    this->packed_stale = true;
+
+    if (!this->Packed()) {
+        this->packed_kernels = PackedMatrix();
+    }
+}
+
+
+template<typename Activation, int Threads>
+void Conv2D<Activation, Threads>::Freeze(bool frozen)
+{
+    this->frozen = frozen && Gemm::available;
+
+    if (this->frozen) {
+        this->PackKernels();
+    }
+    else if (!this->Packed()) {
+        this->packed_kernels = PackedMatrix();
+        this->packed_stale = true;
+    }
+}
+
+
+template<typename Activation, int Threads>
+void Conv2D<Activation, Threads>::PackKernels()
+{
+    if (this->Packed()) {
+        this->RepackKernels();
+    }
+}
+
+
+template<typename Activation, int Threads>
+void Conv2D<Activation, Threads>::RepackKernels()
+{
+    if (this->packed_stale) {
+        // kernels [F, H, W, C] are row major [F, H * W * C], pack their transpose
+        const Eigen::Index num_kernels = this->kernels.dimension(0);
+        const Eigen::Index kernel_size = this->kernels.size() / num_kernels;
+        const Eigen::Index group_filters = num_kernels / this->groups;
+
+        if (this->groups == 1) {
+            this->packed_kernels.Pack(this->kernels.data(), kernel_size, num_kernels,
+                                      1, kernel_size);
+        }
+        else if (this->kernels.dimension(3) == 1) {
+            this->depthwise_kernels = TensorMap<2>(this->kernels.data(), num_kernels,
+                                                   kernel_size).shuffle(Dims<2>(1, 0));
+        }
+        else {
+            this->packed_groups.resize(this->groups);
+
+            for (Eigen::Index g = 0; g < this->groups; g++) {
+                this->packed_groups[g].Pack(
+                        this->kernels.data() + g * group_filters * kernel_size,
+                        kernel_size, group_filters, 1, kernel_size);
+            }
+        }
+
+        this->packed_stale = false;
+    }
+}
+
+
+template<typename Activation, int Threads>
+bool Conv2D<Activation, Threads>::Fold(const Tensor<1> &scale, const Tensor<1> &shift,
+                                       Scalar leak)
+{
+    const Eigen::Index filters = this->kernels.dimension(0);
+
+    if (!std::is_same_v<Activation, Linear> ||
+        (scale.size() != 0 && scale.size() != filters) ||
+        (shift.size() != 0 && shift.size() != filters)) {
+        return false;
+    }
+
+    if (!this->folded) {
+        this->unfolded_kernels = this->kernels;
+    }
+
+    this->folded_scale = scale;
+    this->folded_shift.resize(filters);
+
+    if (shift.size() != 0) {
+        this->folded_shift = shift;
+    }
+    else {
+        this->folded_shift.setZero();
+    }
+
+    this->folded_leak = leak;
+    this->folded = true;
+    this->ScaleFoldedKernels();
+    return true;
+}
+
+
+template<typename Activation, int Threads>
+void Conv2D<Activation, Threads>::ScaleFoldedKernels()
+{
+    const Eigen::Index filters = this->kernels.dimension(0);
+    const Eigen::Index kernel_size = this->kernels.size() / filters;
+
+    // kernels [F, H, W, C] are row major [F, H * W * C], scale each filter's row
+    if (this->folded_scale.size() != 0) {
+        TensorMap<2>(this->kernels.data(), filters, kernel_size).device(this->device) =
+                TensorMapConst<2>(this->unfolded_kernels.data(), filters, kernel_size) *
+                this->folded_scale.reshape(Dims<2>(filters, 1))
+                        .broadcast(Dims<2>(1, kernel_size));
+    }
+    else {
+        this->kernels = this->unfolded_kernels;
+    }
+
+    this->packed_stale = true;
+    this->winograd_tile = 0;
+    this->PackKernels();
+}
+
+
+template<typename Activation, int Threads>
+void Conv2D<Activation, Threads>::Unfold()
+{
+    if (!this->folded) {
+        return;
+    }
+
+    this->kernels = this->unfolded_kernels;
+    Layer::FreeTensors(this->unfolded_kernels, this->folded_scale, this->folded_shift);
+    this->folded_leak = 1;
+    this->folded = false;
+    this->packed_stale = true;
+    this->winograd_tile = 0;
+    this->PackKernels();
+}
+
+
+template<typename Activation, int Threads>
+void Conv2D<Activation, Threads>::SetConvAlgorithm(ConvAlgorithm algorithm)
+{
+    this->algorithm = algorithm;
+    this->tuned_dims = Dims<4>();
+    this->winograd_kernels.clear();
+    this->winograd_tile = 0;
+}
+
+
+template<typename Activation, int Threads>
+void Conv2D<Activation, Threads>::SetInferenceOnly(bool inference_only)
+{
+    Layer::SetInferenceOnly(inference_only);
+
+    if (inference_only) {
+        Layer::FreeTensors(this->X, this->Z, this->dL_dZ, this->dL_dX,
+                           this->dL_dk, this->dL_db);
+    }
+    else {
+        this->dL_dk.resize(this->kernels.dimensions());
+    }
 }
 
 
@@ -170,42 +634,56 @@ const Tensor<4> &Conv2D<Activation, Threads>::GetOutput4D() const
 template<typename Activation, int Threads>
 const Tensor<4> &Conv2D<Activation, Threads>::GetInputGradients4D()
 {
-    // the following padding calculations were taken from TensorFlow's SpatialConvolutionBacKWardInput
-    const Eigen::Index kernelRowsEff =
-            this->kernels.dimension(1) +
-            (this->kernels.dimension(1) - 1) * (this->dilation[0] - 1);
-    const Eigen::Index kernelColsEff =
-            this->kernels.dimension(2) +
-            (this->kernels.dimension(2) - 1) * (this->dilation[1] - 1);
-
-    const Eigen::Index outputRows = this->dL_dZ.dimension(1);
-    const Eigen::Index outputCols = this->dL_dZ.dimension(2);
-
-    // Computing the forward padding
-    const Eigen::Index forward_pad_top = Eigen::numext::maxi<Eigen::Index>(
-            0, ((outputRows - 1) * this->stride[0] + kernelRowsEff -
-                this->X.dimension(1)) / 2);
-    const Eigen::Index forward_pad_left = Eigen::numext::maxi<Eigen::Index>(
-            0, ((outputCols - 1) * this->stride[1] + kernelColsEff -
-                this->X.dimension(2)) / 2);
-
-    const Eigen::Index padding_top = kernelRowsEff - 1 - forward_pad_top;
-    const Eigen::Index padding_left = kernelColsEff - 1 - forward_pad_left;
-
-    const Eigen::Index padding_bottom =
-            this->X.dimension(1) - (outputRows - 1) * this->stride[0] -
-            2 - padding_top + kernelRowsEff;
-    const Eigen::Index padding_right =
-            this->X.dimension(2) - (outputCols - 1) * this->stride[1] -
-            2 - padding_left + kernelColsEff;
-    // end of TensorFlow padding calculations
-
-    this->dL_dX.resize(this->X.dimensions());
-    this->dL_dX.template device(this->device) = Conv2D::ConvolutionBackwardInput(
-            this->dL_dZ, this->kernels,
-            this->dilation, Dilation(1, 1), this->stride,
-            this->X.dimensions(),
-            padding_top, padding_bottom, padding_left, padding_right);
+    const ConvShape shape = this->Shape(this->X->dimensions());
+    const Eigen::Index rows = this->dL_dZ.size() / shape.filters;
+    const Eigen::Index group_filters = shape.filters / shape.groups;
+    const Eigen::Index group_size = this->kernels.size() / shape.filters;
+
+    this->dL_dX.resize(this->X->dimensions());
+
+    if (shape.Depthwise()) {
+        this->RepackKernels();
+        ConvKernels::DepthwiseBackwardInput(shape, this->dL_dZ.data(),
+                                            this->depthwise_kernels.data(),
+                                            this->dL_dX.data(), this->device);
+        return this->dL_dX;
+    }
+
+    // gradients of the patches, [N * H * W, F] x [F, KH * KW * C], then col2im
+    // sums each patch entry into the input pixel it was read from. Groups
+    // multiply their filters' gradients, copied out contiguous, with their
+    // kernels and only write their channels of dL/dX
+    Scalar *patch_data = static_cast<Scalar *>(
+            this->device.allocate(rows * (group_size + group_filters) * sizeof(Scalar)));
+    TensorMap<2> patches(patch_data, rows, group_size);
+    TensorMap<2> gradients(patch_data + rows * group_size, rows, group_filters);
+
+    for (Eigen::Index g = 0; g < shape.groups; g++) {
+        TensorMap<2> group_kernels(this->kernels.data() + g * group_filters * group_size,
+                                   group_filters, group_size);
+
+        if (shape.groups == 1) {
+            patches.device(this->device) =
+                    this->dL_dZ.reshape(Dims<2>(rows, shape.filters))
+                            .contract(group_kernels, ContractDim {Axes(1, 0)});
+        }
+        else {
+            const Scalar *group_gradients = this->dL_dZ.data() + g * group_filters;
+            Scalar *gradient_data = gradients.data();
+
+            ParallelFor(this->device, rows, group_filters, [&](Eigen::Index row) {
+                std::copy_n(group_gradients + row * shape.filters, group_filters,
+                            gradient_data + row * group_filters);
+            });
+
+            patches.device(this->device) =
+                    gradients.contract(group_kernels, ContractDim {Axes(1, 0)});
+        }
+
+        ConvKernels::Col2im(shape, patch_data, this->dL_dX.data(), this->device, g);
+    }
+
+    this->device.deallocate(patch_data);
     return this->dL_dX;
 }
 
@@ -213,7 +691,7 @@ const Tensor<4> &Conv2D<Activation, Threads>::GetInputGradients4D()
 template<typename Activation, int threads>
 std::vector<fl::Tensor<4>> Conv2D<Activation, threads>::GetWeights4D() const
 {
-    return {this->kernels};
+    return {this->folded ? this->unfolded_kernels : this->kernels};
 }
 
 
@@ -236,7 +714,7 @@ void Conv2D<Activation, Threads>::SetWeights(
         throw std::invalid_argument(error_msg.str());
     }
 
-    this->kernels = weights.front();
+    this->SetKernels(weights.front());
 }
 
 
@@ -287,118 +765,6 @@ auto Conv2D<Activation, Threads>::ConvolutionForward(
 }
 
 
-template<typename Activation, int Threads>
-auto Conv2D<Activation, Threads>::ConvolutionBackwardKernel(
-        const Tensor<4> &layer_input, const Tensor<4> &gradients,
-        const Stride &stride, const Dilation &dilation, const Inflate &inflate,
-        const Dims<4> &output_dims, Eigen::Index pad_top, Eigen::Index pad_bottom,
-        Eigen::Index pad_left, Eigen::Index pad_right)
-{
-    // stride and dilation from forward propagation are swapped in backpropagation
-    // layer_input is the layer input 4D tensor in format [N,H,W,C]
-    // gradients is the output gradient 4D tensor in format [N,H,W,F], F = # filters
-    // gradients play the role of the kernel in this backward dL/dk convolution
-    Eigen::Index channels = layer_input.dimension(3);
-    Eigen::Index batches = gradients.dimension(0);
-    Eigen::Index grad_h = gradients.dimension(1);
-    Eigen::Index grad_w = gradients.dimension(2);
-    Eigen::Index filters = gradients.dimension(3);
-    Eigen::Index patches = output_dims[1] * output_dims[2]; // H * W from [F,H,W,C]
-    Eigen::Index size_per_kernel = batches * grad_h * grad_w * channels;
-
-    // reshape gradients to im2col tensor by:
-    // 1. reorder dimensions from [N,H,W,F] to [F,N,H,W], F = # kernels
-    // 2. reintroduce the channels dim by reshaping to, [F,N,H,W,1]
-    // 3. repeat the channels dim to match input channels, [F,N,H,W,C]
-    // 4. reshape into 2D tensor [F, grad_size_per_kernel]
-    // the division accompanying the broadcast is below at the return value
-    auto gradients_im2col = gradients
-            .shuffle(Dims<4>(3, 0, 1, 2))
-            .eval()
-            .reshape(Dims<5>(filters, batches, grad_h, grad_w, 1))
-            .eval()
-            .broadcast(Dims<5>(1, 1, 1, 1, channels))
-            .reshape(Dims<2>(filters, size_per_kernel));
-
-    // reshape layer input to im2col tensor by:
-    // 1. pad the layer input tensor if same padding is used
-    // 2. extract image patches [N,P,H,W,C], P = # patches = # times gradients fit the image
-    // 3. reorder dimensions from [N,P,H,W,C] to [P,N,H,W,C]
-    // 4. reshape into 2D tensor [P, grad_size_per_kernel]
-    auto patches_im2col = layer_input
-            .extract_image_patches(grad_h, grad_w,
-                                   stride[0], stride[1],
-                                   dilation[0], dilation[1],
-                                   inflate[0], inflate[1],
-                                   pad_top, pad_bottom, pad_left, pad_right, 0.0)
-            .shuffle(Dims<5>(1, 0, 2, 3, 4))
-            .eval()
-            .reshape(Dims<2>(patches, size_per_kernel));
-
-    // convolve the layer input with the backpropagated gradients by:
-    // 1. contract the 2 im2col tensors along the [grad_size_per_kernel] dim to get [F,P]
-    // 2. reshape patches dim to actual kernel's height/width, [F, output_h, output_w, 1]
-    // 3. repeat the channels dim to match actual kernels' channels, [F, output_h, output_w, C]
-    // the resulting tensor's dimensions will match the layer kernel's dimensions
-    // since the channels dim was broadcast, divide by # times it was done so
-    return gradients_im2col
-                   .contract(patches_im2col, ContractDim {Axes(1, 1)})
-                   .reshape(Dims<4>(filters, output_dims[1], output_dims[2], 1))
-                   .eval()
-                   .broadcast(Dims<4>(1, 1, 1, channels)) /
-           static_cast<Scalar>(channels);
-}
-
-
-template<typename Activation, int Threads>
-auto Conv2D<Activation, Threads>::ConvolutionBackwardInput(
-        const Tensor<4> &gradients, const Tensor<4> &kernels,
-        const Stride &stride, const Dilation &dilation, const Inflate &inflate,
-        const Dims<4> &result_dims, Eigen::Index pad_top, Eigen::Index pad_bottom,
-        Eigen::Index pad_left, Eigen::Index pad_right)
-{
-    Eigen::Index batches = gradients.dimension(0);
-    Eigen::Index kernel_h = kernels.dimension(1);
-    Eigen::Index kernel_w = kernels.dimension(2);
-    Eigen::Index channels = kernels.dimension(3);
-
-    Eigen::Index num_kernels = kernels.dimension(0);
-    Eigen::Index num_patches = result_dims[1] * result_dims[2];
-
-    // reshape the gradients to im2col
-    // 1. extract image patches to get a 5D tensor in [N,P,H,W,F] format,
-    //    P = #patches, F = #filters from prev layer (or #channels)
-    // 2. collapse the patches dimensions to get a 3D tensor in [N,P,H*W*F] format
-    auto gradients_im2col = gradients
-            .extract_image_patches(kernel_h, kernel_w,
-                                   stride[0], stride[1],
-                                   dilation[0], dilation[1],
-                                   inflate[0], inflate[1],
-                                   pad_top, pad_bottom, pad_left, pad_right, 0)
-            .reshape(Dims<3>(batches, num_patches,
-                             kernel_h * kernel_w * num_kernels));
-    // reshape the kernels to im2col
-    // 1. backpropagation through inputs requires kernels to be flipped 180 deg
-    // 2. reorder dimensions from [F,H,W,C] to [C,H,W,F], F = #filters
-    // 3. reshape into a 2D tensor in [C,H*W*F] format
-    auto kernels_im2col = kernels
-            .reverse(Dims<4, bool>(false, true, true, false))
-            .eval()
-            .shuffle(Dims<4>(3, 1, 2, 0))
-            .eval()
-            .reshape(Dims<2>(channels, kernel_h * kernel_w * num_kernels));
-
-    // multiply the gradient and kernel tensors
-    // 1. given gradients im2col dims: [N,P,H*W*F] and kernels im2col dims: [C,H*W*F],
-    //    contract on the H*W*F dimensions of the gradients and im2col tensors
-    // 2. reshape the resulting tensor from [N,P,C] to [N,H,W,C], this dL/dX tensor
-    //    is passed back to the previous layer as dL/dZ
-    return gradients_im2col
-            .contract(kernels_im2col, ContractDim {Axes(2, 1)})
-            .reshape(result_dims);
-}
-
-
 template<typename Activation, int threads>
 void Conv2D<Activation, threads>::Save(const std::string &path)
 {
@@ -411,7 +777,8 @@ void Conv2D<Activation, threads>::Save(const std::string &path)
     }
 
     // flatten the weights and write it to the file with a white space delimiter
-    Tensor<1> flatten = this->kernels.reshape(Dims<1>(this->kernels.size()));
+    const Tensor<4> &weights = this->folded ? this->unfolded_kernels : this->kernels;
+    Tensor<1> flatten = weights.reshape(Dims<1>(weights.size()));
 
     std::vector<Scalar> as_vector(flatten.data(), flatten.data() + flatten.size());
     std::copy(as_vector.begin(), as_vector.end(),
@@ -434,7 +801,7 @@ void Conv2D<Activation, threads>::Load(const std::string &path)
               std::istream_iterator<Scalar>(), std::back_inserter(as_vector));
     read_weights.close();
 
-    if (as_vector.size() != this->kernels.size()) {
+    if (static_cast<Eigen::Index>(as_vector.size()) != this->kernels.size()) {
         std::ostringstream error_msg;
         error_msg << this->name << "::Load " << path << " EXPECTED "
                   << this->kernels.dimensions() << "=" << this->kernels.size()
@@ -444,7 +811,24 @@ void Conv2D<Activation, threads>::Load(const std::string &path)
     }
 
     // reshape the flattened tensor back to expected weights dimensions
-    this->kernels = TensorMap<4>(as_vector.data(), this->kernels.dimensions());
+    this->SetKernels(
+            Tensor<4>(TensorMap<4>(as_vector.data(), this->kernels.dimensions())));
+}
+
+
+template<typename Activation, int Threads>
+void Conv2D<Activation, Threads>::SetKernels(const Tensor<4> &weights)
+{
+    if (this->folded) {
+        // the new weights are unfolded, fold them like the old ones
+        this->unfolded_kernels = weights;
+        this->ScaleFoldedKernels();
+        return;
+    }
+
+    this->kernels = weights;
+    this->packed_stale = true;
+    this->winograd_tile = 0;
 }
 
 } // namespace fl
\ No newline at end of file
@@ -27,10 +27,30 @@ public:
 
     void Backward(const Tensor<4> &gradients) override;
 
+    Layer *Clone() const override;
+
+    // the transposed convolution always multiplies with its own packed kernels
+    void SetGemmBackend(GemmBackend backend) override;
+
+    void Freeze(bool frozen) override;
+
+    // Forward doesn't activate like Conv2D, nothing is folded
+    bool Fold(const Tensor<1> &scale, const Tensor<1> &shift, Scalar leak) override;
+
+    size_t GetTensorBytes() const override;
+
     const Tensor<4> &GetInputGradients4D() override;
 
 private:
-    Dims<4> fwd_pad; // save forward top/bottom/left/right padding, reuse in backward
+    // shape of the Conv2D this layer transposes, Forward is the input
+    // gradients of that convolution: its input is this layer's output and
+    // its output this layer's input, its filters are this layer's channels
+    ConvShape AdjointShape(const Dims<4> &input_dims) const;
+
+    // pack the kernels as [C, KH * KW * F] and [KH * KW * F, C] if they changed
+    void PackTransposed();
+
+    PackedMatrix packed_input_kernels; // kernels as [KH * KW * F, C], packed
 
     // Given padding=same, stride=3, input=5, Conv2DTranspose output is 15.
     // However, since output size in the reverse operation, Conv2D, includes an
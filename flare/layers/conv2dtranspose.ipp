@@ -52,6 +52,43 @@ Conv2DTranspose<Activation, Threads>::Conv2DTranspose(
 }
 
 
+template<typename Activation, int Threads>
+Layer *Conv2DTranspose<Activation, Threads>::Clone() const
+{
+    return new Conv2DTranspose<Activation, Threads>(*this);
+}
+
+
+template<typename Activation, int Threads>
+void Conv2DTranspose<Activation, Threads>::SetGemmBackend(GemmBackend backend)
+{
+    // nothing to do, the kernels are always packed
+}
+
+
+template<typename Activation, int Threads>
+void Conv2DTranspose<Activation, Threads>::Freeze(bool frozen)
+{
+    // nothing to do, the kernels are always packed
+}
+
+
+template<typename Activation, int Threads>
+bool Conv2DTranspose<Activation, Threads>::Fold(const Tensor<1> &scale,
+                                                const Tensor<1> &shift, Scalar leak)
+{
+    return false;
+}
+
+
+template<typename Activation, int Threads>
+size_t Conv2DTranspose<Activation, Threads>::GetTensorBytes() const
+{
+    return Conv2D<Activation, Threads>::GetTensorBytes() +
+           this->packed_input_kernels.Bytes();
+}
+
+
 template<typename Activation, int Threads>
 void Conv2DTranspose<Activation, Threads>::Forward(const Tensor<4> &inputs)
 {
@@ -60,91 +97,38 @@ void Conv2DTranspose<Activation, Threads>::Forward(const Tensor<4> &inputs)
                          << this->kernels.dimensions().back() << "CHANNELS" <<
                          ", INSTEAD GOT " << inputs.dimensions().back());
 
-    this->X.resize(inputs.dimensions());
-    this->X.device(this->device) = inputs;
+    if (!this->inference_only) {
+        this->X.Set(inputs, this->borrow_input, this->device);
+    }
 
-    Eigen::Index input_rows = this->X.dimension(1);
-    Eigen::Index input_cols = this->X.dimension(2);
+    const ConvShape shape = this->AdjointShape(inputs.dimensions());
+    const Eigen::Index rows = shape.batches * shape.output_h * shape.output_w;
+    const Eigen::Index patch_size = shape.kernel_h * shape.kernel_w * shape.channels;
 
-    Eigen::Index output_h;
-    Eigen::Index output_w;
+    // without Backward Z isn't kept, A is activated in place
+    Tensor<4> &output = this->inference_only ? this->A : this->Z;
+    output.resize(shape.batches, shape.input_h, shape.input_w, shape.channels);
+    this->A.resize(output.dimensions());
 
-    // for calculating output length, not used for actual padding
-    Eigen::Index pad_h = 0;
-    Eigen::Index pad_w = 0;
+    // every input pixel times the kernels is a patch of the output, col2im
+    // scatters the patches instead of convolving the stride inflated input
+    this->PackTransposed();
 
-    if (this->padding == Padding::PADDING_SAME) {
-        // from https://github.com/keras-team/keras/blob/ab02bd5c8d75a9c8cc9f78cc7cdb5e7a01307588/keras/utils/conv_utils.py#L208
-        pad_h = std::floor((this->dilation[0] * (this->kernel_dim[0] - 1) + 1) / 2);
-        pad_w = std::floor((this->dilation[1] * (this->kernel_dim[1] - 1) + 1) / 2);
-    }
+    Scalar *patch_data = static_cast<Scalar *>(
+            this->device.allocate(rows * patch_size * sizeof(Scalar)));
 
-    output_h = (input_rows - 1) * this->stride[0] +
-               this->dilation[0] * (this->kernel_dim[0] - 1) + 1 - 2 * pad_h +
-               this->output_padding[0];
-    output_w = (input_cols - 1) * this->stride[1] +
-               this->dilation[1] * (this->kernel_dim[1] - 1) + 1 - 2 * pad_w +
-               this->output_padding[1];
-
-    // TensorFlow padding calculations, all left side variable names are preserved,
-    // right side variables localized to this class's variables as needed
-    const Eigen::Index inputRows = output_h;
-    const Eigen::Index inputCols = output_w;
-
-    const Eigen::Index outputRows = input_rows;
-    const Eigen::Index outputCols = input_cols;
-
-    // Number of filters to apply. This is the same as the output depth of the result
-    //const Eigen::Index kernelFilters = this->kernels.dimension(3);
-    // Number of channels. This is the same as the input depth.
-    //const Eigen::Index kernelChannels = this->kernels.dimension(0);
-    const Eigen::Index kernelRows = this->kernels.dimension(1);
-    const Eigen::Index kernelCols = this->kernels.dimension(2);
-
-    // This is the effective kernel size, taking into account the (*_in_stride -
-    // 1) zero-values
-    // inserted between consecutive kernel elements in atrous convolution
-    const Eigen::Index kernelRowsEff =
-            kernelRows + (kernelRows - 1) * (this->dilation[0] - 1);
-    const Eigen::Index kernelColsEff =
-            kernelCols + (kernelCols - 1) * (this->dilation[1] - 1);
-
-    // Computing the forward padding
-    const Eigen::Index forward_pad_top =
-            Eigen::numext::maxi<Eigen::Index>(
-                    0, ((outputRows - 1) * this->stride[0] + kernelRowsEff -
-                        inputRows) / 2);
-    const Eigen::Index forward_pad_left =
-            Eigen::numext::maxi<Eigen::Index>(
-                    0, ((outputCols - 1) * this->stride[1] + kernelColsEff -
-                        inputCols) / 2);
-    const Eigen::Index padding_top = kernelRowsEff - 1 - forward_pad_top;
-    const Eigen::Index padding_left = kernelColsEff - 1 - forward_pad_left;
-
-    const Eigen::Index padding_bottom =
-            inputRows - (outputRows - 1) * this->stride[0] -
-            2 - padding_top + kernelRowsEff;
-    const Eigen::Index padding_right =
-            inputCols - (outputCols - 1) * this->stride[1] -
-            2 - padding_left + kernelColsEff;
-    // END TensorFlow padding calculations
-
-    // cache paddings for backward propagation on kernel to reuse
-    this->fwd_pad[0] = padding_top;
-    this->fwd_pad[1] = padding_bottom;
-    this->fwd_pad[2] = padding_left;
-    this->fwd_pad[3] = padding_right;
-
-    this->Z.resize(inputs.dimension(0), output_h, output_w,
-                   this->kernels.dimension(0));
-    this->A.resize(this->Z.dimensions());
-
-    this->Z.template device(this->device) = this->ConvolutionForward(
-            inputs, this->kernels.reverse(Dims<4, bool>(false, true, true, false)),
-            Stride(1, 1), this->dilation, this->stride,
-            this->Z.dimensions(),
-            padding_top, padding_bottom, padding_left, padding_right);
-    this->A.template device(this->device) = Activation::Activate(this->Z);
+    Gemm::Run(rows, inputs.data(), shape.filters, 1, this->packed_kernels,
+              patch_data, patch_size, this->device);
+    ConvKernels::Col2im(shape, patch_data, output.data(), this->device);
+
+    this->device.deallocate(patch_data);
+
+    if constexpr (std::is_same_v<Activation, Linear>) {
+        ParallelCopy(this->device, output, this->A);
+    }
+    else {
+        this->A.template device(this->device) = Activation::Activate(output);
+    }
 }
 
 
@@ -160,20 +144,68 @@ void Conv2DTranspose<Activation, Threads>::Backward(const Tensor<4> &gradients)
     this->dL_dZ.template device(this->device) =
             gradients * Activation::Gradients(this->Z);
 
-    this->dL_dk.template device(this->device) =
-            this->ConvolutionBackwardKernel(
-                            this->X, this->dL_dZ,
-                            this->dilation, Inflate(1, 1), this->stride,
-                            this->kernels.dimensions(),
-                            this->fwd_pad[0], this->fwd_pad[1],
-                            this->fwd_pad[2], this->fwd_pad[3])
-                    .template reverse(Dims<4, bool>(false, true, true, false));
+    const ConvShape shape = this->AdjointShape(this->X->dimensions());
+    const Eigen::Index rows = shape.batches * shape.output_h * shape.output_w;
+    const Eigen::Index taps = shape.kernel_h * shape.kernel_w;
+
+    // dL/dk is the adjoint convolution's kernel gradients, im2col(dL/dZ)^T x X
+    // as [KH * KW, C, F], each tap's rows are moved into the kernels' [C, KH * KW, F]
+    Scalar *patch_data = static_cast<Scalar *>(
+            this->device.allocate(rows * taps * shape.channels * sizeof(Scalar)));
+    Scalar *dk = static_cast<Scalar *>(
+            this->device.allocate(this->dL_dk.size() * sizeof(Scalar)));
+
+    ConvKernels::Im2col(shape, this->dL_dZ.data(), patch_data, this->device);
+
+    TensorMap<2>(dk, taps * shape.channels, shape.filters).device(this->device) =
+            TensorMap<2>(patch_data, rows, taps * shape.channels)
+                    .contract(TensorMapConst<2>(this->X->data(), rows, shape.filters),
+                              ContractDim {Axes(0, 0)});
+
+    ParallelFor(this->device, taps * shape.channels, shape.filters, [&](Eigen::Index i) {
+        const Eigen::Index tap = i / shape.channels;
+        const Eigen::Index c = i % shape.channels;
+        std::copy_n(dk + i * shape.filters, shape.filters,
+                    this->dL_dk.data() + (c * taps + tap) * shape.filters);
+    });
+
+    this->device.deallocate(dk);
+    this->device.deallocate(patch_data);
 }
 
 
 template<typename Activation, int Threads>
 const Tensor<4> &Conv2DTranspose<Activation, Threads>::GetInputGradients4D()
 {
+    const ConvShape shape = this->AdjointShape(this->X->dimensions());
+    const Eigen::Index rows = shape.batches * shape.output_h * shape.output_w;
+    const Eigen::Index patch_size = shape.kernel_h * shape.kernel_w * shape.channels;
+
+    // dL/dX is the adjoint convolution's forward of dL/dZ, im2col(dL/dZ) x
+    // the kernels as [KH * KW * F, C]
+    this->PackTransposed();
+    this->dL_dX.resize(this->X->dimensions());
+
+    Scalar *patch_data = static_cast<Scalar *>(
+            this->device.allocate(rows * patch_size * sizeof(Scalar)));
+
+    ConvKernels::Im2col(shape, this->dL_dZ.data(), patch_data, this->device);
+    Gemm::Run(rows, patch_data, patch_size, 1, this->packed_input_kernels,
+              this->dL_dX.data(), shape.filters, this->device);
+
+    this->device.deallocate(patch_data);
+    return this->dL_dX;
+}
+
+
+template<typename Activation, int Threads>
+ConvShape Conv2DTranspose<Activation, Threads>::AdjointShape(
+        const Dims<4> &input_dims) const
+{
+    const Eigen::Index input_rows = input_dims[1];
+    const Eigen::Index input_cols = input_dims[2];
+
+    // for calculating output length, not used for actual padding
     Eigen::Index pad_h = 0;
     Eigen::Index pad_w = 0;
 
@@ -183,53 +215,57 @@ const Tensor<4> &Conv2DTranspose<Activation, Threads>::GetInputGradients4D()
         pad_w = std::floor((this->dilation[1] * (this->kernel_dim[1] - 1) + 1) / 2);
     }
 
-    // TensorFlow padding calculations, all left side variable names are preserved,
-    // right side variables localized to this class's variables as needed
-    const Eigen::Index inputRows = this->dL_dZ.dimension(1);
-    const Eigen::Index inputCols = this->dL_dZ.dimension(2);
-
-    const Eigen::Index outputRows = this->X.dimension(1);
-    const Eigen::Index outputCols = this->X.dimension(2);
-
-    // Number of filters to apply. This is the same as the output depth of the result
-    //const Eigen::Index kernelFilters = this->kernels.dimension(3);
-    // Number of channels. This is the same as the input depth.
-    //const Eigen::Index kernelChannels = this->kernels.dimension(0);
-    const Eigen::Index kernelRows = this->kernels.dimension(1);
-    const Eigen::Index kernelCols = this->kernels.dimension(2);
-
-    // This is the effective kernel size, taking into account the (*_in_stride -
-    // 1) zero-values
-    // inserted between consecutive kernel elements in atrous convolution
-    const Eigen::Index kernelRowsEff =
-            kernelRows + (kernelRows - 1) * (this->dilation[0] - 1);
-    const Eigen::Index kernelColsEff =
-            kernelCols + (kernelCols - 1) * (this->dilation[1] - 1);
-
-    // Computing the forward padding
-    const Eigen::Index forward_pad_top =
-            Eigen::numext::maxi<Eigen::Index>(
-                    0, ((outputRows - 1) * this->stride[0] + kernelRowsEff -
-                        inputRows) / 2);
-    const Eigen::Index forward_pad_left =
-            Eigen::numext::maxi<Eigen::Index>(
-                    0, ((outputCols - 1) * this->stride[1] + kernelColsEff -
-                        inputCols) / 2);
-    // END TensorFlow padding calculations
-
-    const Eigen::Index forward_pad_bottom = 2 * pad_h - forward_pad_top;
-    const Eigen::Index forward_pad_right = 2 * pad_w - forward_pad_left;
-
-    this->dL_dX.resize(this->X.dimensions());
-
-    this->dL_dX.template device(this->device) =
-            Conv2D<Activation, Threads>::ConvolutionBackwardInput(
-                    this->dL_dZ, this->kernels.template reverse(Dims<4, bool>(false, true, true, false)),
-                    this->stride, this->dilation, Inflate(1, 1),
-                    this->X.dimensions(),
-                    forward_pad_top, forward_pad_bottom, forward_pad_left,
-                    forward_pad_right);
-    return this->dL_dX;
+    const Eigen::Index output_h = (input_rows - 1) * this->stride[0] +
+                                  this->dilation[0] * (this->kernel_dim[0] - 1) + 1 -
+                                  2 * pad_h + this->output_padding[0];
+    const Eigen::Index output_w = (input_cols - 1) * this->stride[1] +
+                                  this->dilation[1] * (this->kernel_dim[1] - 1) + 1 -
+                                  2 * pad_w + this->output_padding[1];
+
+    // effective kernel size, taking into account the zeros inserted between
+    // consecutive kernel elements in atrous convolution
+    const Eigen::Index kernel_rows_eff = this->dilation[0] * (this->kernel_dim[0] - 1) + 1;
+    const Eigen::Index kernel_cols_eff = this->dilation[1] * (this->kernel_dim[1] - 1) + 1;
+
+    // TensorFlow's forward padding, the padding of the adjoint convolution
+    const Eigen::Index pad_top = Eigen::numext::maxi<Eigen::Index>(
+            0, ((input_rows - 1) * this->stride[0] + kernel_rows_eff - output_h) / 2);
+    const Eigen::Index pad_left = Eigen::numext::maxi<Eigen::Index>(
+            0, ((input_cols - 1) * this->stride[1] + kernel_cols_eff - output_w) / 2);
+    const Eigen::Index pad_bottom = (input_rows - 1) * this->stride[0] +
+                                    kernel_rows_eff - output_h - pad_top;
+    const Eigen::Index pad_right = (input_cols - 1) * this->stride[1] +
+                                   kernel_cols_eff - output_w - pad_left;
+
+    return {input_dims[0], output_h, output_w, this->kernels.dimension(0),
+            input_rows, input_cols, input_dims[3],
+            this->kernel_dim[0], this->kernel_dim[1], this->stride[0], this->stride[1],
+            this->dilation[0], this->dilation[1],
+            pad_top, pad_bottom, pad_left, pad_right};
+}
+
+
+template<typename Activation, int Threads>
+void Conv2DTranspose<Activation, Threads>::PackTransposed()
+{
+    if (!this->packed_stale) {
+        return;
+    }
+
+    // kernels [F, KH, KW, C] as [C, KH * KW * F], the adjoint convolution's
+    // kernels with its filters first
+    const Eigen::Index filters = this->kernels.dimension(0);
+    const Eigen::Index channels = this->kernels.dimension(3);
+    const Eigen::Index patch_size = this->kernels.size() / channels;
+
+    Tensor<3> transposed = TensorMap<3>(this->kernels.data(), filters,
+                                        patch_size / filters, channels)
+            .shuffle(Dims<3>(2, 1, 0));
+
+    this->packed_kernels.Pack(transposed.data(), channels, patch_size, patch_size, 1);
+    this->packed_input_kernels.Pack(transposed.data(), patch_size, channels,
+                                    1, patch_size);
+    this->packed_stale = false;
 }
 
-} // namespace fl
\ No newline at end of file
+} // namespace fl
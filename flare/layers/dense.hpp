@@ -64,6 +64,35 @@ public:
     void Update(Optimizer &optimizer) override;
 
 
+    /**
+     * @return   flat views over the weights, in the order of GetParameterGradients
+     */
+    std::vector<TensorMap<1>> GetParameters() override;
+
+
+    /**
+     * @return   flat views over dL/dw
+     */
+    std::vector<TensorMap<1>> GetParameterGradients() override;
+
+
+    Layer *Clone() const override;
+
+
+    size_t GetTensorBytes() const override;
+
+
+    /**
+     * With GemmBackend::PACKED, Forward and the input gradients multiply with
+     * weights packed once per Update instead of contracting
+     */
+    void SetGemmBackend(GemmBackend backend) override;
+
+    void Freeze(bool frozen) override;
+
+    void SetInferenceOnly(bool inference_only) override;
+
+
     // getter setters
 
 
@@ -108,23 +137,104 @@ private:
     // backpropagation is a bit different from most activation functions
     EIGEN_STRONG_INLINE void BackwardSoftmax(const Tensor<2> &gradients);
 
+
+    // adds the bias to count values of sample's row of Z starting at unit and
+    // writes their activations into A, except for Softmax
+    EIGEN_STRONG_INLINE static void BiasActivate(
+            const Scalar *bias, Scalar *activations, Eigen::Index units,
+            Scalar *z, Eigen::Index sample, Eigen::Index unit, Eigen::Index count)
+    {
+        TensorMap<1> z_row(z, count);
+
+        if (bias) {
+            z_row += TensorMapConst<1>(bias + unit, count);
+        }
+
+        if constexpr (!std::is_same_v<Activation, Softmax>) {
+            TensorMap<1>(activations + sample * units + unit, count) =
+                    Activation::Activate(z_row);
+        }
+    }
+
+
+    /**
+     * Contraction output kernel of Forward, adds the bias to each block of Z
+     * computed by the contraction and writes the block's activations into A.
+     * Runs on the block while it is still in cache instead of passing over Z
+     * again for the bias and once more for the activation
+     */
+    struct BiasActivationKernel
+    {
+        template<typename Index, typename S>
+        EIGEN_ALWAYS_INLINE void operator()(
+                const Eigen::internal::blas_data_mapper<S, Index, Eigen::ColMajor> &output,
+                const Eigen::TensorContractionParams &params, Index i, Index j,
+                Index num_rows, Index num_cols) const
+        {
+            if (params.swapped_arguments) {
+                // row major tensors are contracted with swapped arguments, the
+                // rows of a block are output units and its columns are samples
+                for (Index col = 0; col < num_cols; col++) {
+                    Dense::BiasActivate(this->bias, this->activations, this->units,
+                                        &output(0, col), j + col, i, num_rows);
+                }
+
+                return;
+            }
+
+            // column major, the columns of a block are output units
+            for (Index col = 0; col < num_cols; col++) {
+                TensorMap<1> z(&output(0, col), num_rows);
+
+                if (this->bias) {
+                    z += z.constant(this->bias[j + col]);
+                }
+
+                if constexpr (!std::is_same_v<Activation, Softmax>) {
+                    TensorMap<1>(this->activations + (j + col) * this->samples + i,
+                                 num_rows) = Activation::Activate(z);
+                }
+            }
+        }
+
+
+        const Scalar *bias; // null without bias
+        Scalar *activations; // A
+        Eigen::Index units;
+        Eigen::Index samples;
+    };
+
+
+    // pack the weights for GemmBackend::PACKED or a frozen layer if they changed
+    void PackWeights();
+
+
+    // whether Forward multiplies with packed_w
+    bool Packed() const
+    {
+        return this->gemm == GemmBackend::PACKED || this->frozen;
+    }
+
+
     bool use_bias = true;
 
-    Tensor<2> X; // layer input matrix
+    LayerInput<2> X; // layer input matrix
     Tensor<2> Z; // weighted input matrix, Z = w*X + b
     Tensor<2> A; // activated input matrix after applying g(Z)
     Tensor<2> dL_dZ; // gradients of layer output, received from next layer
     Tensor<2> dL_dX; // input gradients, passed to previous layer as dL_dZ
 
     Tensor<2> w; // weights matrix
-    Tensor<2> b; // bias vector
+    Tensor<2> b; // bias, [1, output units]
     Tensor<2> dL_dw; // loss gradients w.r.t. weights
     Tensor<2> dL_db; // loss gradients w.r.t. bias
 
-    // multithreading
-    Eigen::ThreadPool pool = Eigen::ThreadPool(
-            (int) std::thread::hardware_concurrency());
-    Eigen::ThreadPoolDevice device = Eigen::ThreadPoolDevice(&pool, 2);
+    GemmBackend gemm = GemmBackend::CONTRACTION;
+    PackedMatrix packed_w; // w packed for Forward
+    PackedMatrix packed_w_t; // transpose of w packed for the input gradients
+    bool packed_stale = true; // w changed since packed_w was packed
+    bool packed_t_stale = true; // w changed since packed_w_t was packed
+    bool frozen = false; // packed_w is kept for inference
 
 };
 
@@ -19,9 +19,9 @@ Dense<Activation>::Dense(int inputs, int outputs, bool use_bias,
     this->dL_dw.resize(this->w.dimensions());
 
     if (this->use_bias) {
-        throw std::invalid_argument("bias not available");
-        this->b.resize(outputs, 1);
+        this->b.resize(1, outputs);
         this->b.setZero();
+        this->dL_db.resize(this->b.dimensions());
     }
 }
 
@@ -35,23 +35,49 @@ void Dense<Activation>::Forward(const Tensor<2> &input)
                          << input.dimension(1));
 
     // Z = Xw + b (same as Z = wX + b but with batch dims first in X)
-    this->X.resize(input.dimensions());
-    this->X.device(this->device) = input;
+    if (!this->inference_only) {
+        this->X.Set(input, this->borrow_input, this->device);
+    }
 
     // resize output tensor to [batch, output_units]
-    this->Z.resize(input.dimension(0), this->w.dimension(1));
-    this->A.resize(this->Z.dimensions());
-
-    this->Z.template device(this->device) =
-            this->X.contract(this->w, ContractDim {Axes(1, 0)});
-
-    //if (this->use_bias) {
-    // broadcast bias into the shape of Z
-    //this->Z += this->b.broadcast(
-    //Eigen::array<Eigen::Index, 2>({1, input.dimension(1)}));
-    //}
+    this->A.resize(input.dimension(0), this->w.dimension(1));
+
+    // without Backward Z isn't kept, the activations overwrite it in place,
+    // except for Softmax which needs whole rows of Z
+    constexpr bool softmax = std::is_same_v<Activation, Softmax>;
+    Tensor<2> &output = this->inference_only && !softmax ? this->A : this->Z;
+    output.resize(this->A.dimensions());
+
+    const Scalar *bias = this->use_bias ? this->b.data() : nullptr;
+    const Eigen::Index units = this->w.dimension(1);
+
+    // the bias and activation are applied to each block of Z as soon as the
+    // matrix multiplication has computed it, while the block is still in cache
+    if (this->Packed()) {
+        this->PackWeights();
+        Scalar *activations = this->A.data();
+
+        Gemm::Run(input.dimension(0), input.data(), input.dimension(1), 1,
+                  this->packed_w, output.data(), units, this->device,
+                  [bias, activations, units](Scalar *z, Eigen::Index ldc,
+                                             Eigen::Index unit, Eigen::Index rows,
+                                             Eigen::Index cols) {
+                      for (Eigen::Index sample = 0; sample < rows; sample++) {
+                          Dense::BiasActivate(bias, activations, units,
+                                              z + sample * ldc, sample, unit, cols);
+                      }
+                  });
+    }
+    else {
+        output.template device(this->device) = input.contract(
+                this->w, ContractDim {Axes(1, 0)},
+                BiasActivationKernel {bias, this->A.data(), units, input.dimension(0)});
+    }
 
-    this->A.template device(this->device) = Activation::Activate(this->Z);
+    if constexpr (softmax) {
+        // softmax needs whole rows of Z, the kernel only adds the bias
+        Activation::Activate(this->Z, this->A, this->device);
+    }
 }
 
 
@@ -89,7 +115,7 @@ void Dense<Activation>::Backward(const Tensor<2> &gradients) // output backward
 
     // dL / dw = (dL / dZ) * (dZ / dw)
     this->dL_dw.template device(this->device) =
-            this->X.contract(this->dL_dZ, ContractDim {Axes(0, 0)});
+            this->X->contract(this->dL_dZ, ContractDim {Axes(0, 0)});
 
 
     fl_assert(this->w.dimensions() == this->dL_dw.dimensions(),
@@ -99,11 +125,9 @@ void Dense<Activation>::Backward(const Tensor<2> &gradients) // output backward
                          << this->dL_dw.dimensions());
 
     if (this->use_bias) {
-        throw std::invalid_argument("bias not available yet");
-        // dL/db = dL/dZ, if batch size > 1 then sum along the 1st dimension (col)
-        this->dL_db = this->dL_dZ.sum(Eigen::array<int, 1> {1}).reshape(
-                Tensor<2>::Dimensions(this->dL_dZ.dimension(0), 1)) /
-                      (Scalar) this->dL_dZ.dimension(1);
+        // dL/db = dL/dZ summed over the batch, like dL/dw
+        this->dL_db.template device(this->device) = this->dL_dZ.sum(Dims<1>(0))
+                .reshape(this->b.dimensions());
 
         fl_assert(this->b.dimensions() == this->dL_db.dimensions(),
                   this->name << " Dense::Backward BIAS DIMENSIONS "
@@ -122,6 +146,112 @@ void Dense<Activation>::Update(Optimizer &optimizer)
     if (this->use_bias) {
         optimizer.Minimize(this->b, this->dL_db);
     }
+
+    this->packed_stale = this->packed_t_stale = true;
+    this->PackWeights();
+}
+
+
+template<typename Activation>
+std::vector<TensorMap<1>> Dense<Activation>::GetParameters()
+{
+    // the caller may write the weights through the views
+    this->packed_stale = this->packed_t_stale = true;
+
+    if (this->use_bias) {
+        return {Layer::FlatView(this->w), Layer::FlatView(this->b)};
+    }
+
+    return {Layer::FlatView(this->w)};
+}
+
+
+template<typename Activation>
+std::vector<TensorMap<1>> Dense<Activation>::GetParameterGradients()
+{
+    if (this->use_bias) {
+        return {Layer::FlatView(this->dL_dw), Layer::FlatView(this->dL_db)};
+    }
+
+    return {Layer::FlatView(this->dL_dw)};
+}
+
+
+template<typename Activation>
+Layer *Dense<Activation>::Clone() const
+{
+    return new Dense<Activation>(*this);
+}
+
+
+template<typename Activation>
+size_t Dense<Activation>::GetTensorBytes() const
+{
+    return Layer::TensorBytes(this->X, this->Z, this->A, this->dL_dZ, this->dL_dX,
+                              this->w, this->b, this->dL_dw, this->dL_db) +
+           this->packed_w.Bytes() + this->packed_w_t.Bytes();
+}
+
+
+template<typename Activation>
+void Dense<Activation>::SetGemmBackend(GemmBackend backend)
+{
+    this->gemm = Gemm::available ? backend : GemmBackend::CONTRACTION;
+    this->packed_stale = this->packed_t_stale = true;
+
+    if (this->gemm == GemmBackend::CONTRACTION) {
+        this->packed_w_t = PackedMatrix();
+
+        if (!this->frozen) {
+            this->packed_w = PackedMatrix();
+        }
+    }
+}
+
+
+template<typename Activation>
+void Dense<Activation>::Freeze(bool frozen)
+{
+    this->frozen = frozen && Gemm::available;
+
+    if (this->frozen) {
+        this->PackWeights();
+    }
+    else if (this->gemm == GemmBackend::CONTRACTION) {
+        this->packed_w = PackedMatrix();
+        this->packed_stale = true;
+    }
+}
+
+
+template<typename Activation>
+void Dense<Activation>::SetInferenceOnly(bool inference_only)
+{
+    Layer::SetInferenceOnly(inference_only);
+
+    if (inference_only) {
+        Layer::FreeTensors(this->X, this->Z, this->dL_dZ, this->dL_dX,
+                           this->dL_dw, this->dL_db);
+        this->packed_w_t = PackedMatrix();
+        this->packed_t_stale = true;
+        return;
+    }
+
+    this->dL_dw.resize(this->w.dimensions());
+
+    if (this->use_bias) {
+        this->dL_db.resize(this->b.dimensions());
+    }
+}
+
+
+template<typename Activation>
+void Dense<Activation>::PackWeights()
+{
+    if (this->Packed() && this->packed_stale) {
+        this->packed_w.Pack(this->w);
+        this->packed_stale = false;
+    }
 }
 
 
@@ -135,7 +265,21 @@ const Tensor<2> &Dense<Activation>::GetOutput2D() const
 template<typename Activation>
 const Tensor<2> &Dense<Activation>::GetInputGradients2D()
 {
-    this->dL_dX.resize(this->X.dimensions());
+    this->dL_dX.resize(this->X->dimensions());
+
+    if (this->gemm == GemmBackend::PACKED) {
+        // packed on first use after an update, inference never needs it
+        if (this->packed_t_stale) {
+            this->packed_w_t.PackTransposed(this->w);
+            this->packed_t_stale = false;
+        }
+
+        Gemm::Run(this->dL_dZ.dimension(0), this->dL_dZ.data(),
+                  this->dL_dZ.dimension(1), 1, this->packed_w_t, this->dL_dX.data(),
+                  this->dL_dX.dimension(1), this->device);
+        return this->dL_dX;
+    }
+
     this->dL_dX.template device(this->device) = this->dL_dZ.contract(
             this->w, ContractDim {Axes(1, 1)});
     return this->dL_dX;
@@ -145,6 +289,10 @@ const Tensor<2> &Dense<Activation>::GetInputGradients2D()
 template<typename Activation>
 std::vector<fl::Tensor<2>> Dense<Activation>::GetWeights2D() const
 {
+    if (this->use_bias) {
+        return {this->w, this->b};
+    }
+
     return {this->w};
 }
 
@@ -152,6 +300,10 @@ std::vector<fl::Tensor<2>> Dense<Activation>::GetWeights2D() const
 template<typename Activation>
 std::vector<fl::Tensor<2>> Dense<Activation>::GetWeightGradients2D() const
 {
+    if (this->use_bias) {
+        return {this->dL_dw, this->dL_db};
+    }
+
     return {this->dL_dw};
 }
 
@@ -166,27 +318,36 @@ void Dense<Activation>::SetWeights(const std::vector<fl::Tensor<2>> &weights)
         throw std::invalid_argument(error_msg.str());
     }
 
+    if (this->use_bias && weights.size() > 1) {
+        if (weights[1].dimensions() != this->b.dimensions()) {
+            std::ostringstream error_msg;
+            error_msg << this->name << " Dense::SetWeights EXPECTED BIAS DIMENSIONS "
+                      << this->b.dimensions() << ", GOT " << weights[1].dimensions();
+            throw std::invalid_argument(error_msg.str());
+        }
+
+        this->b = weights[1];
+    }
+
     this->w = weights.front();
+    this->packed_stale = this->packed_t_stale = true;
 }
 
 
 template<typename Activation>
 void Dense<Activation>::BackwardSoftmax(const Tensor<2> &gradients)
 {
-    // TODO: performance improvement by eliminating for loop
     this->dL_dZ.resize(this->Z.dimensions());
 
-    // pass in the layer activations to avoid recalculating the softmax values
-    Tensor<3> softmax_grad(this->A.dimension(0),
-                           this->A.dimension(1), this->A.dimension(1));
-    softmax_grad.template device(this->device) = Softmax::Gradients(this->A);
+    // the product of each sample's gradients with its softmax Jacobian
+    // S_i * (d_ij - S_j) simplifies to S_i * (g_i - sum_j g_j * S_j), no
+    // Jacobian is built
+    Dims<2> sum_dims(this->A.dimension(0), 1);
+    Dims<2> bcast(1, this->A.dimension(1));
 
-    for (int batch = 0; batch < gradients.dimension(0); batch++) {
-        this->dL_dZ.chip(batch, 0).template device(this->device) =
-                gradients.chip(batch, 0)
-                        .contract(softmax_grad.chip(batch, 0),
-                                  ContractDim {Axes(0, 1)});
-    }
+    this->dL_dZ.template device(this->device) =
+            this->A * (gradients - (gradients * this->A).sum(Dims<1>(1))
+                    .reshape(sum_dims).eval().broadcast(bcast));
 }
 
 
@@ -201,10 +362,14 @@ void Dense<Activation>::Save(const std::string &path)
                 this->name + "::Save INVALID FILE PATH: " + path);
     }
 
-    // flatten the weights and write it to the file with a white space delimiter
-    Tensor<1> flatten = this->w.reshape(Dims<1>(this->w.size()));
+    // flatten the weights and write it to the file with a white space delimiter,
+    // followed by the bias
+    std::vector<Scalar> as_vector(this->w.data(), this->w.data() + this->w.size());
+
+    if (this->use_bias) {
+        as_vector.insert(as_vector.end(), this->b.data(), this->b.data() + this->b.size());
+    }
 
-    std::vector<Scalar> as_vector(flatten.data(), flatten.data() + flatten.size());
     std::copy(as_vector.begin(), as_vector.end(),
               std::ostream_iterator<Scalar>(output_file, " "));
     output_file.close();
@@ -225,16 +390,22 @@ void Dense<Activation>::Load(const std::string &path)
               std::istream_iterator<Scalar>(), std::back_inserter(as_vector));
     read_weights.close();
 
-    if (as_vector.size() != this->w.size()) {
+    if (static_cast<Eigen::Index>(as_vector.size()) != this->w.size() + this->b.size()) {
         std::ostringstream error_msg;
         error_msg << this->name << "::Load " << path << " EXPECTED "
-                  << this->w.dimensions() << "=" << this->w.size() << " VALUES, GOT "
+                  << this->w.dimensions() << "+" << this->b.dimensions() << "="
+                  << this->w.size() + this->b.size() << " VALUES, GOT "
                   << as_vector.size() << " INSTEAD";
         throw std::invalid_argument(error_msg.str());
     }
 
     // reshape the flattened tensor back to expected weights dimensions
     this->w = TensorMap<2>(as_vector.data(), this->w.dimensions());
+    this->packed_stale = this->packed_t_stale = true;
+
+    if (this->use_bias) {
+        this->b = TensorMap<2>(as_vector.data() + this->w.size(), this->b.dimensions());
+    }
 }
 
 } // namespace fl
\ No newline at end of file
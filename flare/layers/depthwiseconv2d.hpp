@@ -0,0 +1,46 @@
+//
+// Created by R on 10/18/26.
+//
+
+#ifndef FLARE_DEPTHWISECONV2D_HPP
+#define FLARE_DEPTHWISECONV2D_HPP
+
+#include "conv2d.hpp"
+
+namespace fl
+{
+
+template<typename Activation, int Threads = 2>
+class DepthwiseConv2D : public Conv2D<Activation, Threads>
+{
+public:
+    /**
+     * Depthwise 2D convolution, a Conv2D with one group per input channel.
+     * Each channel is convolved with depth_multiplier kernels of its own,
+     * output channel c * depth_multiplier + m is channel c's m-th kernel
+     *
+     * @param input_channels     input tensor channels
+     * @param kernel             kernel dimensions, Kernel(height, width)
+     * @param stride             stride dimensions, Stride(height, width)
+     * @param dilation           dilation dimensions, Dilation(height, width)
+     * @param padding            padding type, Padding::PADDING_VALID or Padding::PADDING_SAME
+     * @param depth_multiplier   output channels per input channel
+     * @param initializer        kernel initialization method
+     */
+    DepthwiseConv2D(int input_channels, const Kernel &kernel,
+                    const Stride &stride, const Dilation &dilation, Padding padding,
+                    int depth_multiplier = 1,
+                    const Initializer<4> &initializer = GlorotUniform<4>());
+
+    DepthwiseConv2D(int input_channels, const Kernel &kernel,
+                    Padding padding = Padding::PADDING_VALID, int depth_multiplier = 1,
+                    const Initializer<4> &initializer = GlorotUniform<4>());
+
+    Layer *Clone() const override;
+};
+
+} // namespace fl
+
+#include "depthwiseconv2d.ipp"
+
+#endif //FLARE_DEPTHWISECONV2D_HPP
@@ -0,0 +1,40 @@
+//
+// Created by R on 10/18/26.
+//
+
+#include "depthwiseconv2d.hpp"
+
+namespace fl
+{
+
+template<typename Activation, int Threads>
+DepthwiseConv2D<Activation, Threads>::DepthwiseConv2D(
+        int input_channels, const Kernel &kernel,
+        const Stride &stride, const Dilation &dilation, Padding padding,
+        int depth_multiplier, const Initializer<4> &initializer) :
+        Conv2D<Activation, Threads>(input_channels * depth_multiplier, input_channels,
+                                    kernel, stride, dilation, padding, initializer,
+                                    input_channels)
+{
+    this->name = "depthwise_conv2d";
+}
+
+
+template<typename Activation, int Threads>
+DepthwiseConv2D<Activation, Threads>::DepthwiseConv2D(
+        int input_channels, const Kernel &kernel, Padding padding,
+        int depth_multiplier, const Initializer<4> &initializer)
+        : DepthwiseConv2D(input_channels, kernel, Stride(1, 1), Dilation(1, 1),
+                          padding, depth_multiplier, initializer)
+{
+    // nothing to do
+}
+
+
+template<typename Activation, int Threads>
+Layer *DepthwiseConv2D<Activation, Threads>::Clone() const
+{
+    return new DepthwiseConv2D<Activation, Threads>(*this);
+}
+
+} // namespace fl
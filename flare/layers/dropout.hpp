@@ -28,6 +28,12 @@ public:
 
     void Update(Optimizer &) override;
 
+    Layer *Clone() const override;
+
+    size_t GetTensorBytes() const override;
+
+    void SetInferenceOnly(bool inference_only) override;
+
     const Tensor<2> &GetOutput2D() const override;
 
     const Tensor<3> &GetOutput3D() const override;
@@ -68,9 +74,6 @@ private:
     // saves the dropout rate when layer is set for inference mode (no dropout)
     Scalar _dropout_rate_copy;
 
-    Eigen::ThreadPool pool = Eigen::ThreadPool((int) std::thread::hardware_concurrency());
-    Eigen::ThreadPoolDevice device = Eigen::ThreadPoolDevice(&pool, 2);
-
 };
 
 } // namespace fl
@@ -23,6 +23,13 @@ Dropout<InputTensorRank>::Dropout(Scalar dropout_rate)
 template<int InputTensorRank>
 void Dropout<InputTensorRank>::Forward(const Tensor<InputTensorRank> &inputs)
 {
+    if (this->inference_only) {
+        // no mask without training, only Backward needs it
+        this->Z.resize(inputs.dimensions());
+        ParallelCopy(this->device, inputs, this->Z);
+        return;
+    }
+
     // generate a tensor on a Bernoulli distribution where
     // (1 - dropout_chance) is the chance of keeping an input feature
     this->drop_mask = RandomBernoulli(inputs.dimensions(),
@@ -61,7 +68,7 @@ void Dropout<InputTensorRank>::Backward(const Tensor<InputTensorRank> &gradients
 
 
     this->dL_dZ.resize(gradients.dimensions());
-    this->dL_dZ.device(this->device) = gradients;
+    ParallelCopy(this->device, gradients, this->dL_dZ);
 }
 
 
@@ -90,6 +97,31 @@ void Dropout<InputTensorRank>::Update(Optimizer &)
 }
 
 
+template<int InputTensorRank>
+Layer *Dropout<InputTensorRank>::Clone() const
+{
+    return new Dropout<InputTensorRank>(*this);
+}
+
+
+template<int InputTensorRank>
+void Dropout<InputTensorRank>::SetInferenceOnly(bool inference_only)
+{
+    Layer::SetInferenceOnly(inference_only);
+
+    if (inference_only) {
+        Layer::FreeTensors(this->dL_dZ, this->dL_dX, this->drop_mask);
+    }
+}
+
+
+template<int InputTensorRank>
+size_t Dropout<InputTensorRank>::GetTensorBytes() const
+{
+    return Layer::TensorBytes(this->Z, this->dL_dZ, this->dL_dX, this->drop_mask);
+}
+
+
 #ifdef _WIN32
 #pragma GCC diagnostic ignored "-Wreturn-local-addr"
 #elif defined __unix__ || defined __APPLE__ || defined __linux__
@@ -25,6 +25,16 @@ public:
 
     void Update(Optimizer &optimizer) override;
 
+    std::vector<TensorMap<1>> GetParameters() override;
+
+    std::vector<TensorMap<1>> GetParameterGradients() override;
+
+    Layer *Clone() const override;
+
+    size_t GetTensorBytes() const override;
+
+    void SetInferenceOnly(bool inference_only) override;
+
     const Tensor<3> &GetOutput3D() const override;
 
     std::vector<Tensor<2>> GetWeights2D() const override;
@@ -54,11 +64,6 @@ public:
 
     Eigen::Index embed_dims;
     Eigen::Index input_len;
-
-    // multithreading
-    Eigen::ThreadPool pool = Eigen::ThreadPool(
-            (int) std::thread::hardware_concurrency());
-    Eigen::ThreadPoolDevice device = Eigen::ThreadPoolDevice(&pool, 2);
 };
 
 } // namespace fl
@@ -32,8 +32,10 @@ void Embedding::Forward(const Tensor<2> &inputs)
                          << " input features, got " << inputs.dimension(0));
 
     // store the input so backpropagation knows which weight rows to update
-    this->X.resize(inputs.dimensions());
-    this->X.device(this->device) = inputs;
+    if (!this->inference_only) {
+        this->X.resize(inputs.dimensions());
+        ParallelCopy(this->device, inputs, this->X);
+    }
 
     // layer output shape is (batch=input.cols, row=input.rows, embed_dim)
     this->Z.resize(Dims<3>(
@@ -45,10 +47,10 @@ void Embedding::Forward(const Tensor<2> &inputs)
         for (Eigen::Index i = 0; i < inputs.dimension(1); i++) {
             Dims<3> z_offset(batch, i, 0);
 
-            fl_assert(this->X(batch, i) >= 0 &&
-                      this->X(batch, i) < this->w.dimension(0),
+            fl_assert(inputs(batch, i) >= 0 &&
+                      inputs(batch, i) < this->w.dimension(0),
                       this->name + " Forward() input value " +
-                      std::to_string(this->X(batch, i)) + " is out embedding range");
+                      std::to_string(inputs(batch, i)) + " is out embedding range");
 
             this->Z.slice(z_offset, z_extent).device(this->device) =
                     this->w.chip(static_cast<Eigen::Index>(inputs(batch, i)), 0)
@@ -103,6 +105,44 @@ void Embedding::Update(Optimizer &optimizer)
 }
 
 
+std::vector<TensorMap<1>> Embedding::GetParameters()
+{
+    return {Layer::FlatView(this->w)};
+}
+
+
+std::vector<TensorMap<1>> Embedding::GetParameterGradients()
+{
+    return {Layer::FlatView(this->dL_dw)};
+}
+
+
+Layer *Embedding::Clone() const
+{
+    return new Embedding(*this);
+}
+
+
+void Embedding::SetInferenceOnly(bool inference_only)
+{
+    Layer::SetInferenceOnly(inference_only);
+
+    if (inference_only) {
+        Layer::FreeTensors(this->X, this->dL_dZ, this->dL_dw);
+        return;
+    }
+
+    this->dL_dw.resize(this->w.dimensions());
+    this->dL_dw.setZero();
+}
+
+
+size_t Embedding::GetTensorBytes() const
+{
+    return Layer::TensorBytes(this->X, this->Z, this->dL_dZ, this->dL_dX, this->w, this->dL_dw);
+}
+
+
 const Tensor<3> &Embedding::GetOutput3D() const
 {
     return this->Z;
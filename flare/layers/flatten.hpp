@@ -33,6 +33,12 @@ public:
 
     void Update(Optimizer &) override;
 
+    Layer *Clone() const override;
+
+    size_t GetTensorBytes() const override;
+
+    void SetInferenceOnly(bool inference_only) override;
+
     const Tensor<2> &GetOutput2D() const override;
 
     const Tensor<2> &GetInputGradients2D() override;
@@ -51,11 +57,6 @@ private:
     Tensor<2> Z;
     Tensor<InputTensorRank> dL_dZ;
     Tensor<InputTensorRank> dL_dX;
-
-    // multithreading
-    Eigen::ThreadPool pool = Eigen::ThreadPool(
-            (int) std::thread::hardware_concurrency());
-    Eigen::ThreadPoolDevice device = Eigen::ThreadPoolDevice(&pool, 2);
 };
 
 } // namespace fl
@@ -64,7 +64,7 @@ void Flatten<InputTensorRank>::Backward(const Tensor<InputTensorRank> &gradients
 
     // reshape gradients to this layer's input's dimensions
     if constexpr (InputTensorRank == 2) {
-        this->dL_dZ.device(this->device) = gradients;
+        ParallelCopy(this->device, gradients, this->dL_dZ);
     }
     else {
         this->dL_dZ.device(this->device) = gradients.reshape(this->input_dims);
@@ -86,6 +86,31 @@ void Flatten<InputTensorRank>::Update(Optimizer &)
 }
 
 
+template<int InputTensorRank>
+Layer *Flatten<InputTensorRank>::Clone() const
+{
+    return new Flatten<InputTensorRank>(*this);
+}
+
+
+template<int InputTensorRank>
+void Flatten<InputTensorRank>::SetInferenceOnly(bool inference_only)
+{
+    Layer::SetInferenceOnly(inference_only);
+
+    if (inference_only) {
+        Layer::FreeTensors(this->dL_dZ, this->dL_dX);
+    }
+}
+
+
+template<int InputTensorRank>
+size_t Flatten<InputTensorRank>::GetTensorBytes() const
+{
+    return Layer::TensorBytes(this->Z, this->dL_dZ, this->dL_dX);
+}
+
+
 template<int InputTensorRank>
 const Tensor<2> &Flatten<InputTensorRank>::GetOutput2D() const
 {
@@ -37,6 +37,22 @@ public:
 
     void Update(Optimizer &optimizer) override;
 
+    std::vector<TensorMap<1>> GetParameters() override;
+
+    std::vector<TensorMap<1>> GetParameterGradients() override;
+
+    Layer *Clone() const override;
+
+    size_t GetTensorBytes() const override;
+
+    void SetInferenceOnly(bool inference_only) override;
+
+    void SetCheckpointing(Eigen::Index segment) override;
+
+    void SetGemmBackend(GemmBackend backend) override;
+
+    void Freeze(bool frozen) override;
+
     const Tensor<2> &GetOutput2D() const override;
 
     const Tensor<3> &GetOutput3D() const override;
@@ -65,6 +81,24 @@ private:
     Tensor<2> dL_dw_zr;
     Tensor<2> dL_dw_c;
 
+    // back propagate through time step i's cell
+    void BackwardCell(const Tensor<ReturnSequences ? 3 : 2> &gradients, int i);
+
+    // pack w_zr and w_c for GemmBackend::PACKED or a frozen layer if they changed
+    void PackWeights();
+
+    // whether Forward multiplies with packed_zr and packed_c
+    bool Packed() const
+    {
+        return this->gemm == GemmBackend::PACKED || this->frozen;
+    }
+
+    GemmBackend gemm = GemmBackend::CONTRACTION;
+    PackedMatrix packed_zr;
+    PackedMatrix packed_c;
+    bool packed_stale = true; // weights changed since they were packed
+    bool frozen = false; // the packed weights are kept for inference
+
     Tensor<3> x;
     Tensor<3> dL_dx;
     Tensor<3> h_candidate;
@@ -74,15 +108,12 @@ private:
 
     Eigen::Index input_len;
     Eigen::Index output_len;
+    Eigen::Index checkpoint_segment = 0; // see Layer::SetCheckpointing
 
 
     // each GRU cell perform their own forward,
     // backward weights, and backward input for their time step
     std::vector<GRUCell<Activation, GateActivation>> gru_cells;
-
-    // multithreading
-    Eigen::ThreadPoolDevice device = Eigen::ThreadPoolDevice(new Eigen::ThreadPool(
-            (int) std::thread::hardware_concurrency()), 2);
 };
 
 } // namespace fl
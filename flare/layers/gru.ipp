@@ -33,8 +33,11 @@ void GRU<Activation, GateActivation, ReturnSequences>::Forward(
                          << Dims<3>(-1, -1, this->input_len) << " got "
                          << inputs.dimensions() << " instead");
 
-    this->x.resize(inputs.dimensions());
-    this->x.device(this->device) = inputs;
+    if (!this->inference_only) {
+        this->x.resize(inputs.dimensions());
+        ParallelCopy(this->device, inputs, this->x);
+    }
+
     this->h.resize(inputs.dimension(0), inputs.dimension(1), this->output_len);
 
     // if needed, allocate more cells to match the input's time steps
@@ -48,9 +51,19 @@ void GRU<Activation, GateActivation, ReturnSequences>::Forward(
         }
     }
 
+    const bool packed = this->Packed();
+    this->PackWeights();
+
     for (int i = 0; i < inputs.dimension(1); i++) {
         this->gru_cells[i].Forward(inputs, this->h, this->w_zr,
-                                   this->w_c, this->device);
+                                   this->w_c, this->device,
+                                   packed ? &this->packed_zr : nullptr,
+                                   packed ? &this->packed_c : nullptr);
+
+        if (this->checkpoint_segment > 0 || this->inference_only) {
+            // Backward recomputes the cell from x and h, or never runs
+            this->gru_cells[i].Release();
+        }
     }
 
     if constexpr (!ReturnSequences) {
@@ -72,45 +85,95 @@ template<typename Activation, typename GateActivation, bool ReturnSequences>
 void GRU<Activation, GateActivation, ReturnSequences>::Backward(
         const Tensor<ReturnSequences ? 3 : 2> &gradients)
 {
-    int time_steps = static_cast<int>(this->x.dimension(1));
+    const int time_steps = static_cast<int>(this->x.dimension(1));
+    const bool checkpointing = this->checkpoint_segment > 0;
+    const int segment = checkpointing ? static_cast<int>(this->checkpoint_segment)
+                                      : time_steps;
 
     this->dL_dw_zr.setZero();
     this->dL_dw_c.setZero();
 
-    if constexpr(ReturnSequences) {
-        this->gru_cells[time_steps - 1].Backward(
-                gradients.slice(Dims<3>(0, time_steps - 1, 0),
-                                Dims<3>(this->x.dimension(0), 1, this->output_len)),
-                this->x, this->w_zr, this->dL_dw_zr,
-                this->w_c, this->dL_dw_c,
-                this->h, this->device);
+    if (checkpointing) {
+        this->dL_dx.resize(this->x.dimensions());
+    }
+
+    // when checkpointing, each segment's cells, last segment first, are
+    // recomputed from x and the stored h, then back propagated and released
+    // before the previous segment is recomputed
+    for (int end = time_steps; end > 0; end -= segment) {
+        const int begin = std::max(end - segment, 0);
+
+        if (checkpointing) {
+            const bool packed = this->Packed();
+
+            for (int i = begin; i < end; i++) {
+                this->gru_cells[i].Forward(this->x, this->h, this->w_zr,
+                                           this->w_c, this->device,
+                                           packed ? &this->packed_zr : nullptr,
+                                           packed ? &this->packed_c : nullptr);
+            }
+        }
+
+        for (int i = end - 1; i >= begin; --i) {
+            this->BackwardCell(gradients, i);
 
-        for (int i = time_steps - 2; i >= 0; --i) {
-            auto grads = gradients.slice(
-                    Dims<3>(0, i, 0),
-                    Dims<3>(this->x.dimension(0), 1, this->output_len)) +
-                         this->gru_cells[i + 1].GetCellInputGradients();
+            if (checkpointing) {
+                // the cell's gate gradients are released with it
+                this->gru_cells[i].CalcLayerInputGradients(this->w_zr, this->w_c,
+                                                           this->dL_dx, this->device);
 
-            this->gru_cells[i].Backward(grads, this->x, this->w_zr, this->dL_dw_zr,
-                                        this->w_c, this->dL_dw_c,
-                                        this->h, this->device);
+                if (i + 1 < time_steps) {
+                    this->gru_cells[i + 1].Release();
+                }
+            }
         }
     }
-    else {
-        this->gru_cells[time_steps - 1].Backward(
-                gradients.reshape(
-                        Dims<3>(this->x.dimension(0), 1, this->output_len)),
-                this->x, this->w_zr, this->dL_dw_zr,
-                this->w_c, this->dL_dw_c,
-                this->h, this->device);
 
-        for (int i = time_steps - 2; i >= 0; --i) {
+    if (checkpointing) {
+        this->gru_cells.front().Release();
+    }
+}
+
+
+template<typename Activation, typename GateActivation, bool ReturnSequences>
+void GRU<Activation, GateActivation, ReturnSequences>::BackwardCell(
+        const Tensor<ReturnSequences ? 3 : 2> &gradients, int i)
+{
+    const Dims<3> step_extent(this->x.dimension(0), 1, this->output_len);
+
+    if (i == this->x.dimension(1) - 1) {
+        if constexpr(ReturnSequences) {
             this->gru_cells[i].Backward(
-                    this->gru_cells[i + 1].GetCellInputGradients(),
+                    gradients.slice(Dims<3>(0, i, 0), step_extent),
                     this->x, this->w_zr, this->dL_dw_zr,
                     this->w_c, this->dL_dw_c,
                     this->h, this->device);
         }
+        else {
+            this->gru_cells[i].Backward(
+                    gradients.reshape(step_extent),
+                    this->x, this->w_zr, this->dL_dw_zr,
+                    this->w_c, this->dL_dw_c,
+                    this->h, this->device);
+        }
+
+        return;
+    }
+
+    if constexpr(ReturnSequences) {
+        auto grads = gradients.slice(Dims<3>(0, i, 0), step_extent) +
+                     this->gru_cells[i + 1].GetCellInputGradients();
+
+        this->gru_cells[i].Backward(grads, this->x, this->w_zr, this->dL_dw_zr,
+                                    this->w_c, this->dL_dw_c,
+                                    this->h, this->device);
+    }
+    else {
+        this->gru_cells[i].Backward(
+                this->gru_cells[i + 1].GetCellInputGradients(),
+                this->x, this->w_zr, this->dL_dw_zr,
+                this->w_c, this->dL_dw_c,
+                this->h, this->device);
     }
 }
 
@@ -128,6 +191,116 @@ void GRU<Activation, GateActivation, ReturnSequences>::Update(
 {
     optimizer.Minimize(this->w_zr, this->dL_dw_zr);
     optimizer.Minimize(this->w_c, this->dL_dw_c);
+
+    this->packed_stale = true;
+    this->PackWeights();
+}
+
+
+template<typename Activation, typename GateActivation, bool ReturnSequences>
+std::vector<TensorMap<1>> GRU<Activation, GateActivation, ReturnSequences>::GetParameters()
+{
+    // the caller may write the weights through the views
+    this->packed_stale = true;
+    return {Layer::FlatView(this->w_zr), Layer::FlatView(this->w_c)};
+}
+
+
+template<typename Activation, typename GateActivation, bool ReturnSequences>
+std::vector<TensorMap<1>> GRU<Activation, GateActivation, ReturnSequences>::GetParameterGradients()
+{
+    return {Layer::FlatView(this->dL_dw_zr), Layer::FlatView(this->dL_dw_c)};
+}
+
+
+template<typename Activation, typename GateActivation, bool ReturnSequences>
+Layer *GRU<Activation, GateActivation, ReturnSequences>::Clone() const
+{
+    return new GRU<Activation, GateActivation, ReturnSequences>(*this);
+}
+
+
+template<typename Activation, typename GateActivation, bool ReturnSequences>
+void GRU<Activation, GateActivation, ReturnSequences>::SetInferenceOnly(bool inference_only)
+{
+    Layer::SetInferenceOnly(inference_only);
+
+    if (inference_only) {
+        Layer::FreeTensors(this->x, this->dL_dx, this->dL_dw_zr, this->dL_dw_c);
+
+        for (auto &cell: this->gru_cells) {
+            cell.Release();
+        }
+
+        return;
+    }
+
+    this->dL_dw_zr.resize(this->w_zr.dimensions());
+    this->dL_dw_c.resize(this->w_c.dimensions());
+}
+
+
+template<typename Activation, typename GateActivation, bool ReturnSequences>
+size_t GRU<Activation, GateActivation, ReturnSequences>::GetTensorBytes() const
+{
+    size_t bytes = Layer::TensorBytes(this->w_zr, this->w_c, this->dL_dw_zr,
+                                      this->dL_dw_c, this->x, this->dL_dx,
+                                      this->h_candidate, this->h, this->h_no_seq);
+
+    for (const auto &cell: this->gru_cells) {
+        bytes += cell.GetTensorBytes();
+    }
+
+    return bytes + this->packed_zr.Bytes() + this->packed_c.Bytes();
+}
+
+
+template<typename Activation, typename GateActivation, bool ReturnSequences>
+void GRU<Activation, GateActivation, ReturnSequences>::SetCheckpointing(
+        Eigen::Index segment)
+{
+    this->checkpoint_segment = std::max<Eigen::Index>(segment, 0);
+}
+
+
+template<typename Activation, typename GateActivation, bool ReturnSequences>
+void GRU<Activation, GateActivation, ReturnSequences>::SetGemmBackend(
+        GemmBackend backend)
+{
+    this->gemm = Gemm::available ? backend : GemmBackend::CONTRACTION;
+    this->packed_stale = true;
+
+    if (!this->Packed()) {
+        this->packed_zr = PackedMatrix();
+        this->packed_c = PackedMatrix();
+    }
+}
+
+
+template<typename Activation, typename GateActivation, bool ReturnSequences>
+void GRU<Activation, GateActivation, ReturnSequences>::Freeze(bool frozen)
+{
+    this->frozen = frozen && Gemm::available;
+
+    if (this->frozen) {
+        this->PackWeights();
+    }
+    else if (!this->Packed()) {
+        this->packed_zr = PackedMatrix();
+        this->packed_c = PackedMatrix();
+        this->packed_stale = true;
+    }
+}
+
+
+template<typename Activation, typename GateActivation, bool ReturnSequences>
+void GRU<Activation, GateActivation, ReturnSequences>::PackWeights()
+{
+    if (this->Packed() && this->packed_stale) {
+        this->packed_zr.Pack(this->w_zr);
+        this->packed_c.Pack(this->w_c);
+        this->packed_stale = false;
+    }
 }
 
 
@@ -163,6 +336,11 @@ template<typename Activation, typename GateActivation, bool ReturnSequences>
 const Tensor<3> &
 GRU<Activation, GateActivation, ReturnSequences>::GetInputGradients3D()
 {
+    if (this->checkpoint_segment > 0) {
+        // computed by Backward, the cells are released
+        return this->dL_dx;
+    }
+
     this->dL_dx.resize(this->x.dimensions());
     int time_steps = static_cast<int>(this->x.dimension(1));
 
@@ -211,6 +389,7 @@ void GRU<Activation, GateActivation, ReturnSequences>::SetWeights(
 
     this->w_zr = weights.front().slice(w_zr_offset, w_zr_extent);
     this->w_c = weights.front().slice(w_c_offset, w_c_extent);
+    this->packed_stale = true;
 }
 
 
@@ -14,6 +14,8 @@
 #include "flatten.hpp"
 #include "dropout.hpp"
 #include "conv2dtranspose.hpp"
+#include "depthwiseconv2d.hpp"
+#include "separableconv2d.hpp"
 #include "batch_normalization.hpp"
 #include "reshape.hpp"
 #include "activation.hpp"
@@ -10,11 +10,65 @@
 #include "flare/weights/weights.hpp"
 #include "flare/weights/glorot.hpp"
 #include "flare/optimizers/optimizer.hpp"
+#include "flare/execution_context.hpp"
+#include "flare/parallel.hpp"
+#include "flare/gemm.hpp"
 #include <fstream>
+#include <iterator>
 
 namespace fl
 {
 
+/**
+ * The input a layer keeps from Forward for Backward, either its own copy or,
+ * when the layer borrows its input, a pointer to the caller's tensor
+ */
+template<int TensorRank>
+class LayerInput
+{
+public:
+    void Set(const Tensor<TensorRank> &input, bool borrow, const Device &device)
+    {
+        if (borrow) {
+            this->borrowed = &input;
+
+            if (this->copy.size() != 0) {
+                this->copy = Tensor<TensorRank>();
+            }
+
+            return;
+        }
+
+        this->borrowed = nullptr;
+        this->copy.resize(input.dimensions());
+        ParallelCopy(device, input, this->copy);
+    }
+
+
+    const Tensor<TensorRank> &operator*() const
+    {
+        return this->borrowed ? *this->borrowed : this->copy;
+    }
+
+
+    const Tensor<TensorRank> *operator->() const
+    {
+        return &**this;
+    }
+
+
+    // elements held by the layer, 0 when borrowed, for Layer::TensorBytes
+    Eigen::Index size() const
+    {
+        return this->copy.size();
+    }
+
+private:
+    const Tensor<TensorRank> *borrowed = nullptr;
+    Tensor<TensorRank> copy;
+};
+
+
 class Layer
 {
 public:
@@ -290,9 +344,207 @@ public:
     {}
 
 
+    /**
+     * Flat views over the layer's learnable parameters, in the same order as
+     * GetParameterGradients(). Lets code treat every layer alike, e.g. to copy
+     * weights between model replicas or to average gradients across them.
+     * Views become invalid if the layer resizes its tensors
+     *
+     * @return   one view per parameter tensor, empty if the layer has none
+     */
+    virtual std::vector<TensorMap<1>> GetParameters()
+    {
+        return {};
+    }
+
+
+    /**
+     * @return   flat views over the loss gradients w.r.t. each parameter
+     *           tensor, valid after Backward
+     */
+    virtual std::vector<TensorMap<1>> GetParameterGradients()
+    {
+        return {};
+    }
+
+
+    /**
+     * @return   a new copy of the layer, including its weights, owned by the caller
+     */
+    virtual Layer *Clone() const
+    {
+        throw std::logic_error(
+                "An error occurred, base class Layer Clone was called on " +
+                this->name);
+    }
+
+
+    /**
+     * @return   bytes currently held by the layer's tensors: inputs and outputs
+     *           kept for Backward, gradients and parameters. 0 for layers that
+     *           don't report them
+     */
+    virtual size_t GetTensorBytes() const
+    {
+        return 0;
+    }
+
+
+    /**
+     * Evaluate the layer's tensor operations on the context's thread pool
+     *
+     * @param context   execution context shared by the model
+     */
+    virtual void SetExecutionContext(ExecutionContext &context)
+    {
+        this->device = context.GetDevice();
+    }
+
+
+    /**
+     * Choose how the layer multiplies inputs with weights, layers without a
+     * matrix multiplication ignore it
+     *
+     * @param backend   GemmBackend::PACKED to pack the weights once per update
+     */
+    virtual void SetGemmBackend(GemmBackend backend)
+    {}
+
+
+    /**
+     * Pack the weights for inference once, Forward multiplies with the packed
+     * weights whatever the layer's GemmBackend until the layer is unfrozen.
+     * Layers without weights to pack ignore it
+     *
+     * @param frozen   true to pack the weights, false to drop the packed copy
+     *                 unless the layer's GemmBackend still uses it
+     */
+    virtual void Freeze(bool frozen)
+    {}
+
+
+    /**
+     * Fold a per channel affine map and a leaky ReLU applied to the layer's
+     * output into its weights and Forward, output = leaky(z * scale + shift),
+     * so the layers that computed them can be skipped during inference. A
+     * fold replaces the previous one, Backward ignores it. Layers that can't
+     * fold them, e.g. ones with their own nonlinear activation, ignore it
+     *
+     * @param scale   scale of each output channel, empty for none
+     * @param shift   shift of each output channel, empty for none
+     * @param leak    slope of the negative outputs, 1 for no activation
+     * @return        true if the layer folded them
+     */
+    virtual bool Fold(const Tensor<1> &scale, const Tensor<1> &shift, Scalar leak)
+    {
+        return false;
+    }
+
+
+    // restore the weights of before Fold
+    virtual void Unfold()
+    {}
+
+
+    /**
+     * Inference of a normalization layer as a per channel affine map of its
+     * input, output = input * scale + shift
+     *
+     * @return   false for layers that aren't one
+     */
+    virtual bool GetChannelAffine(Tensor<1> &scale, Tensor<1> &shift) const
+    {
+        return false;
+    }
+
+
+    /**
+     * Slope of the negative outputs of an elementwise leaky ReLU layer, 0 for
+     * ReLU and 1 for linear activations
+     *
+     * @return   false for layers that aren't one
+     */
+    virtual bool GetLeak(Scalar &leak) const
+    {
+        return false;
+    }
+
+
+    /**
+     * Let Forward keep a pointer to its input instead of copying it, the input
+     * must stay unchanged until Backward and the input gradients are computed.
+     * Sequential borrows the previous layer's output for every layer after the
+     * first, whose input belongs to the caller
+     *
+     * @param borrow   true to reference the input, false to copy it
+     */
+    void BorrowInput(bool borrow)
+    {
+        this->borrow_input = borrow;
+    }
+
+
+    /**
+     * Serve Forward only: free the tensors only Backward and Update read, the
+     * kept input, gradients and cached intermediates, and have Forward stop
+     * filling them. Layers with a separate pre-activation output activate in
+     * place. Backward must not be called until the layer is trainable again,
+     * which sizes the weight gradients again
+     *
+     * @param inference_only   true to drop the training buffers
+     */
+    virtual void SetInferenceOnly(bool inference_only)
+    {
+        this->inference_only = inference_only;
+    }
+
+
+    /**
+     * Trade compute for memory: instead of keeping the intermediates Backward
+     * needs from Forward, e.g. per time step cell state or attention maps,
+     * drop them and recompute them during Backward, segment time steps at a
+     * time. Layers with nothing worth recomputing ignore it
+     *
+     * Only the recurrent layers honour the segment length. MultiHeadAttention
+     * recomputes the whole sequence at once, any segment > 0 switches it on
+     *
+     * @param segment   time steps recomputed at once, smaller holds fewer
+     *                  intermediates at a time, 0 keeps them from Forward
+     */
+    virtual void SetCheckpointing(Eigen::Index segment)
+    {}
+
+
     std::string name = "layer"; // name of layer, to be set by inherited classes
     int input_rank = -1;
     int output_rank = -1;
+
+protected:
+    template<int TensorRank>
+    static TensorMap<1> FlatView(Tensor<TensorRank> &tensor)
+    {
+        return TensorMap<1>(tensor.data(), tensor.size());
+    }
+
+
+    template<typename... Tensors>
+    static size_t TensorBytes(const Tensors &... tensors)
+    {
+        return (static_cast<size_t>(tensors.size()) + ... + 0) * sizeof(Scalar);
+    }
+
+
+    // replace each tensor or LayerInput with an empty one, freeing its memory
+    template<typename... Tensors>
+    static void FreeTensors(Tensors &... tensors)
+    {
+        ((tensors = Tensors()), ...);
+    }
+
+
+    Device device = ExecutionContext::Default().GetDevice();
+    bool borrow_input = false; // Forward references its input, see BorrowInput
+    bool inference_only = false; // no training buffers, see SetInferenceOnly
 };
 
 }
@@ -18,6 +18,10 @@ public:
 
     void Forward(const Tensor<TensorRank> &inputs) override;
 
+    Layer *Clone() const override;
+
+    bool GetLeak(Scalar &leak) const override;
+
     const Tensor<2> &GetInputGradients2D() override;
 
     const Tensor<3> &GetInputGradients3D() override;
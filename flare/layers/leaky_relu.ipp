@@ -18,13 +18,30 @@ LeakyReLU<TensorRank>::LeakyReLU(Scalar leak):
 template<int TensorRank>
 void LeakyReLU<TensorRank>::Forward(const Tensor<TensorRank> &inputs)
 {
-    this->X.resize(inputs.dimensions());
-    this->X.device(this->device) = inputs;
+    if (!this->inference_only) {
+        this->X.Set(inputs, this->borrow_input, this->device);
+    }
+
     auto zero = static_cast<Scalar>(0.0);
     this->Z = (inputs >= zero).select(inputs, inputs * this->leak);
 }
 
 
+template<int TensorRank>
+Layer *LeakyReLU<TensorRank>::Clone() const
+{
+    return new LeakyReLU<TensorRank>(*this);
+}
+
+
+template<int TensorRank>
+bool LeakyReLU<TensorRank>::GetLeak(Scalar &leak) const
+{
+    leak = this->leak;
+    return true;
+}
+
+
 template<int TensorRank>
 const Tensor<2> &LeakyReLU<TensorRank>::GetInputGradients2D()
 {
@@ -35,10 +52,10 @@ const Tensor<2> &LeakyReLU<TensorRank>::GetInputGradients2D()
     }
 
     auto one = static_cast<Scalar>(1.0);
-    this->dL_dX.resize(this->X.dimensions());
+    this->dL_dX.resize(this->X->dimensions());
     this->dL_dX.template device(this->device) =
-            this->dL_dZ * (this->X >= this->leak)
-                    .select(this->X.constant(one), this->X.constant(this->leak));
+            this->dL_dZ * (*this->X >= this->leak)
+                    .select(this->X->constant(one), this->X->constant(this->leak));
     return this->dL_dX;
 }
 
@@ -53,10 +70,10 @@ const Tensor<3> &LeakyReLU<TensorRank>::GetInputGradients3D()
     }
 
     auto one = static_cast<Scalar>(1.0);
-    this->dL_dX.resize(this->X.dimensions());
+    this->dL_dX.resize(this->X->dimensions());
     this->dL_dX.template device(this->device) =
-            this->dL_dZ * (this->X >= this->leak)
-                    .select(this->X.constant(one), this->X.constant(this->leak));
+            this->dL_dZ * (*this->X >= this->leak)
+                    .select(this->X->constant(one), this->X->constant(this->leak));
     return this->dL_dX;
 }
 
@@ -70,10 +87,10 @@ const Tensor<4> &LeakyReLU<TensorRank>::GetInputGradients4D()
                 std::to_string(TensorRank) + " TENSOR");
     }
     auto one = static_cast<Scalar>(1.0);
-    this->dL_dX.resize(this->X.dimensions());
+    this->dL_dX.resize(this->X->dimensions());
     this->dL_dX.template device(this->device) =
-            this->dL_dZ * (this->X >= this->leak)
-                    .select(this->X.constant(one), this->X.constant(this->leak));
+            this->dL_dZ * (*this->X >= this->leak)
+                    .select(this->X->constant(one), this->X->constant(this->leak));
     return this->dL_dX;
 }
 
@@ -30,6 +30,22 @@ public:
 
     void Update(Optimizer &optimizer) override;
 
+    std::vector<TensorMap<1>> GetParameters() override;
+
+    std::vector<TensorMap<1>> GetParameterGradients() override;
+
+    Layer *Clone() const override;
+
+    size_t GetTensorBytes() const override;
+
+    void SetInferenceOnly(bool inference_only) override;
+
+    void SetCheckpointing(Eigen::Index segment) override;
+
+    void SetGemmBackend(GemmBackend backend) override;
+
+    void Freeze(bool frozen) override;
+
     const Tensor<2> &GetOutput2D() const override;
 
     const Tensor<3> &GetOutput3D() const override;
@@ -54,7 +70,7 @@ private:
     Eigen::Index input_len;
     Eigen::Index output_len;
 
-    //Tensor<3> x; // held in LSTMCells instead
+    LayerInput<3> X; // only kept when checkpointing, otherwise held in the cells
     Tensor<3> dL_dx;
 
     Tensor<3> h;
@@ -65,11 +81,27 @@ private:
     Tensor<2> w;
     Tensor<2> dL_dw;
 
-    std::vector<LSTMCell<Activation, GateActivation>> lstm_cells;
+    // back propagate through time step i's cell
+    void BackwardCell(const Tensor<ReturnSequences ? 3 : 2> &gradients, Eigen::Index i);
+
+
+    // pack w for GemmBackend::PACKED or a frozen layer if it changed
+    void PackWeights();
+
 
-    // multithreading
-    Eigen::ThreadPoolDevice device = Eigen::ThreadPoolDevice(new Eigen::ThreadPool(
-            (int) std::thread::hardware_concurrency()), 2);
+    // whether Forward multiplies with packed_w
+    bool Packed() const
+    {
+        return this->gemm == GemmBackend::PACKED || this->frozen;
+    }
+
+    GemmBackend gemm = GemmBackend::CONTRACTION;
+    PackedMatrix packed_w;
+    bool packed_stale = true; // w changed since packed_w was packed
+    bool frozen = false; // packed_w is kept for inference
+
+    std::vector<LSTMCell<Activation, GateActivation>> lstm_cells;
+    Eigen::Index checkpoint_segment = 0; // see Layer::SetCheckpointing
 };
 
 } // namespace fl
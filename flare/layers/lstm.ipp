@@ -60,8 +60,21 @@ void LSTM<Activation, GateActivation, ReturnSequences>::Forward(
         }
     }
 
-    for (auto &cell: this->lstm_cells) {
-        cell.Forward(inputs, this->w, this->h, this->cs, this->device);
+    if (this->checkpoint_segment > 0 && !this->inference_only) {
+        // Backward recomputes the cells from the input
+        this->X.Set(inputs, this->borrow_input, this->device);
+    }
+
+    this->PackWeights();
+
+    for (Eigen::Index i = 0; i < inputs.dimension(1); i++) {
+        this->lstm_cells[i].Forward(inputs, this->w, this->h, this->cs, this->device,
+                                    this->Packed() ? &this->packed_w : nullptr);
+
+        // Backward recomputes the cell, or never runs
+        if (this->checkpoint_segment > 0 || this->inference_only) {
+            this->lstm_cells[i].Release();
+        }
     }
 
     if constexpr (!ReturnSequences) {
@@ -82,44 +95,83 @@ template<typename Activation, typename GateActivation, bool ReturnSequences>
 void LSTM<Activation, GateActivation, ReturnSequences>::Backward(
         const Tensor<ReturnSequences ? 3 : 2> &gradients)
 {
-    if constexpr(ReturnSequences) {
-        this->dL_dw.setZero();
-        Eigen::Index time_steps = this->h.dimension(1);
-
-        this->lstm_cells.back().Backward(
-                gradients.chip(time_steps - 1, 1),
-                w, dL_dw,
-                cs, fl::Tensor<2>(gradients.dimension(0), output_len).constant(0),
-                device
-        );
-
-        for (auto i = time_steps - 2; i >= 0; i--) {
-            lstm_cells[i].Backward(
-                    gradients.chip(i, 1) +
-                    this->lstm_cells[i + 1].GetInputGradientsHprev(),
-                    w, dL_dw,
-                    cs, lstm_cells[i + 1].GetInputGradientsCprev(),
-                    device
-            );
+    const Eigen::Index time_steps = this->h.dimension(1);
+    const bool checkpointing = this->checkpoint_segment > 0;
+    const Eigen::Index segment = checkpointing ? this->checkpoint_segment : time_steps;
+
+    this->dL_dw.setZero();
+
+    if (checkpointing) {
+        this->dL_dx.resize(this->h.dimension(0), time_steps, this->input_len);
+    }
+
+    // when checkpointing, each segment's cells, last segment first, are
+    // recomputed from the input and the stored h and cs, then back propagated
+    // and released before the previous segment is recomputed
+    for (Eigen::Index end = time_steps; end > 0; end -= segment) {
+        const Eigen::Index begin = std::max<Eigen::Index>(end - segment, 0);
+
+        if (checkpointing) {
+            for (Eigen::Index i = begin; i < end; i++) {
+                this->lstm_cells[i].Forward(*this->X, this->w, this->h, this->cs,
+                                            this->device, this->Packed() ?
+                                                          &this->packed_w : nullptr);
+            }
+        }
+
+        for (Eigen::Index i = end - 1; i >= begin; i--) {
+            this->BackwardCell(gradients, i);
+
+            if (checkpointing) {
+                // the cell's gate gradients are released with it
+                this->lstm_cells[i].CalcInputGradients(this->dL_dx, this->w,
+                                                       this->device);
+
+                if (i + 1 < time_steps) {
+                    this->lstm_cells[i + 1].Release();
+                }
+            }
         }
     }
-    else {
-        Eigen::Index time_steps = this->h.dimension(1);
-
-        this->dL_dw.setZero();
-        this->lstm_cells.back().Backward(
-                gradients, w, dL_dw,
-                cs, fl::Tensor<2>(gradients.dimension(0), output_len).constant(0),
-                device
-        );
-
-        for (auto i = time_steps - 2; i >= 0; i--) {
-            lstm_cells[i].Backward(
-                    lstm_cells[i + 1].GetInputGradientsHprev(), w, dL_dw,
-                    cs, lstm_cells[i + 1].GetInputGradientsCprev(),
-                    device
-            );
+
+    if (checkpointing) {
+        this->lstm_cells.front().Release();
+    }
+}
+
+
+template<typename Activation, typename GateActivation, bool ReturnSequences>
+void LSTM<Activation, GateActivation, ReturnSequences>::BackwardCell(
+        const Tensor<ReturnSequences ? 3 : 2> &gradients, Eigen::Index i)
+{
+    if (i == this->h.dimension(1) - 1) {
+        const Tensor<2> dcs_next =
+                Tensor<2>(gradients.dimension(0), this->output_len).setZero();
+
+        if constexpr (ReturnSequences) {
+            this->lstm_cells[i].Backward(gradients.chip(i, 1), this->w, this->dL_dw,
+                                         this->cs, dcs_next, this->device);
+        }
+        else {
+            this->lstm_cells[i].Backward(gradients, this->w, this->dL_dw,
+                                         this->cs, dcs_next, this->device);
         }
+
+        return;
+    }
+
+    const auto &next_cell = this->lstm_cells[i + 1];
+
+    if constexpr (ReturnSequences) {
+        this->lstm_cells[i].Backward(
+                gradients.chip(i, 1) + next_cell.GetInputGradientsHprev(),
+                this->w, this->dL_dw,
+                this->cs, next_cell.GetInputGradientsCprev(), this->device);
+    }
+    else {
+        this->lstm_cells[i].Backward(
+                next_cell.GetInputGradientsHprev(), this->w, this->dL_dw,
+                this->cs, next_cell.GetInputGradientsCprev(), this->device);
     }
 }
 
@@ -141,6 +193,116 @@ template<typename Activation, typename GateActivation, bool ReturnSequences>
 void LSTM<Activation, GateActivation, ReturnSequences>::Update(Optimizer &optimizer)
 {
     optimizer.Minimize(this->w, this->dL_dw);
+
+    this->packed_stale = true;
+    this->PackWeights();
+}
+
+
+template<typename Activation, typename GateActivation, bool ReturnSequences>
+std::vector<TensorMap<1>> LSTM<Activation, GateActivation, ReturnSequences>::GetParameters()
+{
+    // the caller may write the weights through the views
+    this->packed_stale = true;
+    return {Layer::FlatView(this->w)};
+}
+
+
+template<typename Activation, typename GateActivation, bool ReturnSequences>
+std::vector<TensorMap<1>> LSTM<Activation, GateActivation, ReturnSequences>::GetParameterGradients()
+{
+    return {Layer::FlatView(this->dL_dw)};
+}
+
+
+template<typename Activation, typename GateActivation, bool ReturnSequences>
+Layer *LSTM<Activation, GateActivation, ReturnSequences>::Clone() const
+{
+    return new LSTM<Activation, GateActivation, ReturnSequences>(*this);
+}
+
+
+template<typename Activation, typename GateActivation, bool ReturnSequences>
+void LSTM<Activation, GateActivation, ReturnSequences>::SetInferenceOnly(bool inference_only)
+{
+    Layer::SetInferenceOnly(inference_only);
+
+    if (inference_only) {
+        Layer::FreeTensors(this->X, this->dL_dx, this->dL_dw);
+
+        for (auto &cell: this->lstm_cells) {
+            cell.Release();
+        }
+
+        return;
+    }
+
+    this->dL_dw.resize(this->w.dimensions());
+    this->dL_dw.setZero();
+}
+
+
+template<typename Activation, typename GateActivation, bool ReturnSequences>
+size_t LSTM<Activation, GateActivation, ReturnSequences>::GetTensorBytes() const
+{
+    size_t bytes = Layer::TensorBytes(this->X, this->dL_dx, this->h, this->cs,
+                                      this->h_no_seq, this->w, this->dL_dw);
+
+    for (const auto &cell: this->lstm_cells) {
+        bytes += cell.GetTensorBytes();
+    }
+
+    return bytes + this->packed_w.Bytes();
+}
+
+
+template<typename Activation, typename GateActivation, bool ReturnSequences>
+void LSTM<Activation, GateActivation, ReturnSequences>::SetCheckpointing(
+        Eigen::Index segment)
+{
+    this->checkpoint_segment = std::max<Eigen::Index>(segment, 0);
+
+    if (this->checkpoint_segment == 0) {
+        Layer::FreeTensors(this->X);
+    }
+}
+
+
+template<typename Activation, typename GateActivation, bool ReturnSequences>
+void LSTM<Activation, GateActivation, ReturnSequences>::SetGemmBackend(
+        GemmBackend backend)
+{
+    this->gemm = Gemm::available ? backend : GemmBackend::CONTRACTION;
+    this->packed_stale = true;
+
+    if (!this->Packed()) {
+        this->packed_w = PackedMatrix();
+    }
+}
+
+
+template<typename Activation, typename GateActivation, bool ReturnSequences>
+void LSTM<Activation, GateActivation, ReturnSequences>::Freeze(bool frozen)
+{
+    this->frozen = frozen && Gemm::available;
+
+    if (this->frozen) {
+        this->PackWeights();
+    }
+    else if (!this->Packed()) {
+        this->packed_w = PackedMatrix();
+        this->packed_stale = true;
+    }
+}
+
+
+template<typename Activation, typename GateActivation, bool ReturnSequences>
+void LSTM<Activation, GateActivation, ReturnSequences>::PackWeights()
+{
+    if (this->Packed() && this->packed_stale) {
+        this->packed_w.Pack(this->w);
+        this->packed_stale = false;
+    }
 }
 
 
@@ -184,6 +346,11 @@ template<typename Activation, typename GateActivation, bool ReturnSequences>
 const Tensor<3> &
 LSTM<Activation, GateActivation, ReturnSequences>::GetInputGradients3D()
 {
+    if (this->checkpoint_segment > 0) {
+        // computed by Backward, the cells are released
+        return this->dL_dx;
+    }
+
     this->dL_dx.resize(this->h.dimension(0), this->h.dimension(1), this->input_len);
     int time_steps = static_cast<int>(this->h.dimension(1));
 
@@ -224,6 +391,7 @@ void LSTM<Activation, GateActivation, ReturnSequences>::SetWeights(
     }
     else {
         this->w = weights.front();
+        this->packed_stale = true;
     }
 }
 
@@ -283,7 +451,7 @@ void LSTM<Activation, GateActivation, ReturnSequences>::Load(
               std::istream_iterator<Scalar>(), std::back_inserter(as_vector));
     read_weights.close();
 
-    if (as_vector.size() != this->w.size()) {
+    if (static_cast<Eigen::Index>(as_vector.size()) != this->w.size()) {
         std::ostringstream error_msg;
         error_msg << this->name << "::Load " << path << " EXPECTED "
                   << this->w.dimensions() << "=" << this->w.size() << " VALUES, GOT "
@@ -293,6 +461,7 @@ void LSTM<Activation, GateActivation, ReturnSequences>::Load(
 
     // reshape the flattened tensor back to expected weights dimensions
     this->w = TensorMap<2>(as_vector.data(), this->w.dimensions());
+    this->packed_stale = true;
 }
 
 
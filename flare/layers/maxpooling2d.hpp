@@ -6,6 +6,8 @@
 #define FLARE_MAXPOOLING2D_HPP
 
 #include "layer.hpp"
+#include "flare/parallel.hpp"
+#include <cstdint>
 
 namespace fl
 {
@@ -30,7 +32,8 @@ public:
     /**
      * Max pooling forward operation, creates a new tensor by sliding, according to
      * the provided strides the, pool window across the input tensor, padded if necessary,
-     * and extracting the maximum value
+     * and extracting the maximum value. Unless the layer is inference only, the
+     * index of the input each maximum was read from is kept for Backward
      *
      * @param inputs     input tensor in format NHWC
      * @param pool       PoolSize dimensions (h, w)
@@ -88,6 +91,15 @@ public:
     void Update(Optimizer &) override;
 
 
+    Layer *Clone() const override;
+
+
+    size_t GetTensorBytes() const override;
+
+
+    void SetInferenceOnly(bool inference_only) override;
+
+
     /**
      * @return   layer's activation values
      */
@@ -116,18 +128,10 @@ public:
      * are routed to the indices of the input tensor's max values as found during the
      * forward pass
      *
-     * @param inputs       input tensor in format NHWC
      * @param gradients    layer gradients passed from the next layer
-     * @param pool         PoolSize dimensions (h, w)
-     * @param stride       Stride dimensions (h, w)
-     * @param dilation     Dilation dimensions (h, w)
-     * @param padding      padding used in forward pass, PADDING_VALID or PADDING_SAME
      * @return             tensor in format NHWC with same dimensions as inputs
      */
-    void MaxPooling2DBackwardInput(
-            const Tensor<4> &inputs, const Tensor<4> &gradients,
-            const PoolSize &pool,
-            const Stride &stride, const Dilation &dilation, Padding padding);
+    void MaxPooling2DBackwardInput(const Tensor<4> &gradients);
 
 
     static Dims<4> ForwardOutputDims(
@@ -135,7 +139,8 @@ public:
             const Stride &stride, const Dilation &dilation, Padding padding);
 
 private:
-    Tensor<4> X;
+    Dims<4> input_dims; // dimensions of Forward's input
+    std::vector<int32_t> argmax; // index into its image of each output's maximum
     Tensor<4> Z;
     Tensor<4> dL_dX;
     Tensor<4> dL_dZ;
@@ -145,10 +150,6 @@ private:
     Dilation dilation = Dilation(1, 1);
     Padding padding;
 
-    // multithreading
-    Eigen::ThreadPool thread_pool;
-    Eigen::ThreadPoolDevice device;
-
 };
 
 } // namespace fl
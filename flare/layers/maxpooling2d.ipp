@@ -11,9 +11,7 @@ MaxPooling2D::MaxPooling2D(const PoolSize &pool, const Stride &stride,
                            Padding padding) :
         pool(pool),
         stride(stride),
-        padding(padding),
-        thread_pool((int) std::thread::hardware_concurrency()),
-        device(&this->thread_pool, 2)
+        padding(padding)
 {
     this->name = "maxpooling2d";
 }
@@ -60,28 +58,89 @@ void MaxPooling2D::MaxPooling2DForward(
                        stride[1];
     }
 
-    // 1. extract image patches to get [N,P,H,W,C], each patch is the same size as pool
-    // 2. find the max value along the height and width dimensions to get [N,P,C]
-    // 3. patch dimension P contains the max values, reshape back to [N,H,W,C]
-    this->Z.device(this->device) = inputs
-            .extract_image_patches(
-                    pool[0], pool[1],
-                    stride[0], stride[1],
-                    dilation[0], dilation[1],
-                    1, 1,
-                    pad_h / 2, pad_h - pad_h / 2,
-                    pad_w / 2, pad_w - pad_w / 2,
-                    std::numeric_limits<Scalar>::lowest())
-            .maximum(Dims<2>(2, 3))
-            .reshape(Dims<4>(batches, output_h, output_w, channels));
+    const Eigen::Index pad_top = pad_h / 2;
+    const Eigen::Index pad_left = pad_w / 2;
+    const bool record = !this->inference_only;
+
+    if (record && input_h * input_w * channels > std::numeric_limits<int32_t>::max()) {
+        throw std::invalid_argument(
+                "MaxPooling2D::Forward IMAGE TOO LARGE TO INDEX WITH INT32");
+    }
+
+    if (record) {
+        this->argmax.resize(batches * output_h * output_w * channels);
+    }
+
+    const Scalar *input = inputs.data();
+    Scalar *output = this->Z.data();
+    int32_t *index = this->argmax.data();
+
+    // one output row of a batch per task, the first window position inside
+    // the input initializes each channel's maximum, padding is never the max.
+    // Ties keep the first position, left to right and row by row
+    ParallelFor(this->device, batches * output_h,
+                2.0 * output_w * pool[0] * pool[1] * channels, [&](Eigen::Index row) {
+        const Eigen::Index n = row / output_h;
+        const Eigen::Index oh = row % output_h;
+
+        for (Eigen::Index ow = 0; ow < output_w; ow++) {
+            const Eigen::Index pixel = (row * output_w + ow) * channels;
+            Scalar *maximum = output + pixel;
+            int32_t *maximum_index = index + pixel;
+            bool first = true;
+
+            for (Eigen::Index ph = 0; ph < pool[0]; ph++) {
+                const Eigen::Index ih = oh * stride[0] - pad_top + ph * dilation[0];
+
+                if (ih < 0 || ih >= input_h) {
+                    continue;
+                }
+
+                for (Eigen::Index pw = 0; pw < pool[1]; pw++) {
+                    const Eigen::Index iw = ow * stride[1] - pad_left + pw * dilation[1];
+
+                    if (iw < 0 || iw >= input_w) {
+                        continue;
+                    }
+
+                    // relative to the image, Backward adds the image's offset
+                    const Eigen::Index offset = (ih * input_w + iw) * channels;
+                    const Scalar *value = input + n * input_h * input_w * channels + offset;
+
+                    if (first) {
+                        std::copy(value, value + channels, maximum);
+
+                        if (record) {
+                            for (Eigen::Index c = 0; c < channels; c++) {
+                                maximum_index[c] = static_cast<int32_t>(offset + c);
+                            }
+                        }
+
+                        first = false;
+                    }
+                    else if (record) {
+                        for (Eigen::Index c = 0; c < channels; c++) {
+                            if (value[c] > maximum[c]) {
+                                maximum[c] = value[c];
+                                maximum_index[c] = static_cast<int32_t>(offset + c);
+                            }
+                        }
+                    }
+                    else {
+                        for (Eigen::Index c = 0; c < channels; c++) {
+                            maximum[c] = std::max(maximum[c], value[c]);
+                        }
+                    }
+                }
+            }
+        }
+    });
 }
 
 
 void MaxPooling2D::Forward(const Tensor<4> &inputs)
 {
-    this->X.resize(inputs.dimensions());
-    this->X.device(this->device) = inputs;
-
+    this->input_dims = inputs.dimensions();
     this->Z.resize(MaxPooling2D::ForwardOutputDims(
             inputs.dimensions(), this->pool,
             this->stride, this->dilation, this->padding));
@@ -105,7 +164,7 @@ void MaxPooling2D::Backward(const Tensor<4> &gradients)
                          << gradients.dimensions());
 
     this->dL_dZ.resize(gradients.dimensions());
-    this->dL_dZ.device(this->device) = gradients;
+    ParallelCopy(this->device, gradients, this->dL_dZ);
 }
 
 
@@ -121,6 +180,29 @@ void MaxPooling2D::Update(Optimizer &)
 }
 
 
+Layer *MaxPooling2D::Clone() const
+{
+    return new MaxPooling2D(*this);
+}
+
+
+void MaxPooling2D::SetInferenceOnly(bool inference_only)
+{
+    Layer::SetInferenceOnly(inference_only);
+
+    if (inference_only) {
+        Layer::FreeTensors(this->argmax, this->dL_dX, this->dL_dZ);
+    }
+}
+
+
+size_t MaxPooling2D::GetTensorBytes() const
+{
+    return Layer::TensorBytes(this->Z, this->dL_dX, this->dL_dZ) +
+           this->argmax.size() * sizeof(int32_t);
+}
+
+
 const Tensor<4> &MaxPooling2D::GetOutput4D() const
 {
     return this->Z;
@@ -129,11 +211,8 @@ const Tensor<4> &MaxPooling2D::GetOutput4D() const
 
 const Tensor<4> &MaxPooling2D::GetInputGradients4D()
 {
-    this->dL_dX.resize(this->X.dimensions());
-
-    MaxPooling2D::MaxPooling2DBackwardInput(
-            this->X, this->dL_dZ, this->pool,
-            this->stride, this->dilation, this->padding);
+    this->dL_dX.resize(this->input_dims);
+    this->MaxPooling2DBackwardInput(this->dL_dZ);
     return this->dL_dX;
 }
 
@@ -150,93 +229,28 @@ int MaxPooling2D::GetOutputRank() const
 }
 
 
-void MaxPooling2D::MaxPooling2DBackwardInput(
-        const Tensor<4> &inputs, const Tensor<4> &gradients, const PoolSize &pool_,
-        const Stride &stride_, const Dilation &dilation_, Padding padding_)
+void MaxPooling2D::MaxPooling2DBackwardInput(const Tensor<4> &gradients)
 {
-    Eigen::Index batches = inputs.dimension(0);
-    Eigen::Index input_h = inputs.dimension(1);
-    Eigen::Index input_w = inputs.dimension(2);
-    Eigen::Index channels = inputs.dimension(3);
-
-    Eigen::Index grad_h = gradients.dimension(1);
-    Eigen::Index grad_w = gradients.dimension(2);
-
-    Eigen::Index pad_h = 0;
-    Eigen::Index pad_w = 0;
-
-    Eigen::array<std::pair<int, int>, 4> pad_dims;
-
-    if (padding_ == Eigen::PADDING_SAME) {
-        // compute total padding used in forward propagation
-        Eigen::Index output_h = std::ceil(static_cast<Scalar>(input_h) /
-                                          static_cast<Scalar>(stride_[0]));
-        Eigen::Index output_w = std::ceil(static_cast<Scalar>(input_w) /
-                                          static_cast<Scalar>(stride_[1]));
-
-        pad_h = (output_h - 1) * stride_[0] -
-                input_h + dilation_[0] * (pool_[0] - 1) + 1;
-        pad_w = (output_w - 1) * stride_[1] -
-                input_w + dilation_[1] * (pool_[1] - 1) + 1;
-    }
-
-    // pad_dims the input tensor as was done during forward propagation
-    pad_dims[0] = std::make_pair(0, 0); // don't pad_dims batch
-    pad_dims[1] = std::make_pair(pad_w / 2, pad_w - pad_w / 2); // width padding
-    pad_dims[2] = std::make_pair(pad_h / 2, pad_h - pad_h / 2); // height padding
-    pad_dims[3] = std::make_pair(0, 0); // don't pad_dims channels
-
-    Tensor<4> inputs_padded = inputs.pad(pad_dims,
-                                         std::numeric_limits<Scalar>::lowest());
-
-    // this will become dL / dX which is passed to the previous layer as dL / dZ
-    Tensor<4> input_gradients(inputs_padded.dimensions());
-    input_gradients.setZero();
-
-    // loop through all values of the gradient tensor
-    for (Eigen::Index n = 0; n < batches; n++) {
-        for (Eigen::Index h = 0; h < grad_h; h++) {
-            // set the pool window's first and last row & col indices
-            Eigen::Index pool_start_r = h * stride_[0];
-            Eigen::Index pool_end_r = pool_start_r + pool_[0];
-
-            for (Eigen::Index w = 0; w < grad_w; w++) {
-                Eigen::Index pool_start_c = w * stride_[1];
-                Eigen::Index pool_end_c = pool_start_c + pool_[1];
-
-                // in each channel, find the pool window's maximum value's row,col
-                for (Eigen::Index c = 0; c < channels; c++) {
-                    Eigen::Index max_val_row = pool_start_r;
-                    Eigen::Index max_val_col = pool_start_c;
-                    Scalar max_val = inputs_padded(n, pool_start_r, pool_start_c, c);
-
-                    // starting at the first value, visit each value of the
-                    // pool window from left to right, row by row
-                    for (Eigen::Index pool_row = pool_start_r;
-                         pool_row < pool_end_r; pool_row++) {
-                        for (Eigen::Index pool_col = pool_start_c;
-                             pool_col < pool_end_c; pool_col++) {
-                            if (inputs_padded(n, pool_row, pool_col, c) > max_val) {
-                                max_val = inputs_padded(n, pool_row, pool_col, c);
-                                max_val_row = pool_row;
-                                max_val_col = pool_col;
-                            }
-                        }
-                    }
-
-                    // the current gradient value gets added to the position of the
-                    // input tensor's max value for the current pool window
-                    input_gradients(n, max_val_row, max_val_col, c) +=
-                            gradients(n, h, w, c);
-                }
-            }
+    const Eigen::Index batches = this->dL_dX.dimension(0);
+    const Eigen::Index batch_inputs = this->dL_dX.size() / batches;
+    const Eigen::Index batch_outputs = gradients.size() / batches;
+
+    const Scalar *gradient = gradients.data();
+    const int32_t *index = this->argmax.data();
+    Scalar *input_gradients = this->dL_dX.data();
+
+    // each gradient is added to the input its output's maximum was read
+    // from, the indices are within each image, so images scatter
+    // concurrently even when pool windows overlap
+    ParallelFor(this->device, batches, 2.0 * (batch_inputs + batch_outputs),
+                [&](Eigen::Index n) {
+        Scalar *image_gradients = input_gradients + n * batch_inputs;
+        std::fill(image_gradients, image_gradients + batch_inputs, Scalar(0));
+
+        for (Eigen::Index i = n * batch_outputs; i < (n + 1) * batch_outputs; i++) {
+            image_gradients[index[i]] += gradient[i];
         }
-    }
-
-    // return the input gradients without the padding
-    this->dL_dX.device(this->device) = input_gradients.slice(
-            Dims<4>(0, pad_h / 2, pad_w / 2, 0),
-            Dims<4>(batches, input_h, input_w, channels));
+    });
 }
 
 
@@ -6,6 +6,7 @@
 #define FLARE_MULTIHEAD_ATTENTION_HPP
 
 #include "layer.hpp"
+#include "flare/parallel.hpp"
 
 namespace fl
 {
@@ -47,6 +48,23 @@ public:
 
     void Update(Optimizer &optimizer) override;
 
+    std::vector<TensorMap<1>> GetParameters() override;
+
+    std::vector<TensorMap<1>> GetParameterGradients() override;
+
+    Layer *Clone() const override;
+
+    size_t GetTensorBytes() const override;
+
+    void SetInferenceOnly(bool inference_only) override;
+
+    /**
+     * Forward keeps no attention weights, Backward recomputes them from Q and
+     * K and frees them with the other [N,T,H,T] maps when done. The segment
+     * length only switches it on, the whole sequence is recomputed at once
+     */
+    void SetCheckpointing(Eigen::Index segment) override;
+
     const Tensor<3> &GetOutput3D() const override;
 
     // for self attention where query = key = value
@@ -62,6 +80,15 @@ public:
     void SetWeights(const std::vector<fl::Tensor<3>> &weights) override;
 
 private:
+    // sm_QK_T = softmax(QK^T), the attention weights
+    void AttentionWeights();
+
+    // softmax(QK^T) x V without keeping the attention weights sm_QK_T
+    void ForwardRows();
+
+    // A from sm_QK_T_V and the output weights
+    void ForwardOutput();
+
     // layer input, not sure if having these as pointers is safe,
     // but it's faster keeping copies per Forward() and requires less memory
     Tensor<3> const *q = nullptr;
@@ -99,13 +126,18 @@ private:
     Eigen::Index input_dim = -1; // length of input's last dimension
     Eigen::Index layer_dim = -1; // length of Q,K's last dimension
 
+    bool checkpointing = false; // sm_QK_T is recomputed in Backward()
+
     // intermediate terms saved during Forward() for Backward()
     Tensor<4> sm_QK_T;
     Tensor<4> sm_QK_T_V;
-    Tensor<3> A; // layer output = softmax(Q x K_T / sqrt(dk)) x V
 
-    Eigen::ThreadPool pool {(int) std::thread::hardware_concurrency()};
-    Eigen::ThreadPoolDevice device {&pool, 2};
+    // intermediate terms of Backward(), kept to reuse their storage
+    Tensor<4> dz6;
+    Tensor<4> dz5;
+    Tensor<4> dz4;
+    Tensor<4> dz4_transpose;
+    Tensor<3> A; // layer output = softmax(Q x K_T / sqrt(dk)) x V
 };
 
 } // namespace fl
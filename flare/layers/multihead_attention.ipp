@@ -62,57 +62,133 @@ void MultiHeadAttention::Forward(const Tensor<3> &query,
     this->K.device(this->device) = key.contract(this->w_k, matmul);
     this->V.device(this->device) = value.contract(this->w_v, matmul);
 
+    if (this->inference_only || this->checkpointing) {
+        this->ForwardRows();
+        return;
+    }
+
+    this->AttentionWeights();
+
     const Eigen::Index batches = query.dimension(0);
     const Eigen::Index sequence = query.dimension(1);
     const Eigen::Index dims = this->layer_dim;
 
+    this->sm_QK_T_V.resize(this->V.dimensions());
+    this->sm_QK_T_V.setZero();
+
+    ParallelFor(this->device, batches * sequence, sequence * this->heads * dims,
+                [&](Eigen::Index i) {
+        Eigen::Index N = i / sequence;
+        Eigen::Index Tq = i % sequence;
+
+        for (Eigen::Index Tv = 0; Tv < sequence; Tv++) {
+            for (Eigen::Index H = 0; H < this->heads; H++) {
+                for (Eigen::Index D = 0; D < dims; D++) {
+                    // einsum NQHV,NVHD->NQHD
+                    this->sm_QK_T_V(N, Tq, H, D) +=
+                            this->sm_QK_T(N, Tq, H, Tv) * // here Tv is Tk
+                            this->V(N, Tv, H, D);
+                }
+            }
+        }
+    });
+
+    this->ForwardOutput();
+}
+
+
+void MultiHeadAttention::AttentionWeights()
+{
+    const Eigen::Index batches = this->Q.dimension(0);
+    const Eigen::Index sequence = this->Q.dimension(1);
+    const Eigen::Index dims = this->layer_dim;
+
     // calculate QK^T, then apply softmax
     this->sm_QK_T.resize(Dims<4>(batches, sequence, this->heads, sequence));
     this->sm_QK_T.setZero();
 
-#pragma omp parallel for simd shared(batches, sequence, dims) default(none) schedule(guided)
-    for (Eigen::Index N = 0; N < batches; N++) {
-        for (Eigen::Index Tq = 0; Tq < sequence; Tq++) {
-            for (Eigen::Index H = 0; H < this->heads; H++) {
-                for (Eigen::Index D = 0; D < dims; D++) {
-                    for (Eigen::Index Tk = 0; Tk < sequence; Tk++) {
-                        // einsum NQHK,NQHD->NKHD
-                        this->sm_QK_T(N, Tq, H, Tk) +=
-                                this->Q(N, Tq, H, D) *
-                                this->K(N, Tk, H, D);
-                    }
+    // each (N, Tq) pair writes its own rows, parallelize over them
+    ParallelFor(this->device, batches * sequence, this->heads * dims * sequence,
+                [&](Eigen::Index i) {
+        Eigen::Index N = i / sequence;
+        Eigen::Index Tq = i % sequence;
+
+        for (Eigen::Index H = 0; H < this->heads; H++) {
+            for (Eigen::Index D = 0; D < dims; D++) {
+                for (Eigen::Index Tk = 0; Tk < sequence; Tk++) {
+                    // einsum NQHK,NQHD->NKHD
+                    this->sm_QK_T(N, Tq, H, Tk) +=
+                            this->Q(N, Tq, H, D) *
+                            this->K(N, Tk, H, D);
                 }
             }
         }
-    }
+    });
 
-    this->sm_QK_T.device(this->device) = Softmax::Activate(this->sm_QK_T);
+    Softmax::Activate(this->sm_QK_T, this->sm_QK_T, this->device);
+}
+
+
+void MultiHeadAttention::ForwardRows()
+{
+    const Eigen::Index batches = this->Q.dimension(0);
+    const Eigen::Index sequence = this->Q.dimension(1);
+    const Eigen::Index dims = this->layer_dim;
 
     this->sm_QK_T_V.resize(this->V.dimensions());
     this->sm_QK_T_V.setZero();
 
-#pragma omp parallel for simd shared(batches, sequence, dims) default(none) schedule(guided)
-    for (Eigen::Index N = 0; N < batches; N++) {
-        for (Eigen::Index Tq = 0; Tq < sequence; Tq++) {
+    // each (N, Tq) pair scores one row per head, applies softmax and weighs V
+    // with it right away, no [N,T,H,T] map is kept
+    ParallelFor(this->device, batches * sequence,
+                2 * this->heads * dims * sequence, [&](Eigen::Index i) {
+        Eigen::Index N = i / sequence;
+        Eigen::Index Tq = i % sequence;
+        Scalar *weights = ThreadScratch(sequence);
+
+        for (Eigen::Index H = 0; H < this->heads; H++) {
+            Scalar max = std::numeric_limits<Scalar>::lowest();
+
+            for (Eigen::Index Tk = 0; Tk < sequence; Tk++) {
+                Scalar score = 0;
+
+                for (Eigen::Index D = 0; D < dims; D++) {
+                    score += this->Q(N, Tq, H, D) * this->K(N, Tk, H, D);
+                }
+
+                weights[Tk] = score;
+                max = std::max(max, score);
+            }
+
+            Scalar sum = 0;
+
+            for (Eigen::Index Tk = 0; Tk < sequence; Tk++) {
+                weights[Tk] = std::exp(weights[Tk] - max);
+                sum += weights[Tk];
+            }
+
             for (Eigen::Index Tv = 0; Tv < sequence; Tv++) {
-                for (Eigen::Index H = 0; H < this->heads; H++) {
-                    for (Eigen::Index D = 0; D < dims; D++) {
-                        // einsum NQHV,NVHD->NQHD
-                        this->sm_QK_T_V(N, Tq, H, D) +=
-                                this->sm_QK_T(N, Tq, H, Tv) * // here Tv is Tk
-                                this->V(N, Tv, H, D);
-                    }
+                const Scalar weight = weights[Tv] / sum;
+
+                for (Eigen::Index D = 0; D < dims; D++) {
+                    this->sm_QK_T_V(N, Tq, H, D) += weight * this->V(N, Tv, H, D);
                 }
             }
         }
-    }
+    });
 
+    this->ForwardOutput();
+}
+
+
+void MultiHeadAttention::ForwardOutput()
+{
     // concat all heads and multiply by output weights, this is equivalent to
     // the double contraction [N,T,H,D] x [H,D,F] = [N,T,F]
     Eigen::array<Eigen::IndexPair<int>, 2> double_contract = {
             Eigen::IndexPair<int>(2, 0), Eigen::IndexPair<int>(3, 1)};
 
-    this->A.resize(query.dimensions());
+    this->A.resize(this->q->dimensions());
     this->A.device(this->device) = sm_QK_T_V.contract(w_o, double_contract);
 }
 
@@ -132,8 +208,11 @@ void MultiHeadAttention::Forward(const Layer &prev)
 // during this initial implementation, Eigen didn't have einsum
 void MultiHeadAttention::Backward(const Tensor<3> &gradients)
 {
-    // TODO: FOR ALL INTERMEDIATE BACKPROPAGATION (dz_x) TERMS, MOVE
-    // TODO: THEM TO CLASS MEMBERS TO AVOID REALLOCATION PER FUNCTION CALL
+    if (this->checkpointing) {
+        // Forward didn't keep the attention weights
+        this->AttentionWeights();
+    }
+
     this->dL_w_q.setZero();
     this->dL_w_k.setZero();
     this->dL_w_v.setZero();
@@ -147,127 +226,147 @@ void MultiHeadAttention::Backward(const Tensor<3> &gradients)
     const Eigen::Index dims = this->layer_dim;
 
 
-    Tensor<4> dz6(batch, sequence, this->heads, dims);
-    dz6.device(this->device) = gradients.contract(this->w_o,
-                                                  ContractDim {Axes(2, 2)});
+    // the intermediate terms are members, their storage is reused every step
+    this->dz6.resize(batch, sequence, this->heads, dims);
+    this->dz6.device(this->device) = gradients.contract(this->w_o,
+                                                        ContractDim {Axes(2, 2)});
 
     this->dL_dV.resize(batch, this->heads, dims, seq_key);
     this->dL_dV.setZero();
 
-#pragma omp parallel for simd collapse(2) shared(batch, seq_query, dims, seq_key, dz6) default(none)
-    for (Eigen::Index N = 0; N < batch; N++) {
+    // every Tq accumulates into the same dL_dV(N, H), parallelize over (N, H)
+    ParallelFor(this->device, batch * this->heads, seq_query * dims * seq_key,
+                [&](Eigen::Index i) {
+        Eigen::Index N = i / this->heads;
+        Eigen::Index H = i % this->heads;
+
         for (Eigen::Index Tq = 0; Tq < seq_query; Tq++) {
-            for (Eigen::Index H = 0; H < this->heads; H++) {
-                for (Eigen::Index D = 0; D < dims; D++) {
-                    for (Eigen::Index Tk = 0; Tk < seq_key; Tk++) {
-                        // moved Tk dim to the end in [N, Tk, H, D] for better cache access
-                        this->dL_dV(N, H, D, Tk) +=
-                                this->sm_QK_T(N, Tq, H, Tk) * dz6(N, Tq, H, D);
-                    }
+            for (Eigen::Index D = 0; D < dims; D++) {
+                for (Eigen::Index Tk = 0; Tk < seq_key; Tk++) {
+                    // moved Tk dim to the end in [N, Tk, H, D] for better cache access
+                    this->dL_dV(N, H, D, Tk) +=
+                            this->sm_QK_T(N, Tq, H, Tk) * this->dz6(N, Tq, H, D);
                 }
             }
         }
-    }
+    });
 
-    Tensor<4> dz5(batch, seq_query, this->heads, seq_value);
-    dz5.setZero();
+    this->dz5.resize(batch, seq_query, this->heads, seq_value);
+    this->dz5.setZero();
+    this->dz4.resize(batch, seq_query, this->heads, seq_key);
 
-#pragma omp parallel for simd shared(batch, seq_key, seq_query, dims, dz6, dz5) default(none)
-    for (Eigen::Index N = 0; N < batch; N++) {
-        for (Eigen::Index Tq = 0; Tq < seq_query; Tq++) {
-            for (Eigen::Index H = 0; H < this->heads; H++) {
-                for (Eigen::Index Tv = 0; Tv < seq_key; Tv++) {
-                    for (Eigen::Index D = 0; D < dims; D++) {
-                        dz5(N, Tq, H, Tv) +=
-                                dz6(N, Tq, H, D) * this->V(N, Tv, H, D);
-                    }
-                }
-            }
-        }
-    }
-    // TODO: dz5 CAN BE COMBINED INTO WITH dz4 LOOP
-    Tensor<4> dz4(batch, seq_key, this->heads, seq_key);
-    dz4.setZero();
+    // dz4 is dz5 times the softmax Jacobian S_k * (d_kv - S_v) of each row,
+    // which simplifies to S_k * (dz5_k - sum_v dz5_v * S_v)
+    ParallelFor(this->device, batch * seq_query, 2 * this->heads * seq_key * dims,
+                [&](Eigen::Index i) {
+        Eigen::Index N = i / seq_query;
+        Eigen::Index Tq = i % seq_query;
 
-    Tensor<5> softmax_grad(batch, seq_query, this->heads, seq_key, seq_value);
-    softmax_grad.device(this->device) = Softmax::Gradients(this->sm_QK_T);
+        for (Eigen::Index H = 0; H < this->heads; H++) {
+            Scalar dz5_dot_softmax = 0;
 
-#pragma omp parallel for simd collapse(3) shared(batch, seq_key, seq_query, seq_value, dims, dz5, dz4, softmax_grad) default(none)
-    for (Eigen::Index N = 0; N < batch; N++) {
-        for (Eigen::Index Tq = 0; Tq < seq_query; Tq++) {
-            for (Eigen::Index H = 0; H < this->heads; H++) {
-                for (Eigen::Index Tk = 0; Tk < seq_key; Tk++) {
-                    for (Eigen::Index Tv = 0; Tv < seq_value; Tv++) {
-                        dz4(N, Tq, H, Tk) +=
-                                dz5(N, Tq, H, Tv) *
-                                softmax_grad(N, Tq, H, Tk, Tv);
-                    }
+            for (Eigen::Index Tv = 0; Tv < seq_key; Tv++) {
+                for (Eigen::Index D = 0; D < dims; D++) {
+                    this->dz5(N, Tq, H, Tv) +=
+                            this->dz6(N, Tq, H, D) * this->V(N, Tv, H, D);
                 }
+
+                dz5_dot_softmax +=
+                        this->dz5(N, Tq, H, Tv) * this->sm_QK_T(N, Tq, H, Tv);
+            }
+
+            for (Eigen::Index Tk = 0; Tk < seq_key; Tk++) {
+                this->dz4(N, Tq, H, Tk) = this->sm_QK_T(N, Tq, H, Tk) *
+                                          (this->dz5(N, Tq, H, Tk) - dz5_dot_softmax);
             }
         }
-    }
+    });
 
     // transpose dz4 for better cache access
-    Tensor<4> dz4_transpose(dz4.dimension(0),
-                            dz4.dimension(1),
-                            dz4.dimension(3),
-                            dz4.dimension(2));
-    dz4_transpose.device(this->device) = dz4.shuffle(Dims<4>(0, 1, 3, 2));
+    this->dz4_transpose.resize(this->dz4.dimension(0),
+                               this->dz4.dimension(1),
+                               this->dz4.dimension(3),
+                               this->dz4.dimension(2));
+
+    ParallelFor(this->device, batch * seq_query, this->heads * seq_key,
+                [&](Eigen::Index i) {
+        Eigen::Index N = i / seq_query;
+        Eigen::Index Tq = i % seq_query;
+
+        for (Eigen::Index H = 0; H < this->heads; H++) {
+            for (Eigen::Index Tk = 0; Tk < seq_key; Tk++) {
+                this->dz4_transpose(N, Tq, Tk, H) = this->dz4(N, Tq, H, Tk);
+            }
+        }
+    });
 
     this->dL_dK.resize(batch, seq_key, this->heads, dims);
     this->dL_dK.setZero();
 
-#pragma omp parallel for simd collapse(2) shared(batch, seq_key, seq_query, dims, dz4_transpose) default(none)
-    for (Eigen::Index N = 0; N < batch; N++) {
+    // every Tq accumulates into the same dL_dK(N, Tk), parallelize over (N, Tk)
+    ParallelFor(this->device, batch * seq_key, seq_query * this->heads * dims,
+                [&](Eigen::Index i) {
+        Eigen::Index N = i / seq_key;
+        Eigen::Index Tk = i % seq_key;
+
         for (Eigen::Index Tq = 0; Tq < seq_query; Tq++) {
-            for (Eigen::Index Tk = 0; Tk < seq_key; Tk++) {
-                for (Eigen::Index H = 0; H < this->heads; H++) {
-                    for (Eigen::Index D = 0; D < dims; D++) {
-                        this->dL_dK(N, Tk, H, D) += dz4_transpose(N, Tq, Tk, H) *
-                                                    this->Q(N, Tq, H, D);
-                    }
+            for (Eigen::Index H = 0; H < this->heads; H++) {
+                for (Eigen::Index D = 0; D < dims; D++) {
+                    this->dL_dK(N, Tk, H, D) += this->dz4_transpose(N, Tq, Tk, H) *
+                                                this->Q(N, Tq, H, D);
                 }
             }
         }
-    }
+    });
 
     this->dL_dQ.resize(batch, seq_query, this->heads, dims);
     this->dL_dQ.setZero();
 
-#pragma omp parallel for simd shared(batch, seq_key, seq_query, dims, dz4_transpose) default(none)
-    for (Eigen::Index N = 0; N < batch; N++) {
-        for (Eigen::Index Tq = 0; Tq < seq_query; Tq++) {
-            for (Eigen::Index Tk = 0; Tk < seq_key; Tk++) {
-                for (Eigen::Index H = 0; H < this->heads; H++) {
-                    for (Eigen::Index D = 0; D < dims; D++) {
-                        this->dL_dQ(N, Tq, H, D) +=
-                                dz4_transpose(N, Tq, Tk, H) * this->K(N, Tk, H, D);
-                    }
+    ParallelFor(this->device, batch * seq_query, seq_key * this->heads * dims,
+                [&](Eigen::Index i) {
+        Eigen::Index N = i / seq_query;
+        Eigen::Index Tq = i % seq_query;
+
+        for (Eigen::Index Tk = 0; Tk < seq_key; Tk++) {
+            for (Eigen::Index H = 0; H < this->heads; H++) {
+                for (Eigen::Index D = 0; D < dims; D++) {
+                    this->dL_dQ(N, Tq, H, D) +=
+                            this->dz4_transpose(N, Tq, Tk, H) * this->K(N, Tk, H, D);
                 }
             }
         }
-    }
+    });
 
     // calculate weight gradients
     Eigen::array<Eigen::IndexPair<int>, 2> double_contract = {
             Eigen::IndexPair<int>(0, 0), Eigen::IndexPair<int>(1, 1)};
-    Dims<3> shuffle_FHD_HFD(1, 0, 2);
 
-    this->dL_w_q.device(this->device) =
-            this->q->contract(this->dL_dQ, double_contract).shuffle(shuffle_FHD_HFD)
-            / std::sqrt(static_cast<Scalar>(this->layer_dim));
-
-    this->dL_w_k.device(this->device) =
-            this->k->contract(this->dL_dK, double_contract).shuffle(shuffle_FHD_HFD);
-
-    // dL_dV was "shuffled" so this will not be using the same contraction dims
-    this->dL_w_v.device(this->device) =
-            this->v->contract(this->dL_dV, Eigen::array<Eigen::IndexPair<int>, 2> {
-                    Eigen::IndexPair<int>(0, 0),
-                    Eigen::IndexPair<int>(1, 3)}).shuffle(shuffle_FHD_HFD);
+    // one [F, D] contraction per head written straight into its block of
+    // [H, F, D], shuffling an [F, H, D] result takes Eigen's tiled evaluation
+    // which allocates its block bookkeeping on every call
+    for (Eigen::Index H = 0; H < this->heads; H++) {
+        this->dL_w_q.chip(H, 0).device(this->device) =
+                this->q->contract(this->dL_dQ.chip(H, 2), double_contract)
+                / std::sqrt(static_cast<Scalar>(this->layer_dim));
+
+        this->dL_w_k.chip(H, 0).device(this->device) =
+                this->k->contract(this->dL_dK.chip(H, 2), double_contract);
+
+        // dL_dV was "shuffled" so this will not be using the same contraction dims
+        this->dL_w_v.chip(H, 0).device(this->device) =
+                this->v->contract(this->dL_dV.chip(H, 1),
+                                  Eigen::array<Eigen::IndexPair<int>, 2> {
+                                          Eigen::IndexPair<int>(0, 0),
+                                          Eigen::IndexPair<int>(1, 2)});
+    }
 
     this->dL_w_o.device(this->device) =
             this->sm_QK_T_V.contract(gradients, double_contract);
+
+    if (this->checkpointing) {
+        // free the [N,T,H,T] maps until the next Backward
+        Layer::FreeTensors(this->sm_QK_T, this->dz5, this->dz4, this->dz4_transpose);
+    }
 }
 
 
@@ -286,6 +385,64 @@ void MultiHeadAttention::Update(Optimizer &optimizer)
 }
 
 
+std::vector<TensorMap<1>> MultiHeadAttention::GetParameters()
+{
+    return {Layer::FlatView(this->w_q), Layer::FlatView(this->w_k), Layer::FlatView(this->w_v), Layer::FlatView(this->w_o)};
+}
+
+
+std::vector<TensorMap<1>> MultiHeadAttention::GetParameterGradients()
+{
+    return {Layer::FlatView(this->dL_w_q), Layer::FlatView(this->dL_w_k), Layer::FlatView(this->dL_w_v), Layer::FlatView(this->dL_w_o)};
+}
+
+
+Layer *MultiHeadAttention::Clone() const
+{
+    return new MultiHeadAttention(*this);
+}
+
+
+void MultiHeadAttention::SetInferenceOnly(bool inference_only)
+{
+    Layer::SetInferenceOnly(inference_only);
+
+    if (inference_only) {
+        Layer::FreeTensors(this->dL_dQ, this->dL_dK, this->dL_dV, this->dL_dX,
+                           this->dL_dq, this->dL_dk, this->dL_dv, this->dL_w_q,
+                           this->dL_w_k, this->dL_w_v, this->dL_w_o, this->sm_QK_T,
+                           this->dz6, this->dz5, this->dz4, this->dz4_transpose);
+        return;
+    }
+
+    this->dL_w_q.resize(this->w_q.dimensions());
+    this->dL_w_k.resize(this->w_k.dimensions());
+    this->dL_w_v.resize(this->w_v.dimensions());
+    this->dL_w_o.resize(this->w_o.dimensions());
+}
+
+
+void MultiHeadAttention::SetCheckpointing(Eigen::Index segment)
+{
+    this->checkpointing = segment > 0;
+
+    if (this->checkpointing) {
+        Layer::FreeTensors(this->sm_QK_T);
+    }
+}
+
+
+size_t MultiHeadAttention::GetTensorBytes() const
+{
+    return Layer::TensorBytes(this->Q, this->K, this->V, this->dL_dQ, this->dL_dK,
+                              this->dL_dV, this->dL_dX, this->dL_dq, this->dL_dk,
+                              this->dL_dv, this->w_q, this->w_k, this->w_v, this->w_o,
+                              this->dL_w_q, this->dL_w_k, this->dL_w_v, this->dL_w_o,
+                              this->sm_QK_T, this->sm_QK_T_V, this->A, this->dz6,
+                              this->dz5, this->dz4, this->dz4_transpose);
+}
+
+
 const Tensor<3> &MultiHeadAttention::GetOutput3D() const
 {
     return this->A;
@@ -28,6 +28,12 @@ public:
 
     void Update(Optimizer &) override;
 
+    Layer *Clone() const override;
+
+    size_t GetTensorBytes() const override;
+
+    void SetInferenceOnly(bool inference_only) override;
+
     const Tensor<2> &GetOutput2D() const override;
 
     const Tensor<3> &GetOutput3D() const override;
@@ -52,11 +58,6 @@ private:
     Tensor<OutputTensorRank> Z;
     Tensor<OutputTensorRank> dL_dZ;
     Tensor<InputTensorRank> dL_dX;
-
-    // multithreading
-    Eigen::ThreadPool pool = Eigen::ThreadPool(
-            (int) std::thread::hardware_concurrency());
-    Eigen::ThreadPoolDevice device = Eigen::ThreadPoolDevice(&pool, 2);
 };
 
 } // namespace fl
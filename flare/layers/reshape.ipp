@@ -11,9 +11,7 @@ namespace fl
 template<int InputTensorRank, int OutputTensorRank>
 Reshape<InputTensorRank, OutputTensorRank>::Reshape(
         const Dims <OutputTensorRank> &output_dims) :
-        output_dims(output_dims),
-        pool((int) std::thread::hardware_concurrency()),
-        device(&pool, 2)
+        output_dims(output_dims)
 {
     for (int i = 0; i < output_dims.size(); i++) {
         if (output_dims[i] == -1) {
@@ -32,9 +30,7 @@ Reshape<InputTensorRank, OutputTensorRank>::Reshape(
 
 template<int InputTensorRank, int OutputTensorRank>
 Reshape<InputTensorRank, OutputTensorRank>::Reshape(
-        const std::vector<Eigen::Index> &output_dims) :
-        pool((int) std::thread::hardware_concurrency()),
-        device(&pool, 2)
+        const std::vector<Eigen::Index> &output_dims)
 {
     if (output_dims.size() == OutputTensorRank) {
         std::copy_n(output_dims.begin(), OutputTensorRank,
@@ -119,7 +115,7 @@ void Reshape<InputTensorRank, OutputTensorRank>::Backward(
                          << gradients.dimensions());
 
     this->dL_dZ.resize(gradients.dimensions());
-    this->dL_dZ.device(this->device) = gradients;
+    ParallelCopy(this->device, gradients, this->dL_dZ);
 }
 
 
@@ -148,6 +144,31 @@ void Reshape<InputTensorRank, OutputTensorRank>::Update(Optimizer &)
 }
 
 
+template<int InputTensorRank, int OutputTensorRank>
+Layer *Reshape<InputTensorRank, OutputTensorRank>::Clone() const
+{
+    return new Reshape<InputTensorRank, OutputTensorRank>(*this);
+}
+
+
+template<int InputTensorRank, int OutputTensorRank>
+void Reshape<InputTensorRank, OutputTensorRank>::SetInferenceOnly(bool inference_only)
+{
+    Layer::SetInferenceOnly(inference_only);
+
+    if (inference_only) {
+        Layer::FreeTensors(this->dL_dZ, this->dL_dX);
+    }
+}
+
+
+template<int InputTensorRank, int OutputTensorRank>
+size_t Reshape<InputTensorRank, OutputTensorRank>::GetTensorBytes() const
+{
+    return Layer::TensorBytes(this->Z, this->dL_dZ, this->dL_dX);
+}
+
+
 template<int InputTensorRank, int OutputTensorRank>
 const Tensor<2> &Reshape<InputTensorRank, OutputTensorRank>::GetOutput2D() const
 {
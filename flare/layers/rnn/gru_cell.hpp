@@ -7,6 +7,7 @@
 
 #include "flare/fl_types.hpp"
 #include "flare/fl_assert.hpp"
+#include "flare/gemm.hpp"
 
 namespace fl
 {
@@ -24,9 +25,12 @@ public:
     }
 
 
-    // calculate the GRU layer output at this cell's time step
+    // calculate the GRU layer output at this cell's time step, packed_zr and
+    // packed_h are the weights packed for GemmBackend::PACKED, null to contract
     void Forward(const Tensor<3> &inputs, Tensor<3> &h, const Tensor<2> &w_zr,
-                 const Tensor<2> &w_h, const Eigen::ThreadPoolDevice &device)
+                 const Tensor<2> &w_h, const Device &device,
+                 const PackedMatrix *packed_zr = nullptr,
+                 const PackedMatrix *packed_h = nullptr)
     {
         fl_assert(
                 inputs.dimension(2) + h.dimension(2) == w_zr.dimension(0),
@@ -62,10 +66,23 @@ public:
         // since update and reset weights are come side-by-side as w_z:w_r,
         // concatenate x_t:h_prev to calculate gate values together
         // z:r = g(x_t x Wzr + h_prev x Uzr) = g(x_t:h_prev x Wzr)
-        this->pzr_gate.device(device) =
-                inputs.slice(this->x_offset(), this->x_extent())
-                        .concatenate(this->h_prev, 2)
-                        .contract(w_zr, contract_axes);
+        if (packed_zr) {
+            this->x_h.resize(this->batch_size, w_zr.dimension(0));
+            this->x_h.slice(Dims<2>(0, 0), Dims<2>(this->batch_size, inputs.dimension(2)))
+                    .device(device) = inputs.chip(this->time_step, 1);
+            this->x_h.slice(Dims<2>(0, inputs.dimension(2)),
+                            Dims<2>(this->batch_size, this->output_len))
+                    .device(device) = this->h_prev.chip(0, 1);
+            Gemm::Run(this->batch_size, this->x_h.data(), this->x_h.dimension(1), 1,
+                      *packed_zr, this->pzr_gate.data(), 2 * this->output_len, device);
+        }
+        else {
+            this->pzr_gate.device(device) =
+                    inputs.slice(this->x_offset(), this->x_extent())
+                            .concatenate(this->h_prev, 2)
+                            .contract(w_zr, contract_axes);
+        }
+
         this->zr_gate.device(device) = GateActivation::Activate(this->pzr_gate);
 
         // set up gate expressions
@@ -73,10 +90,20 @@ public:
         auto reset_gate = this->zr_gate.slice(this->r_offset(), this->r_extent());
 
         // calculate candidate output = g(x_t x W_h + (r_t *h_prev)xU_c)
-        this->pcandidate.device(device) =
-                inputs.slice(this->x_offset(), this->x_extent())
-                        .concatenate(reset_gate * this->h_prev, 2)
-                        .contract(w_h, contract_axes);
+        if (packed_h) {
+            // x_t is still in the left part of x_h
+            this->x_h.slice(Dims<2>(0, inputs.dimension(2)),
+                            Dims<2>(this->batch_size, this->output_len))
+                    .device(device) = (reset_gate * this->h_prev).chip(0, 1);
+            Gemm::Run(this->batch_size, this->x_h.data(), this->x_h.dimension(1), 1,
+                      *packed_h, this->pcandidate.data(), this->output_len, device);
+        }
+        else {
+            this->pcandidate.device(device) =
+                    inputs.slice(this->x_offset(), this->x_extent())
+                            .concatenate(reset_gate * this->h_prev, 2)
+                            .contract(w_h, contract_axes);
+        }
         this->candidate.template device(device) =
                 Activation::Activate(this->pcandidate);
 
@@ -92,7 +119,7 @@ public:
                   const Tensor<2> &w_zr, Tensor<2> &dL_dw_zr,
                   const Tensor<2> &w_c, Tensor<2> &dL_dw_c,
                   const Tensor<3> &h, Tensor<3> &dL_dx,
-                  const Eigen::ThreadPoolDevice &device)
+                  const Device &device)
     {
         this->Backward(next_cell.GetCellInputGradients(), inputs,
                        w_zr, dL_dw_zr,
@@ -105,7 +132,7 @@ public:
     void Backward(const Tensor<3> &gradients, const Tensor<3> &inputs,
                   const Tensor<2> &w_zr, Tensor<2> &dL_dw_zr,
                   const Tensor<2> &w_c, Tensor<2> &dL_dw_c,
-                  const Tensor<3> &h, const Eigen::ThreadPoolDevice &device)
+                  const Tensor<3> &h, const Device &device)
     {
         // resize pre-activation update, reset, and candidate gradients
         this->dL_dpzr.resize(this->pzr_gate.dimensions());
@@ -181,10 +208,35 @@ public:
     }
 
 
+    // free the cached tensors, Forward computes them again
+    void Release()
+    {
+        this->zr_gate = Tensor<3>();
+        this->pzr_gate = Tensor<3>();
+        this->candidate = Tensor<3>();
+        this->pcandidate = Tensor<3>();
+        this->h_prev = Tensor<3>();
+        this->x_h = Tensor<2>();
+        this->dL_dpzr = Tensor<3>();
+        this->dL_dpcand = Tensor<3>();
+        this->dL_dh_prev = Tensor<3>();
+    }
+
+
+    // bytes held by the cell's cached tensors
+    size_t GetTensorBytes() const
+    {
+        return (this->zr_gate.size() + this->pzr_gate.size() + this->candidate.size() +
+                this->pcandidate.size() + this->h_prev.size() + this->dL_dpzr.size() +
+                this->dL_dpcand.size() + this->dL_dh_prev.size() + this->x_h.size()) *
+               sizeof(Scalar);
+    }
+
+
     // calculate the GRU layer's input gradients at this cell's time step
     void CalcLayerInputGradients(
             const Tensor<2> &w_zr, const Tensor<2> &w_c, Tensor<3> &dL_dx,
-            const Eigen::ThreadPoolDevice &device)
+            const Device &device)
     {
         // dL/dx = dL/dpcand x w_c + dL/dpr x w_r + dL/dpz x w_z
         auto w_z = w_zr.slice(this->w_z_offset(), this->w_extent());
@@ -271,6 +323,8 @@ private:
 
     Tensor<3> h_prev;
 
+    Tensor<2> x_h; // x_t:h_prev, then x_t:(r_t * h_prev), for GemmBackend::PACKED
+
     // loss gradients w.r.t. update and reset gate, candidate, and prev cell output
     Tensor<3> dL_dpzr;
     Tensor<3> dL_dpcand;
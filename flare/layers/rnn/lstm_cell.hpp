@@ -4,6 +4,7 @@
 
 #include "flare/fl_types.hpp"
 #include "flare/fl_assert.hpp"
+#include "flare/gemm.hpp"
 
 #ifndef FLARE_LSTM_CELL_HPP
 #define FLARE_LSTM_CELL_HPP
@@ -24,10 +25,12 @@ public:
     }
 
 
+    // packed_w is w packed for GemmBackend::PACKED, null to contract with w
     template<typename Device>
     void Forward(const Tensor<3> &x, const Tensor<2> &w,
                  Tensor<3> &h, Tensor<3> &cs,
-                 const Device &device = Eigen::DefaultDevice())
+                 const Device &device = Eigen::DefaultDevice(),
+                 const PackedMatrix *packed_w = nullptr)
     {
         // resize for multi-threading
         this->gates.resize(x.dimension(0), this->output_len * 4);
@@ -53,8 +56,15 @@ public:
                     .setZero();
         }
 
-        this->p_gates.device(device) =
-                this->x_h_prev.contract(w, ContractDim {Axes(1, 0)});
+        if (packed_w) {
+            Gemm::Run(this->x_h_prev.dimension(0), this->x_h_prev.data(),
+                      this->x_h_prev.dimension(1), 1, *packed_w,
+                      this->p_gates.data(), this->p_gates.dimension(1), device);
+        }
+        else {
+            this->p_gates.device(device) =
+                    this->x_h_prev.contract(w, ContractDim {Axes(1, 0)});
+        }
 
         this->gates.slice(this->i_offset(), this->gate_extent()).device(device) =
                 GateActivation::Activate(
@@ -185,6 +195,28 @@ public:
     }
 
 
+    // free the cached tensors, Forward computes them again
+    void Release()
+    {
+        this->x_h_prev = Tensor<2>();
+        this->gates = Tensor<2>();
+        this->p_gates = Tensor<2>();
+        this->dp_gates = Tensor<2>();
+        this->dh_prev = Tensor<2>();
+        this->dcs_prev = Tensor<2>();
+        this->cs_prev = Tensor<2>();
+    }
+
+
+    // bytes held by the cell's cached tensors
+    size_t GetTensorBytes() const
+    {
+        return (this->x_h_prev.size() + this->gates.size() + this->p_gates.size() +
+                this->dp_gates.size() + this->dh_prev.size() + this->dcs_prev.size() +
+                this->cs_prev.size()) * sizeof(Scalar);
+    }
+
+
     template<typename Device>
     void CalcInputGradients(Tensor<3> &dL_dx, const Tensor<2> &w,
                             const Device &device = Eigen::DefaultDevice())
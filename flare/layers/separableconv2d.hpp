@@ -0,0 +1,103 @@
+//
+// Created by R on 10/18/26.
+//
+
+#ifndef FLARE_SEPARABLECONV2D_HPP
+#define FLARE_SEPARABLECONV2D_HPP
+
+#include "depthwiseconv2d.hpp"
+#include "flare/activations/linear.hpp"
+
+namespace fl
+{
+
+template<typename Activation, int Threads = 2>
+class SeparableConv2D : public Layer
+{
+public:
+    /**
+     * Depthwise separable 2D convolution, a linear DepthwiseConv2D followed by
+     * a 1x1 Conv2D mixing its channels into num_filters outputs. Costs
+     * KH * KW * C * M + C * M * F multiply-adds per pixel instead of
+     * KH * KW * C * F for the Conv2D it stands in for
+     *
+     * @param num_filters        num filters of the pointwise convolution
+     * @param input_channels     input tensor channels
+     * @param kernel             depthwise kernel dimensions, Kernel(height, width)
+     * @param stride             depthwise stride dimensions, Stride(height, width)
+     * @param dilation           depthwise dilation dimensions, Dilation(height, width)
+     * @param padding            padding type, Padding::PADDING_VALID or Padding::PADDING_SAME
+     * @param depth_multiplier   depthwise output channels per input channel, M
+     * @param initializer        kernel initialization method of both convolutions
+     */
+    SeparableConv2D(int num_filters, int input_channels, const Kernel &kernel,
+                    const Stride &stride, const Dilation &dilation, Padding padding,
+                    int depth_multiplier = 1,
+                    const Initializer<4> &initializer = GlorotUniform<4>());
+
+    SeparableConv2D(int num_filters, int input_channels, const Kernel &kernel,
+                    Padding padding = Padding::PADDING_VALID, int depth_multiplier = 1,
+                    const Initializer<4> &initializer = GlorotUniform<4>());
+
+    void Forward(const Tensor<4> &inputs) override;
+
+    void Forward(const Layer &prev) override;
+
+    void Backward(const Tensor<4> &gradients) override;
+
+    void Backward(Layer &next) override;
+
+    void Update(Optimizer &optimizer) override;
+
+    std::vector<TensorMap<1>> GetParameters() override;
+
+    std::vector<TensorMap<1>> GetParameterGradients() override;
+
+    Layer *Clone() const override;
+
+    size_t GetTensorBytes() const override;
+
+    void SetExecutionContext(ExecutionContext &context) override;
+
+    void SetGemmBackend(GemmBackend backend) override;
+
+    void Freeze(bool frozen) override;
+
+    // folded into the pointwise convolution
+    bool Fold(const Tensor<1> &scale, const Tensor<1> &shift, Scalar leak) override;
+
+    void Unfold() override;
+
+    void SetInferenceOnly(bool inference_only) override;
+
+    // the pointwise convolution's algorithm, the depthwise one always runs directly
+    void SetConvAlgorithm(ConvAlgorithm algorithm);
+
+    const Tensor<4> &GetOutput4D() const override;
+
+    const Tensor<4> &GetInputGradients4D() override;
+
+    std::vector<Tensor<4>> GetWeights4D() const override;
+
+    std::vector<Tensor<4>> GetWeightGradients4D() const override;
+
+    void SetWeights(const std::vector<Tensor<4>> &weights) override;
+
+    int GetInputRank() const override;
+
+    int GetOutputRank() const override;
+
+    void Save(const std::string &path) override;
+
+    void Load(const std::string &path) override;
+
+private:
+    DepthwiseConv2D<Linear, Threads> depthwise;
+    Conv2D<Activation, Threads> pointwise; // borrows the depthwise output
+};
+
+} // namespace fl
+
+#include "separableconv2d.ipp"
+
+#endif //FLARE_SEPARABLECONV2D_HPP
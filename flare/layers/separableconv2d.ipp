@@ -0,0 +1,246 @@
+//
+// Created by R on 10/18/26.
+//
+
+#include "separableconv2d.hpp"
+
+namespace fl
+{
+
+template<typename Activation, int Threads>
+SeparableConv2D<Activation, Threads>::SeparableConv2D(
+        int num_filters, int input_channels, const Kernel &kernel,
+        const Stride &stride, const Dilation &dilation, Padding padding,
+        int depth_multiplier, const Initializer<4> &initializer) :
+        depthwise(input_channels, kernel, stride, dilation, padding,
+                  depth_multiplier, initializer),
+        pointwise(num_filters, input_channels * depth_multiplier, Kernel(1, 1),
+                  Padding::PADDING_VALID, initializer)
+{
+    this->pointwise.BorrowInput(true);
+    this->name = "separable_conv2d";
+    this->depthwise.name = this->name + "_depthwise";
+    this->pointwise.name = this->name + "_pointwise";
+}
+
+
+template<typename Activation, int Threads>
+SeparableConv2D<Activation, Threads>::SeparableConv2D(
+        int num_filters, int input_channels, const Kernel &kernel,
+        Padding padding, int depth_multiplier, const Initializer<4> &initializer)
+        : SeparableConv2D(num_filters, input_channels, kernel, Stride(1, 1),
+                          Dilation(1, 1), padding, depth_multiplier, initializer)
+{
+    // nothing to do
+}
+
+
+template<typename Activation, int Threads>
+void SeparableConv2D<Activation, Threads>::Forward(const Tensor<4> &inputs)
+{
+    // the depthwise convolution reads the input like this layer would
+    this->depthwise.BorrowInput(this->borrow_input);
+    this->depthwise.Forward(inputs);
+    this->pointwise.Forward(this->depthwise);
+}
+
+
+template<typename Activation, int Threads>
+void SeparableConv2D<Activation, Threads>::Forward(const Layer &prev)
+{
+    this->Forward(prev.GetOutput4D());
+}
+
+
+template<typename Activation, int Threads>
+void SeparableConv2D<Activation, Threads>::Backward(const Tensor<4> &gradients)
+{
+    this->pointwise.Backward(gradients);
+    this->depthwise.Backward(this->pointwise);
+}
+
+
+template<typename Activation, int Threads>
+void SeparableConv2D<Activation, Threads>::Backward(Layer &next)
+{
+    this->Backward(next.GetInputGradients4D());
+}
+
+
+template<typename Activation, int Threads>
+void SeparableConv2D<Activation, Threads>::Update(Optimizer &optimizer)
+{
+    this->depthwise.Update(optimizer);
+    this->pointwise.Update(optimizer);
+}
+
+
+template<typename Activation, int Threads>
+std::vector<TensorMap<1>> SeparableConv2D<Activation, Threads>::GetParameters()
+{
+    std::vector<TensorMap<1>> parameters = this->depthwise.GetParameters();
+    std::vector<TensorMap<1>> pointwise_parameters = this->pointwise.GetParameters();
+    parameters.insert(parameters.end(), pointwise_parameters.begin(),
+                      pointwise_parameters.end());
+    return parameters;
+}
+
+
+template<typename Activation, int Threads>
+std::vector<TensorMap<1>> SeparableConv2D<Activation, Threads>::GetParameterGradients()
+{
+    std::vector<TensorMap<1>> gradients = this->depthwise.GetParameterGradients();
+    std::vector<TensorMap<1>> pointwise_gradients =
+            this->pointwise.GetParameterGradients();
+    gradients.insert(gradients.end(), pointwise_gradients.begin(),
+                     pointwise_gradients.end());
+    return gradients;
+}
+
+
+template<typename Activation, int Threads>
+Layer *SeparableConv2D<Activation, Threads>::Clone() const
+{
+    return new SeparableConv2D<Activation, Threads>(*this);
+}
+
+
+template<typename Activation, int Threads>
+size_t SeparableConv2D<Activation, Threads>::GetTensorBytes() const
+{
+    return this->depthwise.GetTensorBytes() + this->pointwise.GetTensorBytes();
+}
+
+
+template<typename Activation, int Threads>
+void SeparableConv2D<Activation, Threads>::SetExecutionContext(ExecutionContext &context)
+{
+    Layer::SetExecutionContext(context);
+    this->depthwise.SetExecutionContext(context);
+    this->pointwise.SetExecutionContext(context);
+}
+
+
+template<typename Activation, int Threads>
+void SeparableConv2D<Activation, Threads>::SetGemmBackend(GemmBackend backend)
+{
+    this->depthwise.SetGemmBackend(backend);
+    this->pointwise.SetGemmBackend(backend);
+}
+
+
+template<typename Activation, int Threads>
+void SeparableConv2D<Activation, Threads>::Freeze(bool frozen)
+{
+    this->depthwise.Freeze(frozen);
+    this->pointwise.Freeze(frozen);
+}
+
+
+template<typename Activation, int Threads>
+bool SeparableConv2D<Activation, Threads>::Fold(const Tensor<1> &scale,
+                                                const Tensor<1> &shift, Scalar leak)
+{
+    return this->pointwise.Fold(scale, shift, leak);
+}
+
+
+template<typename Activation, int Threads>
+void SeparableConv2D<Activation, Threads>::Unfold()
+{
+    this->pointwise.Unfold();
+}
+
+
+template<typename Activation, int Threads>
+void SeparableConv2D<Activation, Threads>::SetInferenceOnly(bool inference_only)
+{
+    Layer::SetInferenceOnly(inference_only);
+    this->depthwise.SetInferenceOnly(inference_only);
+    this->pointwise.SetInferenceOnly(inference_only);
+}
+
+
+template<typename Activation, int Threads>
+void SeparableConv2D<Activation, Threads>::SetConvAlgorithm(ConvAlgorithm algorithm)
+{
+    this->pointwise.SetConvAlgorithm(algorithm);
+}
+
+
+template<typename Activation, int Threads>
+const Tensor<4> &SeparableConv2D<Activation, Threads>::GetOutput4D() const
+{
+    return this->pointwise.GetOutput4D();
+}
+
+
+template<typename Activation, int Threads>
+const Tensor<4> &SeparableConv2D<Activation, Threads>::GetInputGradients4D()
+{
+    return this->depthwise.GetInputGradients4D();
+}
+
+
+template<typename Activation, int Threads>
+std::vector<Tensor<4>> SeparableConv2D<Activation, Threads>::GetWeights4D() const
+{
+    return {this->depthwise.GetWeights4D().front(),
+            this->pointwise.GetWeights4D().front()};
+}
+
+
+template<typename Activation, int Threads>
+std::vector<Tensor<4>> SeparableConv2D<Activation, Threads>::GetWeightGradients4D() const
+{
+    return {this->depthwise.GetWeightGradients4D().front(),
+            this->pointwise.GetWeightGradients4D().front()};
+}
+
+
+template<typename Activation, int Threads>
+void SeparableConv2D<Activation, Threads>::SetWeights(
+        const std::vector<Tensor<4>> &weights)
+{
+    // {depthwise kernels, pointwise kernels}
+    if (weights.size() != 2) {
+        throw std::invalid_argument(
+                this->name +
+                " SetWeights() expects 2 values: depthwise & pointwise kernels");
+    }
+
+    this->depthwise.SetWeights(std::vector<Tensor<4>> {weights[0]});
+    this->pointwise.SetWeights(std::vector<Tensor<4>> {weights[1]});
+}
+
+
+template<typename Activation, int Threads>
+int SeparableConv2D<Activation, Threads>::GetInputRank() const
+{
+    return 4;
+}
+
+
+template<typename Activation, int Threads>
+int SeparableConv2D<Activation, Threads>::GetOutputRank() const
+{
+    return 4;
+}
+
+
+template<typename Activation, int Threads>
+void SeparableConv2D<Activation, Threads>::Save(const std::string &path)
+{
+    this->depthwise.Save(path + ".depthwise");
+    this->pointwise.Save(path + ".pointwise");
+}
+
+
+template<typename Activation, int Threads>
+void SeparableConv2D<Activation, Threads>::Load(const std::string &path)
+{
+    this->depthwise.Load(path + ".depthwise");
+    this->pointwise.Load(path + ".pointwise");
+}
+
+} // namespace fl
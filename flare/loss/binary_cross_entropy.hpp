@@ -46,12 +46,16 @@ public:
                                            " don't match label dimensions "
                                            << label.dimensions());
 
-        Tensor<TensorRank> predict_clip = predict.clip(this->clip_min,
-                                                       this->clip_max);
-        return -Tensor<0>((label * (predict_clip + this->epsilon).log() +
-                           (1.0 - label) *
-                           (1.0 - predict_clip + this->epsilon).log())
-                                  .mean()).coeff();
+        Tensor<TensorRank> predict_clip(predict.dimensions());
+        predict_clip.device(this->device) = predict.clip(this->clip_min,
+                                                         this->clip_max);
+
+        Tensor<0> loss;
+        loss.device(this->device) = (label * (predict_clip + this->epsilon).log() +
+                                     (1.0 - label) *
+                                     (1.0 - predict_clip + this->epsilon).log())
+                .mean();
+        return -loss.coeff();
     };
 
 
@@ -63,9 +67,12 @@ public:
                                            " don't match label dimensions "
                                            << label.dimensions());
 
-        return (-label / (predict + this->epsilon) +
-                (1 - label) / (1 - predict + this->epsilon)) /
-               static_cast<Scalar>(predict.size());
+        Tensor<TensorRank> gradients(predict.dimensions());
+        gradients.device(this->device) =
+                (-label / (predict + this->epsilon) +
+                 (1 - label) / (1 - predict + this->epsilon)) /
+                static_cast<Scalar>(predict.size());
+        return gradients;
     };
 };
 
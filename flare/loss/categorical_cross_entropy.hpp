@@ -59,11 +59,12 @@ public:
         auto predict_norm = predict / predict.sum(Dims<1>(TensorRank - 1)).reshape(
                 predict_summed).eval().broadcast(bcast);
 
-        return Tensor<0>(
+        Tensor<0> loss;
+        loss.device(this->device) =
                 (-label * predict_norm.clip(this->clip_min, this->clip_max).log())
-                        .sum()).coeff() /
-               (predict.dimensions().TotalSize() /
-                predict.dimension(TensorRank - 1));
+                        .sum();
+        return loss.coeff() / (predict.dimensions().TotalSize() /
+                               predict.dimension(TensorRank - 1));
     }
 
 
@@ -95,7 +96,9 @@ public:
                         .eval()
                         .broadcast(bcast);
 
-        return (-label / predict + label_predict_sum);
+        Tensor<TensorRank> gradients(predict.dimensions());
+        gradients.device(this->device) = -label / predict + label_predict_sum;
+        return gradients;
     }
 };
 
@@ -33,9 +33,11 @@ public:
                                            " don't match label dimensions "
                                            << label.dimensions());
 
-        return Tensor<0>(
+        Tensor<0> loss;
+        loss.device(this->device) =
                 (label * ((label + this->epsilon) / (predict + this->epsilon))
-                        .log()).mean()).coeff();
+                        .log()).mean();
+        return loss.coeff();
     }
 
 
@@ -49,8 +51,11 @@ public:
 
         auto zero = static_cast<Scalar>(0.0);
 
-        return (predict != zero).select(-label / (predict), predict.constant(zero)) /
-               static_cast<Scalar>(predict.size());
+        Tensor<TensorRank> gradients(predict.dimensions());
+        gradients.device(this->device) =
+                (predict != zero).select(-label / (predict), predict.constant(zero)) /
+                static_cast<Scalar>(predict.size());
+        return gradients;
     }
 };
 
@@ -9,6 +9,7 @@
 
 #include "flare/fl_types.hpp"
 #include "flare/fl_assert.hpp"
+#include "flare/execution_context.hpp"
 
 namespace fl
 {
@@ -37,6 +38,7 @@ public:
         this->epsilon = copy.epsilon;
         this->loss = copy.loss;
         this->gradients = copy.gradients;
+        this->device = copy.device;
     }
 
 
@@ -72,6 +74,17 @@ public:
     }
 
 
+    /**
+     * Evaluate the loss and its gradients on the context's thread pool
+     *
+     * @param context   execution context shared by the model
+     */
+    void SetExecutionContext(ExecutionContext &context)
+    {
+        this->device = context.GetDevice();
+    }
+
+
 protected:
     Scalar epsilon = 1e-07; // numeric stability constant
     Scalar clip_min = epsilon;
@@ -79,6 +92,8 @@ protected:
 
     Scalar loss;
     Tensor<TensorRank> gradients;
+
+    Device device = ExecutionContext::Default().GetDevice();
 };
 
 }
@@ -33,7 +33,9 @@ public:
                                            " don't match label dimensions "
                                            << label.dimensions());
 
-        return Tensor<0>((label - predict).abs().mean()).coeff();
+        Tensor<0> loss;
+        loss.device(this->device) = (label - predict).abs().mean();
+        return loss.coeff();
     }
 
 
@@ -45,13 +47,16 @@ public:
                                            " don't match label dimensions "
                                            << label.dimensions());
 
-        return (predict != label)
-                       .select((predict > label)
-                                       .select(predict.constant(1),
-                                               predict.constant(-1)),
-                               predict.constant(0)) /
-               static_cast<Scalar>(predict.dimensions().TotalSize() /
-                                   predict.dimension(0));
+        Tensor<TensorRank> gradients(predict.dimensions());
+        gradients.device(this->device) =
+                (predict != label)
+                        .select((predict > label)
+                                        .select(predict.constant(1),
+                                                predict.constant(-1)),
+                                predict.constant(0)) /
+                static_cast<Scalar>(predict.dimensions().TotalSize() /
+                                    predict.dimension(0));
+        return gradients;
     }
 };
 
@@ -32,7 +32,9 @@ public:
                   "predict dimensions " << predict.dimensions() <<
                                            " don't match label dimensions " <<
                                            label.dimensions());
-        return Tensor<0>((label - predict).square().mean())(0);
+        Tensor<0> loss;
+        loss.device(this->device) = (label - predict).square().mean();
+        return loss.coeff();
     }
 
 
@@ -43,7 +45,10 @@ public:
                   "predict dimensions " << predict.dimensions() <<
                                            " don't match label dimensions "
                                            << label.dimensions());
-        return 2 * (predict - label) / static_cast<Scalar>(predict.size());
+        Tensor<TensorRank> gradients(predict.dimensions());
+        gradients.device(this->device) =
+                2 * (predict - label) / static_cast<Scalar>(predict.size());
+        return gradients;
     }
 };
 
@@ -0,0 +1,158 @@
+//
+// Created by R on 10/17/26.
+//
+
+#ifndef FLARE_MAPPED_FILE_HPP
+#define FLARE_MAPPED_FILE_HPP
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+
+#if defined __unix__ || defined __APPLE__ || defined __linux__
+#define FLARE_USE_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace fl
+{
+
+/**
+ * Read-only view of a whole file. The file is memory mapped where mmap is
+ * available so pages are loaded on demand and shared with other processes
+ * through the page cache, elsewhere it is read into memory
+ */
+class MappedFile
+{
+public:
+    explicit MappedFile(const std::string &path)
+    {
+#ifdef FLARE_USE_MMAP
+        int fd = open(path.c_str(), O_RDONLY);
+        struct stat file_stat {};
+
+        if (fd < 0 || fstat(fd, &file_stat) < 0) {
+            std::string error = std::strerror(errno);
+
+            if (fd >= 0) {
+                close(fd);
+            }
+
+            throw std::invalid_argument("MappedFile UNABLE TO OPEN " + path + ": " +
+                                        error);
+        }
+
+        this->length = static_cast<size_t>(file_stat.st_size);
+
+        if (this->length > 0) {
+            void *address = mmap(nullptr, this->length, PROT_READ, MAP_SHARED, fd, 0);
+
+            if (address == MAP_FAILED) {
+                std::string error = std::strerror(errno);
+                close(fd);
+                throw std::invalid_argument("MappedFile UNABLE TO MAP " + path +
+                                            ": " + error);
+            }
+
+            this->address = static_cast<const char *>(address);
+        }
+
+        close(fd); // the mapping stays valid
+#else
+        std::ifstream file(path, std::ios::binary);
+
+        if (!file.is_open()) {
+            throw std::invalid_argument("MappedFile UNABLE TO OPEN " + path);
+        }
+
+        this->contents.assign(std::istreambuf_iterator<char>(file),
+                              std::istreambuf_iterator<char>());
+        this->address = this->contents.data();
+        this->length = this->contents.size();
+#endif
+    }
+
+
+    MappedFile(const MappedFile &) = delete;
+
+    MappedFile &operator=(const MappedFile &) = delete;
+
+
+    ~MappedFile()
+    {
+#ifdef FLARE_USE_MMAP
+        if (this->address != nullptr) {
+            munmap(const_cast<char *>(this->address), this->length);
+        }
+#endif
+    }
+
+
+    const char *data() const
+    {
+        return this->address;
+    }
+
+
+    size_t size() const
+    {
+        return this->length;
+    }
+
+
+    /**
+     * Hint that [offset, offset + count) will be read front to back soon
+     */
+    void WillNeed(size_t offset, size_t count) const
+    {
+#ifdef FLARE_USE_MMAP
+        this->Advise(offset, count, MADV_WILLNEED);
+#endif
+    }
+
+
+    /**
+     * Hint that [offset, offset + count) won't be read again, lets the kernel
+     * drop the pages so streaming a file larger than memory doesn't evict
+     * everything else
+     */
+    void DontNeed(size_t offset, size_t count) const
+    {
+#ifdef FLARE_USE_MMAP
+        this->Advise(offset, count, MADV_DONTNEED);
+#endif
+    }
+
+private:
+#ifdef FLARE_USE_MMAP
+    void Advise(size_t offset, size_t count, int advice) const
+    {
+        // madvise needs a page aligned start, round down and extend the range
+        const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        const size_t start = offset / page * page;
+
+        if (this->address != nullptr && start < this->length) {
+            madvise(const_cast<char *>(this->address) + start,
+                    std::min(count + offset - start, this->length - start), advice);
+        }
+    }
+#endif
+
+
+    const char *address = nullptr;
+    size_t length = 0;
+#ifndef FLARE_USE_MMAP
+    std::string contents;
+#endif
+};
+
+} // namespace fl
+
+#endif //FLARE_MAPPED_FILE_HPP
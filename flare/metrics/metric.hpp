@@ -7,6 +7,7 @@
 
 #include "flare/fl_types.hpp"
 #include "flare/fl_assert.hpp"
+#include "flare/execution_context.hpp"
 
 namespace fl
 {
@@ -23,6 +24,17 @@ public:
     virtual void Reset() = 0;
 
 
+    /**
+     * Evaluate the metric on the context's thread pool
+     *
+     * @param context   execution context shared by the model
+     */
+    void SetExecutionContext(ExecutionContext &context)
+    {
+        this->device = context.GetDevice();
+    }
+
+
     friend std::ostream &operator<<(std::ostream &out,
                                     const Metric<TensorRank> &metric)
     {
@@ -32,8 +44,7 @@ public:
     std::string name = "metric";
 
 protected:
-    Eigen::ThreadPoolDevice device = Eigen::ThreadPoolDevice(new Eigen::ThreadPool(
-            (int) std::thread::hardware_concurrency()), 2);
+    Device device = ExecutionContext::Default().GetDevice();
 };
 
 } // namespace fl
@@ -37,6 +37,24 @@ public:
     }
 
 
+    void Reset() override
+    {
+        this->beta1_t = this->beta1;
+        this->beta2_t = this->beta2;
+        this->lr_t = this->learning_rate * std::sqrt(1 - this->beta2_t) /
+                     (1 - this->beta1_t);
+
+        this->momentum_db.clear();
+        this->rmsprop_db.clear();
+        this->momentum_dw.clear();
+        this->rmsprop_dw.clear();
+        this->momentum_dw3.clear();
+        this->rmsprop_dw3.clear();
+        this->momentum_dk.clear();
+        this->rmsprop_dk.clear();
+    }
+
+
     void Minimize(Tensor<1> &weights, const Tensor<1> &gradients) override
     {
         Tensor<1> &momentum = this->momentum_db[weights.data()];
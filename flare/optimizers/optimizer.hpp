@@ -6,6 +6,7 @@
 #define FLARE_OPTIMIZER_HPP
 
 #include "flare/fl_types.hpp"
+#include "flare/execution_context.hpp"
 #include <map>
 
 
@@ -33,14 +34,32 @@ public:
     virtual void Minimize(Tensor<4> &W, const Tensor<4> &dL_dW) = 0;
 
 
+    /**
+     * Forget the state kept per parameter tensor, e.g. momentum or Adam's
+     * moving averages, freeing it. The next Minimize starts from scratch
+     */
+    virtual void Reset()
+    {}
+
+
     Scalar GetLearningRate() const
     { return this->learning_rate; };
 
+
+    /**
+     * Evaluate parameter updates on the context's thread pool
+     *
+     * @param context   execution context shared by the model
+     */
+    void SetExecutionContext(ExecutionContext &context)
+    {
+        this->device = context.GetDevice();
+    }
+
 protected:
     Scalar learning_rate;
 
-    Eigen::ThreadPoolDevice device = Eigen::ThreadPoolDevice(new Eigen::ThreadPool(
-            (int) std::thread::hardware_concurrency()), 2);
+    Device device = ExecutionContext::Default().GetDevice();
 };
 
 } // namespace fl
@@ -20,6 +20,15 @@ public:
     }
 
 
+    void Reset() override
+    {
+        this->s_db.clear();
+        this->s_dw.clear();
+        this->s_dw3.clear();
+        this->s_dk.clear();
+    }
+
+
     void Minimize(Tensor<1> &weights, const Tensor<1> &gradients) override
     {
         this->Update(weights, gradients, this->s_db[weights.data()]);
@@ -24,6 +24,15 @@ public:
     ~SGD() = default;
 
 
+    void Reset() override
+    {
+        this->v_db.clear();
+        this->v_dw.clear();
+        this->v_dy.clear();
+        this->v_dk.clear();
+    }
+
+
     void Minimize(Tensor<1> &weights, const Tensor<1> &gradients) override
     {
         Tensor<1> &velocity = this->v_db[weights.data()];
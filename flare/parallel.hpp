@@ -0,0 +1,118 @@
+//
+// Created by R on 10/17/26.
+//
+
+#ifndef FLARE_PARALLEL_HPP
+#define FLARE_PARALLEL_HPP
+
+#include "flare/fl_types.hpp"
+#include "flare/execution_context.hpp"
+#include <algorithm>
+#include <array>
+#include <vector>
+
+namespace fl
+{
+
+/**
+ * Calls f(i) for every i in [0, n) split across the device's threads, so hand
+ * written loops share the scheduler that evaluates the tensor expressions
+ * around them instead of starting a second thread team
+ *
+ * Iterations may run in any order and concurrently, each must write to memory
+ * no other iteration touches. f should evaluate tensor expressions without
+ * .device(), the loop is already running on the pool
+ *
+ * Define FLARE_USE_OPENMP (and compile with -fopenmp) to run the loop with
+ * OpenMP instead, limited to the device's thread count. Without threads the
+ * loop runs serially on the calling thread
+ *
+ * @param device   device whose thread pool runs the loop
+ * @param n        number of iterations
+ * @param cost     estimated cost of one iteration in scalar operations, small
+ *                 loops run on fewer threads
+ * @param f        loop body, void(Eigen::Index i)
+ */
+template<typename Function>
+void ParallelFor(const Device &device, Eigen::Index n, double cost, Function &&f)
+{
+#if defined(FLARE_USE_OPENMP) && defined(_OPENMP)
+#ifndef FLARE_DO_NOT_USE_THREADS
+#pragma omp parallel for num_threads(device.numThreads()) schedule(static)
+#else
+#pragma omp parallel for schedule(static)
+#endif
+    for (Eigen::Index i = 0; i < n; i++) {
+        f(i);
+    }
+#elif !defined(FLARE_DO_NOT_USE_THREADS)
+    device.parallelFor(n, Eigen::TensorOpCost(0, 0, cost),
+                       [&f](Eigen::Index first, Eigen::Index last) {
+                           for (Eigen::Index i = first; i < last; i++) {
+                               f(i);
+                           }
+                       });
+#else
+    for (Eigen::Index i = 0; i < n; i++) {
+        f(i);
+    }
+#endif
+}
+
+
+/**
+ * Copy a tensor into one of the same dimensions split across the device's
+ * threads. Assigning a tensor with .device() goes through
+ * ThreadPoolDevice::memcpy, which hands large copies to up to 4 pool threads
+ * whatever the device's thread count and allocates a task for each
+ *
+ * @param device        device whose threads copy
+ * @param source        tensor to copy
+ * @param destination   tensor already sized like source, may be source
+ */
+template<int TensorRank>
+void ParallelCopy(const Device &device, const Tensor<TensorRank> &source,
+                  Tensor<TensorRank> &destination)
+{
+    constexpr Eigen::Index block = 16384;
+    const Eigen::Index size = source.size();
+    const Scalar *from = source.data();
+    Scalar *to = destination.data();
+
+    if (from == to) {
+        return;
+    }
+
+    ParallelFor(device, (size + block - 1) / block, block, [&](Eigen::Index i) {
+        std::copy_n(from + i * block, std::min(block, size - i * block), to + i * block);
+    });
+}
+
+
+/**
+ * Scratch buffer of the calling thread for the body of a ParallelFor, at least
+ * size scalars. The buffers only grow, after the first call with the largest
+ * size a loop asks for no iteration allocates
+ *
+ * Each slot is one buffer, a body that needs several at once takes one slot
+ * each. The contents are only valid until the thread's next call asking for
+ * the same slot, so a body must not call into code that uses scratch itself
+ *
+ * @param size   number of scalars needed
+ * @param slot   which of the thread's buffers, in [0, 2)
+ */
+inline Scalar *ThreadScratch(Eigen::Index size, int slot = 0)
+{
+    thread_local std::array<std::vector<Scalar>, 2> buffers;
+    std::vector<Scalar> &buffer = buffers[slot];
+
+    if (static_cast<Eigen::Index>(buffer.size()) < size) {
+        buffer.resize(size);
+    }
+
+    return buffer.data();
+}
+
+} // namespace fl
+
+#endif //FLARE_PARALLEL_HPP
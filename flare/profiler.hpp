@@ -0,0 +1,252 @@
+//
+// Created by R on 10/17/26.
+//
+
+#ifndef FLARE_PROFILER_HPP
+#define FLARE_PROFILER_HPP
+
+#include "flare/layers/layer.hpp"
+#include "flare/timeline.hpp"
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace fl
+{
+
+/**
+ * Per-layer timings and tensor memory of a Sequential model, filled in by the
+ * model once profiling is enabled:
+ *
+ *     model.EnableProfiling();
+ *     model.Fit(inputs, labels, epochs, loss, opt);
+ *     model.GetProfiler()->Summary();
+ *     model.GetProfiler()->WriteChromeTrace("trace.json"); // chrome://tracing
+ *
+ * Times of a layer's Backward exclude the time the next layer spent computing
+ * the input gradients handed to it, those are reported on their own
+ *
+ * The trace is recorded on a Timeline, Fit adds its data loading, loss,
+ * optimizer step, metrics and progress bar spans to it
+ */
+class Profiler
+{
+public:
+    using Clock = Timeline::Clock;
+
+    enum Phase
+    {
+        FORWARD, BACKWARD, INPUT_GRADIENTS, UPDATE, PHASE_COUNT
+    };
+
+
+    /**
+     * @param events_per_thread   latest events of each thread kept for the
+     *                            trace, all events count towards the summary
+     */
+    explicit Profiler(size_t events_per_thread = 1 << 16)
+            : timeline(events_per_thread)
+    {
+        // nothing to do
+    }
+
+
+    static const char *PhaseName(Phase phase)
+    {
+        static const char *names[] = {"Forward", "Backward", "InputGradients", "Update"};
+        return names[phase];
+    }
+
+
+    /**
+     * Record a call of layer index, safe to call from several threads
+     *
+     * @param exclude_seconds   time spent in nested calls of other layers, not
+     *                          counted towards this call in the summary
+     */
+    void Record(const Layer &layer, int index, Phase phase, Clock::time_point start,
+                Clock::time_point end, double exclude_seconds = 0)
+    {
+        int trace_name;
+
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            LayerStats &stats = this->Stats(layer, index);
+            stats.calls[phase]++;
+            stats.seconds[phase] += std::chrono::duration<double>(end - start).count() -
+                                    exclude_seconds;
+            trace_name = stats.trace_names[phase];
+        }
+
+        this->timeline.Record(trace_name, Profiler::PhaseName(phase), start, end);
+    }
+
+
+    /**
+     * Record the bytes currently held by layer index's tensors
+     */
+    void SampleMemory(const Layer &layer, int index)
+    {
+        const size_t bytes = layer.GetTensorBytes();
+        int trace_name;
+
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            LayerStats &stats = this->Stats(layer, index);
+
+            if (bytes == stats.bytes) {
+                return;
+            }
+
+            stats.bytes = bytes;
+            stats.peak_bytes = std::max(stats.peak_bytes, bytes);
+            trace_name = stats.memory_name;
+        }
+
+        this->timeline.Counter(trace_name, Clock::now(), static_cast<double>(bytes));
+    }
+
+
+    /**
+     * @return   the timeline the calls are traced on
+     */
+    Timeline &GetTimeline()
+    {
+        return this->timeline;
+    }
+
+
+    /**
+     * Print one row per layer: mean milliseconds per call of each phase, share
+     * of the total time and the peak bytes held by the layer's tensors
+     */
+    void Summary(std::ostream &stream = std::cout) const
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+
+        double total = 0;
+        size_t peak_bytes = 0;
+
+        for (const LayerStats &stats: this->layers) {
+            for (int p = 0; p < PHASE_COUNT; p++) {
+                total += stats.seconds[p];
+            }
+
+            peak_bytes += stats.peak_bytes;
+        }
+
+        auto mean_ms = [](const LayerStats &stats, int phase) {
+            return stats.calls[phase] > 0
+                   ? stats.seconds[phase] * 1e3 / stats.calls[phase] : 0.0;
+        };
+
+        std::ios state(nullptr);
+        state.copyfmt(stream);
+        stream << std::setfill(' ');
+
+        stream << std::left << std::setw(32) << "layer" << std::right
+               << std::setw(12) << "forward ms" << std::setw(12) << "backward ms"
+               << std::setw(12) << "in grad ms" << std::setw(12) << "update ms"
+               << std::setw(12) << "total s" << std::setw(8) << "%"
+               << std::setw(14) << "peak MB" << "\n";
+
+        stream << std::fixed;
+
+        for (const LayerStats &stats: this->layers) {
+            double layer_total = 0;
+
+            for (int p = 0; p < PHASE_COUNT; p++) {
+                layer_total += stats.seconds[p];
+            }
+
+            stream << std::left << std::setw(32) << stats.name << std::right
+                   << std::setprecision(3)
+                   << std::setw(12) << mean_ms(stats, FORWARD)
+                   << std::setw(12) << mean_ms(stats, BACKWARD)
+                   << std::setw(12) << mean_ms(stats, INPUT_GRADIENTS)
+                   << std::setw(12) << mean_ms(stats, UPDATE)
+                   << std::setw(12) << layer_total
+                   << std::setprecision(1)
+                   << std::setw(8) << (total > 0 ? 100 * layer_total / total : 0.0)
+                   << std::setprecision(2)
+                   << std::setw(14) << stats.peak_bytes / 1e6 << "\n";
+        }
+
+        stream << std::left << std::setw(32) << "total" << std::right
+               << std::setw(48) << "" << std::setprecision(3) << std::setw(12) << total
+               << std::setw(8) << "" << std::setprecision(2) << std::setw(14)
+               << peak_bytes / 1e6 << "\n";
+
+        stream.copyfmt(state);
+    }
+
+
+    /**
+     * Write the timeline in the Chrome trace event format, viewable in
+     * chrome://tracing or Perfetto. Memory samples are counter tracks
+     */
+    void WriteChromeTrace(const std::string &path) const
+    {
+        this->timeline.WriteChromeTrace(path);
+    }
+
+
+    /**
+     * Discard everything recorded so far, e.g. the warm-up epoch
+     */
+    void Reset()
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->layers.clear();
+        this->timeline.Reset();
+    }
+
+private:
+    struct LayerStats
+    {
+        std::string name;
+        long calls[PHASE_COUNT] = {};
+        double seconds[PHASE_COUNT] = {};
+        size_t bytes = 0;
+        size_t peak_bytes = 0;
+        int trace_names[PHASE_COUNT] = {};
+        int memory_name = 0;
+    };
+
+
+    // called with the mutex held
+    LayerStats &Stats(const Layer &layer, int index)
+    {
+        if (index >= static_cast<int>(this->layers.size())) {
+            this->layers.resize(index + 1);
+        }
+
+        LayerStats &stats = this->layers[index];
+
+        if (stats.name.empty()) {
+            stats.name = layer.name;
+
+            for (int p = 0; p < PHASE_COUNT; p++) {
+                stats.trace_names[p] = this->timeline.Name(
+                        layer.name + " " + Profiler::PhaseName(static_cast<Phase>(p)));
+            }
+
+            stats.memory_name = this->timeline.Name(layer.name + " tensor bytes");
+        }
+
+        return stats;
+    }
+
+
+    Timeline timeline;
+    mutable std::mutex mutex;
+    std::vector<LayerStats> layers;
+};
+
+} // namespace fl
+
+#endif //FLARE_PROFILER_HPP
@@ -6,10 +6,16 @@
 #define FLARE_SEQUENTIAL_HPP
 
 #include "flare/fl_types.hpp"
+#include "flare/execution_context.hpp"
+#include "flare/data_loader.hpp"
 #include "flare/layers/layer.hpp"
+#include "flare/profiler.hpp"
 #include "flare/loss/include_loss.hpp"
 #include "flare/optimizers/include_optimizers.hpp"
+#include <chrono>
 #include <iomanip>
+#include <iterator>
+#include <memory>
 
 namespace fl
 {
@@ -17,10 +23,18 @@ namespace fl
 class Sequential
 {
 public:
-    Sequential(std::initializer_list<Layer *> layers) : layers(layers)
+    /**
+     * @param layers    model layers in order of forward propagation
+     * @param context   thread pool shared by the layers, loss, optimizer and
+     *                  metrics, defaults to the process-wide context
+     */
+    Sequential(std::initializer_list<Layer *> layers,
+               ExecutionContext &context = ExecutionContext::Default())
+            : layers(layers), context(&context)
     {
         for (int i = 0; i < this->layers.size(); i++) {
             this->layers[i]->name += "_" + std::to_string(i);
+            this->layers[i]->SetExecutionContext(context);
         }
     }
 
@@ -28,13 +42,186 @@ public:
     Sequential() = default;
 
 
+    explicit Sequential(ExecutionContext &context) : context(&context)
+    {
+        // nothing to do
+    }
+
+
     void Add(Layer *layer)
     {
         layer->name += "_" + std::to_string(this->layers.size());
+        layer->SetExecutionContext(*this->context);
+        layer->Freeze(this->frozen);
+        layer->SetInferenceOnly(this->frozen);
+        layer->SetCheckpointing(this->checkpoint_segment);
         this->layers.push_back(layer);
     }
 
 
+    /**
+     * Move the model's layers onto another execution context, the loss,
+     * optimizer and metrics follow when passed to Fit
+     *
+     * @param context   execution context to run tensor operations on
+     */
+    void SetExecutionContext(ExecutionContext &context)
+    {
+        this->context = &context;
+
+        for (Layer *layer: this->layers) {
+            layer->SetExecutionContext(context);
+        }
+    }
+
+
+    ExecutionContext &GetExecutionContext()
+    {
+        return *this->context;
+    }
+
+
+    /**
+     * Give the model its own execution context so several models on one host
+     * don't compete for the same threads, e.g. a model capped to 4 threads on
+     * NUMA node 1: model.SetThreads(4, ExecutionContext::NumaNodeCpus(1))
+     *
+     * Replaces the context of any previous SetThreads call, a loss, optimizer or
+     * metric used outside of Fit must be given the new context again
+     *
+     * @param threads   maximum number of worker threads for the model
+     * @param cpus      CPU ids to pin the worker threads to, empty to not pin
+     */
+    void SetThreads(int threads, const std::vector<int> &cpus = {})
+    {
+        auto new_context = std::make_unique<ExecutionContext>(threads, cpus);
+        this->SetExecutionContext(*new_context);
+        this->owned_context = std::move(new_context);
+    }
+
+
+    /**
+     * Train with data parallelism, Fit splits every batch along its first
+     * dimension across copies of the model that run Forward and Backward
+     * concurrently. The loss is evaluated once on the whole batch, the copies'
+     * weight gradients are summed into this model and the optimizer runs once
+     * per batch
+     *
+     * Meant for small models where a single batch can't keep many cores busy.
+     * Batch statistics, e.g. of BatchNormalization, are computed per shard and
+     * only this model's running statistics are kept
+     *
+     * @param replicas              number of shards per batch, 1 to disable
+     * @param threads_per_replica   worker threads of each additional copy, this
+     *                              model's shard runs on its own context
+     */
+    void SetDataParallel(int replicas, int threads_per_replica = 1)
+    {
+        if (replicas < 1 || threads_per_replica < 1) {
+            throw std::invalid_argument(
+                    "Sequential::SetDataParallel REPLICAS AND THREADS MUST BE POSITIVE");
+        }
+
+        this->data_parallel = replicas;
+        this->threads_per_replica = threads_per_replica;
+    }
+
+
+    /**
+     * Let BackwardAndUpdate start each layer's weight update as soon as the
+     * backward pass no longer needs the layer's weights, so the updates run on
+     * a worker thread while the earlier layers are still propagating
+     *
+     * Updates run one at a time, the optimizer is never called concurrently
+     *
+     * @param overlapped   true to overlap updates with the backward pass
+     */
+    void SetOverlappedUpdate(bool overlapped)
+    {
+        this->overlapped_update = overlapped;
+
+#ifndef FLARE_DO_NOT_USE_THREADS
+        if (overlapped && !this->update_pool) {
+            this->update_pool = std::make_unique<Eigen::ThreadPool>(1);
+        }
+        else if (!overlapped) {
+            this->update_pool.reset();
+        }
+#endif
+    }
+
+
+    /**
+     * Plan the layer inputs so every layer after the first references the
+     * previous layer's output instead of keeping a copy of it for Backward.
+     * Enabled by default, roughly halves the activation memory of conv nets
+     *
+     * @param planned   false to have every layer copy its input
+     */
+    void SetMemoryPlanning(bool planned)
+    {
+        this->memory_planning = planned;
+        this->PlanMemory();
+    }
+
+
+    /**
+     * Trade compute for memory in the recurrent and attention layers, Forward
+     * drops the per-time-step cells and attention maps and Backward recomputes
+     * them. RNNs recompute segment time steps at a time, so only one segment
+     * of cells is alive during Backward. Layers without such state ignore it
+     *
+     * @param segment   time steps recomputed together, 0 to disable
+     */
+    void SetCheckpointing(Eigen::Index segment)
+    {
+        if (segment < 0) {
+            throw std::invalid_argument(
+                    "Sequential::SetCheckpointing SEGMENT MUST BE NON NEGATIVE");
+        }
+
+        this->checkpoint_segment = segment;
+
+        for (Layer *layer: this->layers) {
+            layer->SetCheckpointing(segment);
+        }
+    }
+
+
+    /**
+     * Time every layer's Forward, Backward, input gradients and Update, and
+     * sample the bytes held by its tensors after each call. Fit also traces its
+     * batch loading, loss, optimizer step, metrics and progress bar on the
+     * profiler's timeline. When disabled nothing is timed
+     *
+     * @param enabled   true to start a new profile, false to discard it
+     */
+    void EnableProfiling(bool enabled = true)
+    {
+        this->profiler = enabled ? std::make_unique<Profiler>() : nullptr;
+
+        if (this->profiler) {
+            Timeline &timeline = this->profiler->GetTimeline();
+            this->trace_names = {timeline.Name("load batch"), timeline.Name("loss"),
+                                 timeline.Name("optimizer step"),
+                                 timeline.Name("metrics"),
+                                 timeline.Name("progress bar"),
+                                 timeline.Name("shard forward"),
+                                 timeline.Name("shard backward")};
+        }
+    }
+
+
+    /**
+     * @return   the profile of the calls since EnableProfiling, nullptr if
+     *           profiling is disabled
+     */
+    Profiler *GetProfiler()
+    {
+        return this->profiler.get();
+    }
+
+
     void ValidateLayers()
     {
         if (this->layers.empty()) {
@@ -74,84 +261,87 @@ public:
             throw std::invalid_argument("inputs should match labels 1:1");
         }
 
-        this->ValidateLayers();
+        this->FitBatches(inputs.size(), epochs, [&inputs, &labels](int m) {
+            return std::pair<const Tensor<TensorSampleRank> &,
+                             const Tensor<TensorLabelRank> &>(inputs[m], labels[m]);
+        }, loss_function, opt, metrics);
+    }
 
-        // to display progress bar
-        const int num_batches = inputs.size();
-        const int num_bars = 25;
-        int batch_per_bar = num_batches / num_bars;
-        int progress = 0;
-        const int num_inputs = inputs.size();
-        const int epoch_count_length = std::to_string(epochs).length();
 
-        for (auto layer: this->layers) {
-            layer->Training(true);
-        }
+    /**
+     * Train on batches produced in the background by a DataLoader, the loader
+     * prepares the next batches while the current one trains
+     *
+     * @param loader   source of the batches, consumed in order
+     */
+    template<int SampleRank, int LabelRank>
+    void Fit(DataLoader<SampleRank, LabelRank> &loader, int epochs,
+             LossFunction <LabelRank + 1> &loss_function, Optimizer &opt,
+             const std::vector<fl::Metric<LabelRank + 1> *> &metrics = {})
+    {
+        this->FitBatches(loader.Batches(), epochs, [&loader](int) {
+            return loader.Next();
+        }, loss_function, opt, metrics);
+    }
 
-        for (int e = 0; e < epochs; e++) {
-            auto start_time = std::chrono::high_resolution_clock::now();
 
-            for (int m = 0; m < num_inputs; m++) {
-                this->Forward(inputs[m]);
-                this->Backward(labels[m], loss_function);
-                this->Update(opt);
+    Layer &operator[](int layer_index)
+    {
+        return *this->layers[layer_index];
+    }
 
-                for (auto metric: metrics) {
-                    if constexpr(TensorLabelRank == 2) {
-                        (*metric)(this->layers.back()->GetOutput2D(), labels[m]);
-                    }
-                    else if constexpr(TensorLabelRank == 3) {
-                        (*metric)(this->layers.back()->GetOutput3D(), labels[m]);
-                    }
-                    else {
-                        (*metric)(this->layers.back()->GetOutput4D(), labels[m]);
-                    }
-                }
 
-                // progress bar
-                // on Mac terminal, \r carriage return may be ignored if the line
-                // exceeds the default terminal width
-                if (m % batch_per_bar == 0 && m != 0) {
-                    auto elapsed_time = std::chrono::duration_cast<std::chrono::seconds>(
-                            std::chrono::high_resolution_clock::now() - start_time);
+    /**
+     * Prepare the model for inference with fixed weights, each layer packs its
+     * weights once and Predict multiplies with the packed copy instead of
+     * repacking them in every contraction. The layers also free everything
+     * only training reads, gradients, kept inputs and cached intermediates,
+     * so a frozen model holds its weights and one output per layer, and
+     * the context's arena gives back the blocks of training temporaries.
+     * Fit throws until Unfreeze. Optimizer state lives in the optimizer,
+     * Optimizer::Reset drops it
+     *
+     * A batch normalization and activation following a convolution are
+     * folded into it, see FoldLayers, and Forward skips them
+     */
+    void Freeze()
+    {
+        this->Training(false);
 
-                    // some terminals, like putty, will print each as a new line
-                    std::cout << "Epoch "
-                              << std::setw(epoch_count_length) << std::setfill(' ')
-                              << e + 1 << " ["
-                              << std::setw(progress) << std::setfill('=') << ""
-                              << std::setw(num_bars - progress)
-                              << std::setfill('.') << "" << "] "
-                              << elapsed_time.count() << "s loss: "
-                              << std::setprecision(4) << std::fixed
-                              << loss_function.GetLoss();
+        for (Layer *layer: this->layers) {
+            layer->SetInferenceOnly(true);
+        }
 
-                    for (auto metric: metrics) {
-                        std::cout << ", " << *metric;
-                    }
+        this->FoldLayers();
 
-                    std::cout << std::flush << '\r';
-                    progress++;
-                }
-            }
+        for (Layer *layer: this->layers) {
+            layer->Freeze(true);
+        }
 
-            progress = 0; // progress bar reset for next epoch
-            std::cout << '\n';
+        this->context->GetArena().Release();
+        this->frozen = true;
+    }
 
-            for (auto metric: metrics) {
-                metric->Reset();
-            }
-        }
 
-        for (auto layer: this->layers) {
-            layer->Training(false);
+    // drop the packed weights of Freeze, layers go back to their GemmBackend
+    // and size their training buffers again
+    void Unfreeze()
+    {
+        this->folded_layers.clear();
+
+        for (Layer *layer: this->layers) {
+            layer->Unfold();
+            layer->Freeze(false);
+            layer->SetInferenceOnly(false);
         }
+
+        this->frozen = false;
     }
 
 
-    Layer &operator[](int layer_index)
+    bool IsFrozen() const
     {
-        return *this->layers[layer_index];
+        return this->frozen;
     }
 
 
@@ -161,26 +351,22 @@ public:
     {
         this->Training(training_mode);
         this->Forward(input);
-
-        if constexpr (OutputRank == 2) {
-            return this->layers.back()->GetOutput2D();
-        }
-        else if constexpr (OutputRank == 3) {
-            return this->layers.back()->GetOutput3D();
-        }
-        else {
-            return this->layers.back()->GetOutput4D();
-        }
+        return this->GetOutput<OutputRank>();
     }
 
 
+    // folded layers are skipped, the next layer reads the layer they were folded into
     template<int TensorSampleRank>
     void Forward(const Tensor <TensorSampleRank> &training_sample)
     {
-        this->layers.front()->Forward(training_sample);
+        this->PlanMemory();
+        this->ForwardLayer(0, training_sample);
 
-        for (size_t i = 1; i < this->layers.size(); i++) {
-            this->layers[i]->Forward(*this->layers[i - 1]);
+        for (size_t i = 1, prev = 0; i < this->layers.size(); i++) {
+            if (!this->Folded(i)) {
+                this->ForwardLayer(i, *this->layers[prev]);
+                prev = i;
+            }
         }
     }
 
@@ -203,34 +389,90 @@ public:
                                    std::to_string(TensorLabelRank));
         }
 
-        this->layers.back()->Backward(loss_function.GetGradients());
+        this->Backward(loss_function.GetGradients());
+    }
+
+
+    template<int TensorLabelRank>
+    void Backward(const Tensor <TensorLabelRank> &gradients)
+    {
+        this->BackwardLayer(this->layers.size() - 1, gradients);
 
         for (int i = this->layers.size() - 2; i >= 0; --i) {
-            this->layers[i]->Backward(*this->layers[i + 1]);
+            this->BackwardLayer(i);
         }
     }
 
 
+    /**
+     * Backward followed by Update. With SetOverlappedUpdate(true), layer i is
+     * updated once layer i - 1 has consumed its input gradients, concurrently
+     * with the backward pass of the layers before it
+     */
     template<int TensorLabelRank>
-    void Backward(const Tensor <TensorLabelRank> &gradients)
+    void BackwardAndUpdate(const Tensor <TensorLabelRank> &training_label,
+                           LossFunction <TensorLabelRank> &loss_function,
+                           Optimizer &optimizer)
     {
-        this->layers.back()->Backward(gradients);
+        Timeline::Scope scope(this->Trace(), this->trace_names.loss, "loss");
+        loss_function(this->GetOutput<TensorLabelRank>(), training_label);
+        scope.End();
+
+        this->BackwardAndUpdate(loss_function.GetGradients(), optimizer);
+    }
+
+
+    template<int TensorLabelRank>
+    void BackwardAndUpdate(const Tensor <TensorLabelRank> &gradients,
+                           Optimizer &optimizer)
+    {
+        if (!this->overlapped_update) {
+            this->Backward(gradients);
+            this->Update(optimizer);
+            return;
+        }
+
+#ifndef FLARE_DO_NOT_USE_THREADS
+        Eigen::Barrier barrier(static_cast<unsigned int>(this->layers.size()));
+
+        auto schedule_update = [this, &barrier, &optimizer](int i) {
+            this->update_pool->Schedule([this, i, &barrier, &optimizer]() {
+                this->UpdateLayer(i, optimizer);
+                barrier.Notify();
+            });
+        };
+
+        this->BackwardLayer(this->layers.size() - 1, gradients);
 
         for (int i = this->layers.size() - 2; i >= 0; --i) {
-            this->layers[i]->Backward(*this->layers[i + 1]);
+            this->BackwardLayer(i);
+
+            // layer i + 1's weights were last read by layer i's Backward
+            schedule_update(i + 1);
         }
+
+        schedule_update(0);
+        barrier.Wait();
+
+        Timeline::Scope scope(this->Trace(), this->trace_names.step, "optimizer");
+        optimizer.Step();
+#else
+        this->Backward(gradients);
+        this->Update(optimizer);
+#endif
     }
 
 
     void Update(Optimizer &optimizer)
     {
-        for (Layer *layer: this->layers) {
+        for (size_t i = 0; i < this->layers.size(); i++) {
             // update each layer's learnable parameters
-            layer->Update(optimizer);
+            this->UpdateLayer(i, optimizer);
         }
 
         // let the optimizer know to move to the next iteration t
         // since some optimizers need to update their internal parameters
+        Timeline::Scope scope(this->Trace(), this->trace_names.step, "optimizer");
         optimizer.Step();
     }
 
@@ -339,6 +581,585 @@ public:
 
     std::vector<Layer *> layers;
 
+private:
+    // training loop shared by the Fit overloads, get_batch(m) returns the
+    // input and label tensors of batch m of the epoch
+    template<int TensorLabelRank, typename GetBatch>
+    void FitBatches(int num_batches, int epochs, GetBatch &&get_batch,
+                    LossFunction <TensorLabelRank> &loss_function, Optimizer &opt,
+                    const std::vector<fl::Metric<TensorLabelRank> *> &metrics)
+    {
+        this->ValidateLayers();
+
+        if (this->frozen) {
+            throw std::logic_error("Sequential::Fit MODEL IS FROZEN, CALL Unfreeze");
+        }
+
+        if (this->data_parallel > 1) {
+            this->CreateReplicas();
+        }
+
+        loss_function.SetExecutionContext(*this->context);
+        opt.SetExecutionContext(*this->context);
+
+        for (auto metric: metrics) {
+            metric->SetExecutionContext(*this->context);
+        }
+
+        // to display progress bar
+        const int num_bars = 25;
+        int batch_per_bar = std::max(num_batches / num_bars, 1);
+        int progress = 0;
+        const int epoch_count_length = std::to_string(epochs).length();
+
+        for (auto layer: this->layers) {
+            layer->Training(true);
+        }
+
+        if (this->profiler) {
+            this->profiler->GetTimeline().NameThread("fit");
+        }
+
+        for (int e = 0; e < epochs; e++) {
+            auto start_time = std::chrono::high_resolution_clock::now();
+
+            for (int m = 0; m < num_batches; m++) {
+                Timeline::Scope loading(this->Trace(), this->trace_names.load, "data");
+                const auto &[input, label] = get_batch(m);
+                loading.End();
+
+                if (this->replicas.empty()) {
+                    this->Forward(input);
+                    this->BackwardAndUpdate(label, loss_function, opt);
+
+                    Timeline::Scope scope(this->Trace(), this->trace_names.metrics,
+                                          "metrics");
+
+                    for (auto metric: metrics) {
+                        (*metric)(this->GetOutput<TensorLabelRank>(), label);
+                    }
+                }
+                else {
+                    this->DataParallelStep(input, label, loss_function, metrics);
+                    this->Update(opt);
+                }
+
+                // progress bar
+                // on Mac terminal, \r carriage return may be ignored if the line
+                // exceeds the default terminal width
+                if (m % batch_per_bar == 0 && m != 0) {
+                    Timeline::Scope scope(this->Trace(), this->trace_names.progress,
+                                          "progress");
+                    auto elapsed_time = std::chrono::duration_cast<std::chrono::seconds>(
+                            std::chrono::high_resolution_clock::now() - start_time);
+
+                    // some terminals, like putty, will print each as a new line
+                    std::cout << "Epoch "
+                              << std::setw(epoch_count_length) << std::setfill(' ')
+                              << e + 1 << " ["
+                              << std::setw(progress) << std::setfill('=') << ""
+                              << std::setw(num_bars - progress)
+                              << std::setfill('.') << "" << "] "
+                              << elapsed_time.count() << "s loss: "
+                              << std::setprecision(4) << std::fixed
+                              << loss_function.GetLoss();
+
+                    for (auto metric: metrics) {
+                        std::cout << ", " << *metric;
+                    }
+
+                    std::cout << std::flush << '\r';
+                    progress++;
+                }
+            }
+
+            progress = 0; // progress bar reset for next epoch
+            std::cout << '\n';
+
+            for (auto metric: metrics) {
+                metric->Reset();
+            }
+        }
+
+        for (auto layer: this->layers) {
+            layer->Training(false);
+        }
+
+        this->replicas.clear();
+#ifndef FLARE_DO_NOT_USE_THREADS
+        this->replica_pool.reset();
+#endif
+    }
+
+
+    /**
+     * Layer i's input is layer i - 1's output, which only changes in layer
+     * i - 1's next Forward, long after layer i's Backward and input gradients
+     * are done with it, so the input is referenced instead of copied. The
+     * first layer's input belongs to the caller, so it is copied, except by
+     * layers that always reference their input, e.g. MultiHeadAttention.
+     * The caller keeps it until Backward, data-parallel shards in
+     * shard_inputs
+     *
+     * Runs every Forward since the layers vector is public
+     */
+    void PlanMemory()
+    {
+        for (size_t i = 0; i < this->layers.size(); i++) {
+            this->layers[i]->BorrowInput(this->memory_planning && i > 0);
+        }
+    }
+
+
+    // the per-layer calls of Forward, Backward and Update, timed when profiling
+    template<typename Input>
+    void ForwardLayer(int i, const Input &input)
+    {
+        if (!this->profiler) {
+            this->layers[i]->Forward(input);
+            return;
+        }
+
+        Profiler::Clock::time_point start = Profiler::Clock::now();
+        this->layers[i]->Forward(input);
+        this->profiler->Record(*this->layers[i], i, Profiler::FORWARD, start,
+                               Profiler::Clock::now());
+        this->profiler->SampleMemory(*this->layers[i], i);
+    }
+
+
+    // Backward of the output layer
+    template<int TensorRank>
+    void BackwardLayer(int i, const Tensor<TensorRank> &gradients)
+    {
+        if (!this->profiler) {
+            this->layers[i]->Backward(gradients);
+            return;
+        }
+
+        Profiler::Clock::time_point start = Profiler::Clock::now();
+        this->layers[i]->Backward(gradients);
+        this->profiler->Record(*this->layers[i], i, Profiler::BACKWARD, start,
+                               Profiler::Clock::now());
+        this->profiler->SampleMemory(*this->layers[i], i);
+    }
+
+
+    // Backward of hidden layer i from the input gradients of layer i + 1
+    void BackwardLayer(int i)
+    {
+        if (!this->profiler) {
+            this->layers[i]->Backward(*this->layers[i + 1]);
+            return;
+        }
+
+        TimedInputGradients next(*this->layers[i + 1], i + 1, *this->profiler);
+        Profiler::Clock::time_point start = Profiler::Clock::now();
+        this->layers[i]->Backward(next);
+        this->profiler->Record(*this->layers[i], i, Profiler::BACKWARD, start,
+                               Profiler::Clock::now(), next.seconds);
+        this->profiler->SampleMemory(*this->layers[i + 1], i + 1);
+        this->profiler->SampleMemory(*this->layers[i], i);
+    }
+
+
+    // may run on the update pool, concurrently with Backward of other layers
+    void UpdateLayer(int i, Optimizer &optimizer)
+    {
+        if (!this->profiler) {
+            this->layers[i]->Update(optimizer);
+            return;
+        }
+
+        Profiler::Clock::time_point start = Profiler::Clock::now();
+        this->layers[i]->Update(optimizer);
+        this->profiler->Record(*this->layers[i], i, Profiler::UPDATE, start,
+                               Profiler::Clock::now());
+    }
+
+
+    /**
+     * Stands in for layer i + 1 while layer i runs Backward, so the input
+     * gradients layer i + 1 computes on demand are timed as a call of their own
+     */
+    class TimedInputGradients : public Layer
+    {
+    public:
+        TimedInputGradients(Layer &next, int index, Profiler &profiler)
+                : Layer(next.GetInputRank(), next.GetOutputRank()),
+                  next(next), index(index), profiler(profiler)
+        {
+            this->name = next.name;
+        }
+
+
+        const Tensor<2> &GetInputGradients2D() override
+        {
+            return this->Time<2>([this]() -> auto & {
+                return this->next.GetInputGradients2D();
+            });
+        }
+
+
+        const Tensor<3> &GetInputGradients3D() override
+        {
+            return this->Time<3>([this]() -> auto & {
+                return this->next.GetInputGradients3D();
+            });
+        }
+
+
+        const Tensor<4> &GetInputGradients4D() override
+        {
+            return this->Time<4>([this]() -> auto & {
+                return this->next.GetInputGradients4D();
+            });
+        }
+
+
+        const Tensor<2> &GetOutput2D() const override
+        {
+            return this->next.GetOutput2D();
+        }
+
+
+        const Tensor<3> &GetOutput3D() const override
+        {
+            return this->next.GetOutput3D();
+        }
+
+
+        const Tensor<4> &GetOutput4D() const override
+        {
+            return this->next.GetOutput4D();
+        }
+
+
+        void Update(Optimizer &optimizer) override
+        {
+            // nothing to do, never updated
+        }
+
+
+        double seconds = 0; // time spent computing the input gradients
+
+    private:
+        template<int TensorRank, typename Function>
+        const Tensor<TensorRank> &Time(Function &&get_gradients)
+        {
+            Profiler::Clock::time_point start = Profiler::Clock::now();
+            const Tensor<TensorRank> &gradients = get_gradients();
+            Profiler::Clock::time_point end = Profiler::Clock::now();
+
+            this->profiler.Record(this->next, this->index, Profiler::INPUT_GRADIENTS,
+                                  start, end);
+            this->seconds += std::chrono::duration<double>(end - start).count();
+            return gradients;
+        }
+
+
+        Layer &next;
+        const int index;
+        Profiler &profiler;
+    };
+
+
+    // the profiler's timeline, nullptr when profiling is disabled
+    Timeline *Trace()
+    {
+        return this->profiler ? &this->profiler->GetTimeline() : nullptr;
+    }
+
+
+    template<int OutputRank>
+    const Tensor<OutputRank> &GetOutput() const
+    {
+        size_t last = this->layers.size() - 1;
+
+        while (this->Folded(last)) {
+            last--;
+        }
+
+        if constexpr (OutputRank == 2) {
+            return this->layers[last]->GetOutput2D();
+        }
+        else if constexpr (OutputRank == 3) {
+            return this->layers[last]->GetOutput3D();
+        }
+        else {
+            return this->layers[last]->GetOutput4D();
+        }
+    }
+
+
+    /**
+     * Fold each batch normalization over the channels that follows a layer
+     * into the layer's weights, and the ReLU, leaky ReLU or linear activation
+     * after either into its output pass, see Layer::Fold. A convolution, its
+     * normalization and activation then make one pass over the feature map
+     * instead of three. Layers that can't fold them keep running them
+     */
+    void FoldLayers()
+    {
+        this->folded_layers.assign(this->layers.size(), false);
+
+        for (size_t i = 0; i + 1 < this->layers.size(); i++) {
+            Tensor<1> scale;
+            Tensor<1> shift;
+            Scalar leak = 1;
+            size_t next = i + 1;
+
+            if (this->layers[next]->GetChannelAffine(scale, shift)) {
+                next++;
+            }
+
+            if (next < this->layers.size() && this->layers[next]->GetLeak(leak)) {
+                next++;
+            }
+
+            if (next > i + 1 && this->layers[i]->Fold(scale, shift, leak)) {
+                std::fill(this->folded_layers.begin() + i + 1,
+                          this->folded_layers.begin() + next, true);
+                i = next - 1;
+            }
+        }
+    }
+
+
+    // whether layer i is folded into an earlier layer, layers added since
+    // Freeze aren't
+    bool Folded(size_t i) const
+    {
+        return i < this->folded_layers.size() && this->folded_layers[i];
+    }
+
+
+    // copy the layers for data-parallel training, each copy on its own context
+    void CreateReplicas()
+    {
+        this->replicas.clear();
+
+        for (int r = 1; r < this->data_parallel; r++) {
+            Replica replica;
+            replica.context = std::make_unique<ExecutionContext>(
+                    this->threads_per_replica);
+            replica.model = std::make_unique<Sequential>(*replica.context);
+
+            for (Layer *layer: this->layers) {
+                replica.layers.emplace_back(layer->Clone());
+                replica.layers.back()->SetExecutionContext(*replica.context);
+                replica.model->layers.push_back(replica.layers.back().get());
+            }
+
+            replica.model->Training(true);
+            this->replicas.push_back(std::move(replica));
+        }
+
+#ifndef FLARE_DO_NOT_USE_THREADS
+        this->replica_pool = std::make_unique<Eigen::ThreadPool>(
+                this->data_parallel - 1);
+#endif
+    }
+
+
+    // runs Forward and Backward of one batch split across this model and its
+    // replicas, leaves the summed weight gradients in this model's layers
+    template<int TensorSampleRank, int TensorLabelRank>
+    void DataParallelStep(const Tensor<TensorSampleRank> &input,
+                          const Tensor<TensorLabelRank> &label,
+                          LossFunction<TensorLabelRank> &loss_function,
+                          const std::vector<fl::Metric<TensorLabelRank> *> &metrics)
+    {
+        const Eigen::Index batch_size = input.dimension(0);
+        const Eigen::Index shards = std::min<Eigen::Index>(
+                this->replicas.size() + 1, batch_size);
+
+        // first sample of each shard, the remainder is spread over the first shards
+        std::vector<Eigen::Index> offsets(shards + 1, 0);
+
+        for (Eigen::Index k = 0; k < shards; k++) {
+            offsets[k + 1] = offsets[k] + batch_size / shards +
+                             (k < batch_size % shards ? 1 : 0);
+        }
+
+        // replicas start from this model's current weights
+        for (Eigen::Index k = 1; k < shards; k++) {
+            for (size_t i = 0; i < this->layers.size(); i++) {
+                auto source = this->layers[i]->GetParameters();
+                auto target = this->replicas[k - 1].layers[i]->GetParameters();
+
+                for (size_t p = 0; p < source.size(); p++) {
+                    std::copy_n(source[p].data(), source[p].size(), target[p].data());
+                }
+            }
+        }
+
+        auto shard_model = [this](Eigen::Index k) -> Sequential & {
+            return k == 0 ? *this : *this->replicas[k - 1].model;
+        };
+
+        // slice of the batch dimension belonging to shard k
+        auto shard_of = [&offsets](auto &tensor, Eigen::Index k) {
+            auto slice_offsets = tensor.dimensions();
+            slice_offsets.fill(0);
+            slice_offsets[0] = offsets[k];
+            auto slice_extents = tensor.dimensions();
+            slice_extents[0] = offsets[k + 1] - offsets[k];
+            return tensor.slice(slice_offsets, slice_extents);
+        };
+
+        // layers may reference their input and gradients until Backward is
+        // done, e.g. MultiHeadAttention, the shard slices live in members
+        std::vector<Tensor<TensorSampleRank>> &shard_inputs =
+                this->shard_inputs.template Get<TensorSampleRank>();
+        std::vector<Tensor<TensorLabelRank>> &shard_gradients =
+                this->shard_gradients.template Get<TensorLabelRank>();
+        shard_inputs.resize(shards);
+        shard_gradients.resize(shards);
+
+        // 1. forward each shard concurrently
+        this->RunShards(shards, [&](Eigen::Index k) {
+            Timeline::Scope scope(this->Trace(), this->trace_names.shard_forward,
+                                  "forward");
+            shard_inputs[k] = shard_of(input, k);
+            shard_model(k).Forward(shard_inputs[k]);
+        });
+
+        // 2. evaluate the loss on the whole batch so the gradients are scaled
+        // exactly as without data parallelism, whatever the loss function
+        Dims<TensorLabelRank> output_dims =
+                shard_model(0).template GetOutput<TensorLabelRank>().dimensions();
+        output_dims[0] = batch_size;
+        Tensor<TensorLabelRank> output(output_dims);
+
+        for (Eigen::Index k = 0; k < shards; k++) {
+            shard_of(output, k) = shard_model(k).template GetOutput<TensorLabelRank>();
+        }
+
+        Timeline::Scope loss_scope(this->Trace(), this->trace_names.loss, "loss");
+        loss_function(output, label);
+        loss_scope.End();
+
+        Timeline::Scope metrics_scope(this->Trace(), this->trace_names.metrics,
+                                      "metrics");
+
+        for (auto metric: metrics) {
+            (*metric)(output, label);
+        }
+
+        metrics_scope.End();
+
+        // 3. backward each shard with its slice of the batch's loss gradients
+        const Tensor<TensorLabelRank> &gradients = loss_function.GetGradients();
+
+        this->RunShards(shards, [&](Eigen::Index k) {
+            Timeline::Scope scope(this->Trace(), this->trace_names.shard_backward,
+                                  "backward");
+            shard_gradients[k] = shard_of(gradients, k);
+            shard_model(k).Backward(shard_gradients[k]);
+        });
+
+        // 4. all-reduce, each shard holds its part of the batch's weight gradients
+        const Device &device = this->context->GetDevice();
+
+        for (size_t i = 0; i < this->layers.size(); i++) {
+            auto layer_gradients = this->layers[i]->GetParameterGradients();
+
+            for (Eigen::Index k = 1; k < shards; k++) {
+                auto replica_gradients =
+                        this->replicas[k - 1].layers[i]->GetParameterGradients();
+
+                for (size_t p = 0; p < layer_gradients.size(); p++) {
+                    layer_gradients[p].device(device) += replica_gradients[p];
+                }
+            }
+        }
+    }
+
+
+    // runs shard(0) on the calling thread and the other shards on the replica pool
+    template<typename Function>
+    void RunShards(Eigen::Index shards, Function &&shard)
+    {
+#ifndef FLARE_DO_NOT_USE_THREADS
+        Eigen::Barrier barrier(static_cast<unsigned int>(shards - 1));
+
+        for (Eigen::Index k = 1; k < shards; k++) {
+            this->replica_pool->Schedule([&shard, &barrier, k]() {
+                shard(k);
+                barrier.Notify();
+            });
+        }
+
+        shard(0);
+        barrier.Wait();
+#else
+        for (Eigen::Index k = 0; k < shards; k++) {
+            shard(k);
+        }
+#endif
+    }
+
+
+    // copy of the model that trains on a slice of each batch in data-parallel mode
+    struct Replica
+    {
+        std::unique_ptr<ExecutionContext> context;
+        std::vector<std::unique_ptr<Layer>> layers;
+        std::unique_ptr<Sequential> model; // runs the layers above, doesn't own them
+    };
+
+    // a tensor per data-parallel shard, of the rank the step trains with
+    struct ShardTensors
+    {
+        template<int TensorRank>
+        std::vector<Tensor<TensorRank>> &Get()
+        {
+            if constexpr (TensorRank == 2) {
+                return this->rank2;
+            }
+            else if constexpr (TensorRank == 3) {
+                return this->rank3;
+            }
+            else {
+                return this->rank4;
+            }
+        }
+
+        std::vector<Tensor<2>> rank2;
+        std::vector<Tensor<3>> rank3;
+        std::vector<Tensor<4>> rank4;
+    };
+
+    // ids of the timeline spans traced by Fit
+    struct TraceNames
+    {
+        int load, loss, step, metrics, progress, shard_forward, shard_backward;
+    };
+
+    std::vector<bool> folded_layers; // layers Freeze folded into an earlier one
+    std::unique_ptr<Profiler> profiler; // null unless profiling is enabled
+    TraceNames trace_names {};
+
+    bool overlapped_update = false;
+    bool frozen = false; // layers hold packed weights for inference
+    bool memory_planning = true; // layers after the first borrow their input
+    Eigen::Index checkpoint_segment = 0; // see SetCheckpointing
+#ifndef FLARE_DO_NOT_USE_THREADS
+    std::unique_ptr<Eigen::ThreadPool> update_pool; // runs overlapped updates
+#endif
+
+    int data_parallel = 1;
+    int threads_per_replica = 1;
+    std::vector<Replica> replicas;
+    ShardTensors shard_inputs; // slices of the batch, one per shard
+    ShardTensors shard_gradients; // slices of the loss gradients, one per shard
+#ifndef FLARE_DO_NOT_USE_THREADS
+    std::unique_ptr<Eigen::ThreadPool> replica_pool;
+#endif
+
+    ExecutionContext *context = &ExecutionContext::Default();
+    std::unique_ptr<ExecutionContext> owned_context; // created by SetThreads
 };
 
 }
@@ -0,0 +1,182 @@
+//
+// Created by R on 10/18/26.
+//
+
+#ifndef FLARE_TENSOR_ARENA_HPP
+#define FLARE_TENSOR_ARENA_HPP
+
+#include "flare/fl_types.hpp"
+#include <array>
+#include <mutex>
+#include <vector>
+
+namespace fl
+{
+
+/**
+ * Recycling allocator behind an execution context's device. Every temporary a
+ * tensor expression evaluates on the device, contraction packing buffers,
+ * .eval() results, reductions, comes from here and goes back to a free list
+ * of its size class when the expression is done instead of to the heap.
+ *
+ * The first training or inference step sizes the free lists, once the shapes
+ * stop changing every later step is served from them. HeapAllocations() only
+ * grows when a request couldn't be served, so it can be compared before and
+ * after a step to check that the step didn't allocate
+ *
+ * Sizes are rounded up to one of four classes per power of two, wasting at
+ * most a quarter of a block. Blocks stay reserved until Release()
+ *
+ * With FLARE_DO_NOT_USE_THREADS the device takes no allocator and the arena
+ * stays empty
+ */
+#ifndef FLARE_DO_NOT_USE_THREADS
+class TensorArena : public Eigen::Allocator
+#else
+class TensorArena
+#endif
+{
+public:
+    TensorArena() = default;
+
+    TensorArena(const TensorArena &) = delete;
+
+    TensorArena &operator=(const TensorArena &) = delete;
+
+
+    ~TensorArena()
+    {
+        this->Release();
+    }
+
+
+    void *allocate(size_t num_bytes) const
+    {
+        const int size_class = TensorArena::SizeClass(num_bytes);
+        std::lock_guard<std::mutex> lock(this->mutex);
+        std::vector<char *> &available = this->free_blocks[size_class];
+        this->allocations++;
+
+        if (!available.empty()) {
+            char *block = available.back();
+            available.pop_back();
+            return block + TensorArena::header;
+        }
+
+        const size_t bytes = TensorArena::ClassBytes(size_class);
+        char *block = static_cast<char *>(
+                Eigen::internal::aligned_malloc(TensorArena::header + bytes));
+        *reinterpret_cast<int *>(block) = size_class;
+
+        // room for every block of the class, returning one never reallocates
+        available.reserve(++this->blocks[size_class]);
+        this->heap_allocations++;
+        this->reserved_bytes += bytes;
+        return block + TensorArena::header;
+    }
+
+
+    void deallocate(void *buffer) const
+    {
+        if (!buffer) {
+            return;
+        }
+
+        char *block = static_cast<char *>(buffer) - TensorArena::header;
+        const int size_class = *reinterpret_cast<int *>(block);
+
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->free_blocks[size_class].push_back(block);
+    }
+
+
+    /**
+     * Free the blocks not in use, blocks still held by a running expression
+     * return to the arena as usual
+     */
+    void Release()
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+
+        for (int size_class = 0; size_class < classes; size_class++) {
+            for (char *block: this->free_blocks[size_class]) {
+                Eigen::internal::aligned_free(block);
+            }
+
+            this->blocks[size_class] -= this->free_blocks[size_class].size();
+            this->reserved_bytes -= this->free_blocks[size_class].size() *
+                                    TensorArena::ClassBytes(size_class);
+            this->free_blocks[size_class] = std::vector<char *>();
+        }
+    }
+
+
+    // number of buffers requested by the device
+    size_t Allocations() const
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        return this->allocations;
+    }
+
+
+    // number of requests that had to allocate a new block from the heap
+    size_t HeapAllocations() const
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        return this->heap_allocations;
+    }
+
+
+    // bytes of the blocks held by the arena, free or in use
+    size_t ReservedBytes() const
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        return this->reserved_bytes;
+    }
+
+private:
+    // keeps the buffers aligned like Eigen's, stores the block's size class
+    static constexpr size_t header = 64;
+
+    // four classes per power of two from 64 bytes up
+    static constexpr int classes = 4 * (64 - 6);
+
+
+    static size_t ClassBytes(int size_class)
+    {
+        const size_t power = size_t(1) << (size_class / 4 + 6);
+        return power / 4 * (4 + size_class % 4);
+    }
+
+
+    static int SizeClass(size_t num_bytes)
+    {
+        if (num_bytes <= 64) {
+            return 0;
+        }
+
+        int exponent = 6;
+
+        while (num_bytes >> (exponent + 1)) {
+            exponent++;
+        }
+
+        const size_t power = size_t(1) << exponent;
+        const size_t quarter = power / 4;
+        const int step = static_cast<int>((num_bytes - power + quarter - 1) / quarter);
+
+        return 4 * (exponent - 6) + step;
+    }
+
+
+    mutable std::mutex mutex;
+    mutable std::array<std::vector<char *>, classes> free_blocks;
+    mutable std::array<size_t, classes> blocks {}; // blocks of each class, free or not
+    mutable size_t allocations = 0;
+    mutable size_t heap_allocations = 0;
+    mutable size_t reserved_bytes = 0;
+};
+
+} // namespace fl
+
+#endif //FLARE_TENSOR_ARENA_HPP
@@ -0,0 +1,329 @@
+//
+// Created by R on 10/18/26.
+//
+
+#ifndef FLARE_TIMELINE_HPP
+#define FLARE_TIMELINE_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fl
+{
+
+/**
+ * Timeline of spans and counters written in the Chrome trace event format,
+ * viewable in chrome://tracing or Perfetto
+ *
+ * Every thread records into its own ring buffer without locking, once full a
+ * thread's oldest events are overwritten. Names are interned once with Name()
+ * so recording never copies strings
+ *
+ *     int step = timeline.Name("optimizer step");
+ *     {
+ *         Timeline::Scope scope(&timeline, step, "optimizer");
+ *         opt.Step();
+ *     }
+ *     timeline.WriteChromeTrace("trace.json");
+ *
+ * WriteChromeTrace and Reset must not run while other threads are recording
+ */
+class Timeline
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @param capacity   events kept per thread
+     */
+    explicit Timeline(size_t capacity = 1 << 16)
+            : capacity(std::max<size_t>(capacity, 1)), id(Timeline::NextId()),
+              origin(Clock::now())
+    {
+        // nothing to do
+    }
+
+
+    Timeline(const Timeline &) = delete;
+
+    Timeline &operator=(const Timeline &) = delete;
+
+
+    /**
+     * @return   id of name to record events under, the same name always gets
+     *           the same id
+     */
+    int Name(const std::string &name)
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        auto inserted = this->name_ids.emplace(name, static_cast<int>(this->names.size()));
+
+        if (inserted.second) {
+            this->names.push_back(name);
+        }
+
+        return inserted.first->second;
+    }
+
+
+    /**
+     * Name the calling thread's track in the trace
+     */
+    void NameThread(const std::string &name)
+    {
+        ThreadBuffer &buffer = this->Buffer();
+        std::lock_guard<std::mutex> lock(this->mutex);
+        buffer.name = name;
+    }
+
+
+    /**
+     * Record a span of the calling thread
+     *
+     * @param category   string literal, shown as the event's category
+     */
+    void Record(int name, const char *category, Clock::time_point start,
+                Clock::time_point end)
+    {
+        this->Push({name, category, false, this->Nanoseconds(start),
+                    this->Nanoseconds(end), 0});
+    }
+
+
+    /**
+     * Record the value of counter name, shown as a graph of its own
+     */
+    void Counter(int name, Clock::time_point time, double value)
+    {
+        const int64_t ns = this->Nanoseconds(time);
+        this->Push({name, "counter", true, ns, ns, value});
+    }
+
+
+    /**
+     * Records a span from construction until End() or destruction, does
+     * nothing for a null timeline
+     */
+    class Scope
+    {
+    public:
+        Scope(Timeline *timeline, int name, const char *category)
+                : timeline(timeline), name(name), category(category)
+        {
+            if (timeline) {
+                this->start = Clock::now();
+            }
+        }
+
+
+        ~Scope()
+        {
+            this->End();
+        }
+
+
+        void End()
+        {
+            if (this->timeline) {
+                this->timeline->Record(this->name, this->category, this->start,
+                                       Clock::now());
+                this->timeline = nullptr;
+            }
+        }
+
+
+        Scope(const Scope &) = delete;
+
+        Scope &operator=(const Scope &) = delete;
+
+    private:
+        Timeline *timeline;
+        const int name;
+        const char *category;
+        Clock::time_point start;
+    };
+
+
+    /**
+     * Write the events still held by the threads' ring buffers, each thread is
+     * a track of its own
+     */
+    void WriteChromeTrace(const std::string &path) const
+    {
+        std::ofstream trace(path);
+
+        if (!trace.is_open()) {
+            throw std::invalid_argument("Timeline UNABLE TO WRITE " + path);
+        }
+
+        std::lock_guard<std::mutex> lock(this->mutex);
+        trace << "{\"traceEvents\": [\n";
+        trace << std::fixed << std::setprecision(3);
+
+        for (size_t t = 0; t < this->buffers.size(); t++) {
+            const ThreadBuffer &buffer = *this->buffers[t];
+            trace << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 0, \"tid\": "
+                  << t << ", \"args\": {\"name\": \""
+                  << Timeline::Escape(buffer.name) << "\"}}";
+
+            const uint64_t head = buffer.head.load(std::memory_order_acquire);
+            const uint64_t first = head > this->capacity ? head - this->capacity : 0;
+
+            for (uint64_t i = first; i < head; i++) {
+                const Event &event = buffer.events[i % this->capacity];
+                const std::string name = Timeline::Escape(this->names[event.name]);
+                trace << ",\n";
+
+                if (event.counter) {
+                    trace << "{\"name\": \"" << name << "\", \"ph\": \"C\", \"ts\": "
+                          << event.start / 1e3 << ", \"pid\": 0, \"tid\": " << t
+                          << ", \"args\": {\"value\": " << event.value << "}}";
+                }
+                else {
+                    trace << "{\"name\": \"" << name << "\", \"cat\": \""
+                          << event.category << "\", \"ph\": \"X\", \"ts\": "
+                          << event.start / 1e3 << ", \"dur\": "
+                          << (event.end - event.start) / 1e3
+                          << ", \"pid\": 0, \"tid\": " << t << "}";
+                }
+            }
+
+            trace << (t + 1 < this->buffers.size() ? ",\n" : "\n");
+        }
+
+        trace << "], \"displayTimeUnit\": \"ms\"}\n";
+    }
+
+
+    /**
+     * Discard the recorded events, names and thread tracks are kept
+     */
+    void Reset()
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+
+        for (auto &buffer: this->buffers) {
+            buffer->head.store(0, std::memory_order_release);
+        }
+
+        this->origin = Clock::now();
+    }
+
+private:
+    struct Event
+    {
+        int name;
+        const char *category;
+        bool counter;
+        int64_t start; // nanoseconds since origin
+        int64_t end;
+        double value;
+    };
+
+
+    // written by its thread only, read by WriteChromeTrace
+    struct ThreadBuffer
+    {
+        explicit ThreadBuffer(size_t capacity, std::string name)
+                : events(capacity), name(std::move(name))
+        {
+            // nothing to do
+        }
+
+
+        std::vector<Event> events;
+        std::atomic<uint64_t> head {0}; // events ever recorded
+        std::string name;
+    };
+
+
+    void Push(const Event &event)
+    {
+        ThreadBuffer &buffer = this->Buffer();
+        const uint64_t head = buffer.head.load(std::memory_order_relaxed);
+        buffer.events[head % this->capacity] = event;
+        buffer.head.store(head + 1, std::memory_order_release);
+    }
+
+
+    // the calling thread's buffer, only its first event takes the lock
+    ThreadBuffer &Buffer()
+    {
+        thread_local uint64_t cached_id = 0;
+        thread_local ThreadBuffer *cached = nullptr;
+
+        if (cached_id == this->id) {
+            return *cached;
+        }
+
+        std::lock_guard<std::mutex> lock(this->mutex);
+        auto found = this->thread_buffers.find(std::this_thread::get_id());
+
+        if (found == this->thread_buffers.end()) {
+            this->buffers.push_back(std::make_unique<ThreadBuffer>(
+                    this->capacity, "thread " + std::to_string(this->buffers.size())));
+            found = this->thread_buffers.emplace(std::this_thread::get_id(),
+                                                 this->buffers.back().get()).first;
+        }
+
+        cached_id = this->id;
+        cached = found->second;
+        return *cached;
+    }
+
+
+    int64_t Nanoseconds(Clock::time_point time) const
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                time - this->origin).count();
+    }
+
+
+    static std::string Escape(const std::string &text)
+    {
+        std::string escaped;
+
+        for (char c: text) {
+            if (c == '"' || c == '\\') {
+                escaped += '\\';
+            }
+
+            escaped += c;
+        }
+
+        return escaped;
+    }
+
+
+    // distinguishes timelines in the threads' cached buffers, never reused
+    static uint64_t NextId()
+    {
+        static std::atomic<uint64_t> next_id {1};
+        return next_id++;
+    }
+
+
+    const size_t capacity;
+    const uint64_t id;
+    Clock::time_point origin;
+    mutable std::mutex mutex;
+    std::vector<std::string> names;
+    std::map<std::string, int> name_ids;
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+    std::map<std::thread::id, ThreadBuffer *> thread_buffers;
+};
+
+} // namespace fl
+
+#endif //FLARE_TIMELINE_HPP